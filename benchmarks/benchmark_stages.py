@@ -0,0 +1,248 @@
+"""Time and memory-profile the system preparation stages of crimm on a fixed
+ladder of reference systems, and compare the results with a baseline.
+
+Systems (smallest to largest):
+    tripeptide  the ALA-ALA-ALA peptide built from sequence (tutorial 3)
+    1lsa        a mid-size single protein entry
+    4hhb        a multi-chain assembly (hemoglobin tetramer)
+    waterbox    the tripeptide solvated in a box of about 1M atoms
+
+Stages: build (sequence building or fetch and parse), topology
+(TopologyGenerator.generate_model), solvate and ions (Solvator), psf and crd
+(PSFWriter/CRDWriter to a temporary directory).
+
+Usage:
+    python benchmarks/benchmark_stages.py -o results.json
+    python benchmarks/benchmark_stages.py --systems tripeptide 1lsa \\
+        --trace-memory --baseline previous.json
+
+The results are written as JSON. With --baseline, stages slower than the
+baseline by more than --tolerance are reported and the exit status is 1.
+
+The baseline is recorded on the same machine, by running the script with -o
+on the reference checkout (the systems and the options have to match the
+compared run). No baseline file is kept in the repository, the timings are
+only comparable on the machine they were recorded on.
+"""
+import os
+import sys
+import json
+import time
+import argparse
+import platform
+import tempfile
+import warnings
+import tracemalloc
+from datetime import datetime, timezone
+
+import numpy as np
+
+SYSTEMS = ('tripeptide', '1lsa', '4hhb', 'waterbox')
+STAGES = ('build', 'topology', 'solvate', 'ions', 'psf', 'crd')
+# Side length (A) of the generated water box, about 1M atoms
+WATERBOX_SIZE = 215.0
+# Relative slowdown that counts as a regression
+DEFAULT_TOLERANCE = 0.2
+# Stages faster than this (s) are not compared, timer noise dominates
+MIN_COMPARED_TIME = 0.05
+
+def _get_max_rss_mb():
+    try:
+        import resource
+    except ImportError:
+        return None
+    max_rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # kilobytes on Linux, bytes on macOS
+    if sys.platform == 'darwin':
+        return max_rss / 2**20
+    return max_rss / 2**10
+
+class StageTimer:
+    """Record the wall time and the memory of the stages of one run."""
+    def __init__(self, trace_memory=False):
+        self.trace_memory = trace_memory
+        self.records = {}
+
+    def run(self, stage, func, *args, **kwargs):
+        if self.trace_memory:
+            tracemalloc.start()
+        start = time.perf_counter()
+        try:
+            result = func(*args, **kwargs)
+        finally:
+            elapsed = time.perf_counter() - start
+            peak_mb = None
+            if self.trace_memory:
+                peak_mb = tracemalloc.get_traced_memory()[1] / 2**20
+                tracemalloc.stop()
+        self.records[stage] = {
+            'time_s': elapsed, 'peak_memory_mb': peak_mb,
+            'max_rss_mb': _get_max_rss_mb(),
+        }
+        return result
+
+def _build_tripeptide():
+    from crimm.StructEntities.Model import Model
+    from crimm.StructEntities.OrganizedModel import OrganizedModel
+    from crimm.Modeller.SeqChainGenerator import SeqChainGenerator
+    generator = SeqChainGenerator()
+    generator.set_three_letter_sequence('ALA ALA ALA', chain_type='polypeptide')
+    model = Model(1)
+    model.add(generator.create_chain())
+    return OrganizedModel(model)
+
+def _fetch(pdb_id, local_entry, mirror_dir):
+    from crimm.Fetchers import fetch_rcsb
+    return fetch_rcsb(
+        pdb_id, local_entry=local_entry, mirror_dir=mirror_dir, organize=True
+    )
+
+def _get_n_atoms(model):
+    n_atoms = 0
+    for chain in model:
+        if getattr(chain, 'is_array_backed', False):
+            n_atoms += chain.n_atoms
+        else:
+            n_atoms += sum(1 for _ in chain.get_atoms())
+    return n_atoms
+
+def run_system(system, topo, args):
+    """Run all stages on a system once. Return the stage records and the
+    number of atoms of the prepared system."""
+    from crimm.Modeller.Solvator import Solvator
+    from crimm.IO.PSFWriter import write_psf
+    from crimm.IO.CRDWriter import write_crd
+    timer = StageTimer(args.trace_memory)
+    if system in ('tripeptide', 'waterbox'):
+        model = timer.run('build', _build_tripeptide)
+    else:
+        model = timer.run(
+            'build', _fetch, system, args.local_entry, args.mirror_dir
+        )
+    timer.run('topology', topo.generate_model, model, QUIET=True)
+    solvator = Solvator(model)
+    if system == 'waterbox':
+        extent = np.ptp(
+            np.array([atom.coord for atom in model.get_atoms()]), axis=0
+        ).max()
+        cutoff = max(args.waterbox_size - extent, 9.0)
+    else:
+        cutoff = 9.0
+    timer.run('solvate', solvator.solvate, cutoff=cutoff)
+    timer.run('ions', solvator.add_ions, concentration=0.15)
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        timer.run('psf', write_psf, model, os.path.join(tmp_dir, 'system.psf'))
+        timer.run('crd', write_crd, model, os.path.join(tmp_dir, 'system.crd'))
+    return timer.records, _get_n_atoms(model)
+
+def _get_versions():
+    try:
+        from importlib.metadata import version
+        crimm_version = version('crimm')
+    except Exception:
+        crimm_version = None
+    return {
+        'crimm': crimm_version,
+        'python': platform.python_version(),
+        'numpy': np.__version__,
+        'platform': platform.platform(),
+        'processor': platform.processor(),
+        'cpu_count': os.cpu_count(),
+    }
+
+def run_benchmarks(args):
+    """Run the benchmarks and return the results as a dict."""
+    from crimm.Modeller.TopoLoader import TopologyGenerator
+    start = time.perf_counter()
+    # loading the toppar files is measured separately, it is done once
+    topo = TopologyGenerator()
+    toppar_load_time = time.perf_counter() - start
+    results = []
+    for system in args.systems:
+        stage_runs = {stage: [] for stage in STAGES}
+        n_atoms = None
+        for _ in range(args.repeat):
+            with warnings.catch_warnings():
+                warnings.simplefilter('ignore')
+                records, n_atoms = run_system(system, topo, args)
+            for stage, record in records.items():
+                stage_runs[stage].append(record)
+        for stage, runs in stage_runs.items():
+            if not runs:
+                continue
+            times = [run['time_s'] for run in runs]
+            peaks = [
+                run['peak_memory_mb'] for run in runs
+                if run['peak_memory_mb'] is not None
+            ]
+            results.append({
+                'system': system, 'stage': stage, 'n_atoms': n_atoms,
+                # the minimum is the least noisy estimate of the stage cost
+                'time_s': min(times), 'times_s': times,
+                'peak_memory_mb': max(peaks) if peaks else None,
+                'max_rss_mb': runs[-1]['max_rss_mb'],
+            })
+            print(
+                f'{system:>10s} {stage:>8s} {min(times):10.3f} s '
+                f'atoms={n_atoms}', flush=True
+            )
+    return {
+        'timestamp': datetime.now(timezone.utc).isoformat(),
+        'versions': _get_versions(),
+        'toppar_load_time_s': toppar_load_time,
+        'repeat': args.repeat,
+        'trace_memory': args.trace_memory,
+        'results': results,
+    }
+
+def compare(results, baseline, tolerance=DEFAULT_TOLERANCE):
+    """Return the list of (system, stage, time, baseline time) of the stages
+    slower than the baseline by more than the tolerance."""
+    baseline_times = {
+        (r['system'], r['stage']): r['time_s'] for r in baseline['results']
+    }
+    regressions = []
+    for r in results['results']:
+        ref_time = baseline_times.get((r['system'], r['stage']))
+        if ref_time is None or ref_time < MIN_COMPARED_TIME:
+            continue
+        if r['time_s'] > ref_time * (1 + tolerance):
+            regressions.append((r['system'], r['stage'], r['time_s'], ref_time))
+    return regressions
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument(
+        '--systems', nargs='+', choices=SYSTEMS, default=list(SYSTEMS)
+    )
+    parser.add_argument('-o', '--output', help='JSON file of the results')
+    parser.add_argument('--baseline', help='JSON results to compare with')
+    parser.add_argument('--tolerance', type=float, default=DEFAULT_TOLERANCE)
+    parser.add_argument('--repeat', type=int, default=1)
+    parser.add_argument(
+        '--trace-memory', action='store_true',
+        help='record the peak Python memory of each stage (slower)'
+    )
+    parser.add_argument('--waterbox-size', type=float, default=WATERBOX_SIZE)
+    parser.add_argument('--local-entry', help='local mmCIF archive')
+    parser.add_argument('--mirror-dir', help='local download mirror')
+    args = parser.parse_args(argv)
+
+    results = run_benchmarks(args)
+    if args.output:
+        with open(args.output, 'w', encoding='utf-8') as f:
+            json.dump(results, f, indent=2)
+    if args.baseline is None:
+        return 0
+    with open(args.baseline, 'r', encoding='utf-8') as f:
+        baseline = json.load(f)
+    regressions = compare(results, baseline, args.tolerance)
+    for system, stage, cur_time, ref_time in regressions:
+        print(
+            f'REGRESSION {system} {stage}: {cur_time:.3f} s '
+            f'(baseline {ref_time:.3f} s, {cur_time/ref_time:.2f}x)'
+        )
+    return 1 if regressions else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,11 +1,23 @@
+import warnings
+import numpy as np
+import openmm
 import openmm.unit as unit
-from openmm.vec3 import Vec3
 from openmm.app import element
 from openmm.app.topology import Topology as OMMTop
 from openmm.app.internal.unitcell import computePeriodicBoxVectors
 
 from crimm.StructEntities.Model import Model
 from crimm.StructEntities.Structure import Structure
+from crimm.IO.PSFWriter import PSFWriter
+from crimm.Modeller.TopoLoader import (
+    get_model_param_loaders, lookup_params
+)
+
+# Conversion factors from CHARMM units (kcal/mol, angstrom, degree) to OpenMM
+# units (kJ/mol, nm, radian)
+KCAL_TO_KJ = 4.184
+ANGSTROM_TO_NM = 0.1
+DEG_TO_RAD = np.pi/180
     
 class Topology(OMMTop):
     """Model/Topology class derived from Biopython Model and made compatible with
@@ -124,7 +136,328 @@ def construct_omm_positions(entity):
         # take the first model if a structure is supplied
         entity = entity.child_list[0]
 
-    positions = []
-    for atom in entity.get_atoms():
-        positions.append(Vec3(*(atom.coord/10)))
-    return unit.Quantity(value=positions, unit=unit.nanometers)
\ No newline at end of file
+    positions = np.array(
+        [atom.coord for atom in entity.get_atoms()], dtype=float
+    ).reshape(-1, 3)*ANGSTROM_TO_NM
+    return unit.Quantity(value=positions, unit=unit.nanometers)
+
+def _warn_missing(topo_type, unique_params, inverse):
+    missing = np.array([p is None for p in unique_params], dtype=bool)
+    if len(missing) and (n_missing := int(missing[inverse].sum())) > 0:
+        warnings.warn(
+            f'{n_missing} {topo_type} failed to find parameters and are not '
+            'added to the OpenMM System!'
+        )
+
+def _add_bonded_forces(system, arrays, param_loaders):
+    """Add the bond, Urey-Bradley, angle, dihedral, improper and CMAP forces"""
+    atom_types = arrays['atom_types']
+
+    bonds = arrays['bonds']
+    params, inverse = lookup_params(param_loaders, 'get_bond', atom_types[bonds])
+    _warn_missing('bonds', params, inverse)
+    bond_force = openmm.HarmonicBondForce()
+    for (i, j), p_id in zip(bonds.tolist(), inverse.tolist()):
+        if (param := params[p_id]) is None:
+            continue
+        # CHARMM: K(r-b0)^2, OpenMM: 0.5k(r-b0)^2
+        bond_force.addBond(
+            i, j, param.b0*ANGSTROM_TO_NM,
+            2*param.kb*KCAL_TO_KJ/ANGSTROM_TO_NM**2
+        )
+    system.addForce(bond_force)
+
+    angles = arrays['angles']
+    angle_types = atom_types[angles]
+    params, inverse = lookup_params(param_loaders, 'get_angle', angle_types)
+    _warn_missing('angles', params, inverse)
+    angle_force = openmm.HarmonicAngleForce()
+    for (i, j, k), p_id in zip(angles.tolist(), inverse.tolist()):
+        if (param := params[p_id]) is None:
+            continue
+        angle_force.addAngle(
+            i, j, k, param.theta0*DEG_TO_RAD, 2*param.ktheta*KCAL_TO_KJ
+        )
+    system.addForce(angle_force)
+
+    ub_params, inverse = lookup_params(
+        param_loaders, 'urey_bradley', angle_types
+    )
+    ub_force = openmm.HarmonicBondForce()
+    for (i, _, k), p_id in zip(angles.tolist(), inverse.tolist()):
+        if (param := ub_params[p_id]) is None or param.kub == 0:
+            continue
+        ub_force.addBond(
+            i, k, param.s0*ANGSTROM_TO_NM,
+            2*param.kub*KCAL_TO_KJ/ANGSTROM_TO_NM**2
+        )
+    if ub_force.getNumBonds() > 0:
+        system.addForce(ub_force)
+
+    dihedrals = arrays['dihedrals']
+    params, inverse = lookup_params(
+        param_loaders, 'get_dihedral', atom_types[dihedrals]
+    )
+    _warn_missing('dihedrals', params, inverse)
+    torsion_force = openmm.PeriodicTorsionForce()
+    for (i, j, k, l), p_id in zip(dihedrals.tolist(), inverse.tolist()):
+        if (param_list := params[p_id]) is None:
+            continue
+        for param in param_list:
+            torsion_force.addTorsion(
+                i, j, k, l, param.n, param.delta*DEG_TO_RAD,
+                param.kchi*KCAL_TO_KJ
+            )
+    system.addForce(torsion_force)
+
+    impropers = arrays['impropers']
+    params, inverse = lookup_params(
+        param_loaders, 'get_improper', atom_types[impropers]
+    )
+    _warn_missing('impropers', params, inverse)
+    # CHARMM: K(psi-psi0)^2 with the difference wrapped into [-pi, pi)
+    improper_force = openmm.CustomTorsionForce(
+        'k*dtheta_torus^2;'
+        'dtheta_torus = dtheta - floor(dtheta/(2*pi)+0.5)*(2*pi);'
+        'dtheta = theta - theta0;'
+        f'pi = {np.pi}'
+    )
+    improper_force.addPerTorsionParameter('k')
+    improper_force.addPerTorsionParameter('theta0')
+    for (i, j, k, l), p_id in zip(impropers.tolist(), inverse.tolist()):
+        if (param := params[p_id]) is None:
+            continue
+        improper_force.addTorsion(
+            i, j, k, l, (param.kpsi*KCAL_TO_KJ, param.psi0*DEG_TO_RAD)
+        )
+    system.addForce(improper_force)
+
+    cmaps = arrays['cmap']
+    if len(cmaps) == 0:
+        return
+    params, inverse = lookup_params(param_loaders, 'cmap', atom_types[cmaps])
+    _warn_missing('cmap', params, inverse)
+    cmap_force = openmm.CMAPTorsionForce()
+    map_ids = {}
+    for atom_ids, p_id in zip(cmaps.tolist(), inverse.tolist()):
+        if (param_rows := params[p_id]) is None:
+            continue
+        if p_id not in map_ids:
+            # rows are phi and columns are psi, both starting from -180 deg.
+            # OpenMM grids start from 0 and are indexed as phi + size*psi
+            grid = np.array([row.values for row in param_rows])
+            size = len(grid)
+            grid = np.roll(grid, -(size//2), axis=(0, 1))
+            map_ids[p_id] = cmap_force.addMap(
+                size, (grid.T.ravel()*KCAL_TO_KJ).tolist()
+            )
+        cmap_force.addTorsion(map_ids[p_id], *atom_ids)
+    system.addForce(cmap_force)
+
+def _get_exclusion_pairs(arrays, n_atoms):
+    """Return the (n, 2) arrays of the unique 1-2 and 1-3 pairs to exclude, and
+    of the 1-4 pairs from the dihedrals that are not excluded."""
+    def pair_keys(pairs):
+        pairs = np.sort(pairs, axis=1)
+        return np.unique(pairs[:, 0]*n_atoms + pairs[:, 1])
+    excluded = np.union1d(
+        pair_keys(arrays['bonds']), pair_keys(arrays['angles'][:, [0, 2]])
+    )
+    pairs_14 = pair_keys(arrays['dihedrals'][:, [0, 3]])
+    pairs_14 = np.setdiff1d(pairs_14, excluded)
+    to_pairs = lambda keys: np.stack([keys//n_atoms, keys%n_atoms], axis=1)
+    return to_pairs(excluded.astype(np.int64)), to_pairs(pairs_14.astype(np.int64))
+
+def _add_nonbonded_forces(
+        system, arrays, param_loaders, nonbonded_method, nonbonded_cutoff,
+        switch_distance
+    ):
+    """Add the NonbondedForce, with the exclusions and the 1-4 exceptions. If
+    any NBFIX pair is present, the Lennard-Jones interactions are computed by a
+    CustomNonbondedForce with tabulated pair coefficients instead."""
+    atom_types = arrays['atom_types']
+    charges = arrays['charges']
+    n_atoms = len(atom_types)
+    lj_types, type_ids = np.unique(atom_types.astype(str), return_inverse=True)
+    lj_types = lj_types.tolist()
+    lj_params, lj14_params = [], []
+    for atom_type in lj_types:
+        param = param14 = None
+        for param_loader in param_loaders:
+            if atom_type in param_loader.param_dict['nonbonded']:
+                param = param_loader.param_dict['nonbonded'][atom_type]
+                param14 = param_loader.param_dict['nonbonded14'].get(atom_type)
+                break
+        if param is None:
+            raise ValueError(
+                f'No nonbonded parameters for atom type {atom_type}!'
+            )
+        lj_params.append(param)
+        lj14_params.append(param14 or param)
+    # CHARMM: eps as Emin (negative), Rmin/2; OpenMM: sigma and positive eps
+    rmin_to_sigma = 2*ANGSTROM_TO_NM/2**(1/6)
+    sigmas = np.array([p.rmin_half for p in lj_params])*rmin_to_sigma
+    epsilons = np.abs([p.epsilon for p in lj_params])*KCAL_TO_KJ
+    sigmas_14 = np.array([p.rmin_half for p in lj14_params])*rmin_to_sigma
+    epsilons_14 = np.abs([p.epsilon for p in lj14_params])*KCAL_TO_KJ
+
+    nbfix = {}
+    for param_loader in param_loaders:
+        for (type1, type2), param in param_loader.param_dict['nbfix'].items():
+            if type1 in lj_types and type2 in lj_types:
+                nbfix.setdefault((type1, type2), param)
+
+    nb_force = openmm.NonbondedForce()
+    nb_force.setNonbondedMethod(nonbonded_method)
+    use_cutoff = nonbonded_method != openmm.NonbondedForce.NoCutoff
+    if use_cutoff:
+        nb_force.setCutoffDistance(nonbonded_cutoff)
+        if switch_distance is not None:
+            nb_force.setUseSwitchingFunction(True)
+            nb_force.setSwitchingDistance(switch_distance)
+    type_ids = type_ids.reshape(-1)
+    for charge, type_id in zip(charges.tolist(), type_ids.tolist()):
+        if nbfix:
+            # Lennard-Jones is computed in the CustomNonbondedForce
+            nb_force.addParticle(charge, 1.0, 0.0)
+        else:
+            nb_force.addParticle(charge, sigmas[type_id], epsilons[type_id])
+
+    excluded, pairs_14 = _get_exclusion_pairs(arrays, n_atoms)
+    for i, j in excluded.tolist():
+        nb_force.addException(i, j, 0.0, 1.0, 0.0)
+    for i, j in pairs_14.tolist():
+        ti, tj = type_ids[i], type_ids[j]
+        nb_force.addException(
+            i, j, charges[i]*charges[j],
+            (sigmas_14[ti] + sigmas_14[tj])/2,
+            np.sqrt(epsilons_14[ti]*epsilons_14[tj])
+        )
+    system.addForce(nb_force)
+    if not nbfix:
+        return
+
+    n_types = len(lj_types)
+    rmin = (sigmas[:, None] + sigmas[None])/rmin_to_sigma*ANGSTROM_TO_NM
+    eps = np.sqrt(epsilons[:, None]*epsilons[None])
+    for (type1, type2), param in nbfix.items():
+        i, j = lj_types.index(type1), lj_types.index(type2)
+        rmin[i, j] = rmin[j, i] = param.rmin*ANGSTROM_TO_NM
+        eps[i, j] = eps[j, i] = abs(param.emin)*KCAL_TO_KJ
+    # E = eps*((rmin/r)^12 - 2(rmin/r)^6)
+    acoef = np.sqrt(eps)*rmin**6
+    bcoef = 2*eps*rmin**6
+    lj_force = openmm.CustomNonbondedForce(
+        '(a/r6)^2-b/r6; r6=r^6; a=acoef(type1, type2); b=bcoef(type1, type2)'
+    )
+    lj_force.addTabulatedFunction(
+        'acoef', openmm.Discrete2DFunction(n_types, n_types, acoef.T.ravel().tolist())
+    )
+    lj_force.addTabulatedFunction(
+        'bcoef', openmm.Discrete2DFunction(n_types, n_types, bcoef.T.ravel().tolist())
+    )
+    lj_force.addPerParticleParameter('type')
+    for type_id in type_ids.tolist():
+        lj_force.addParticle((type_id,))
+    if not use_cutoff:
+        lj_force.setNonbondedMethod(openmm.CustomNonbondedForce.NoCutoff)
+    else:
+        if nonbonded_method == openmm.NonbondedForce.CutoffNonPeriodic:
+            lj_force.setNonbondedMethod(openmm.CustomNonbondedForce.CutoffNonPeriodic)
+        else:
+            lj_force.setNonbondedMethod(openmm.CustomNonbondedForce.CutoffPeriodic)
+        lj_force.setCutoffDistance(nonbonded_cutoff)
+        if switch_distance is not None:
+            lj_force.setUseSwitchingFunction(True)
+            lj_force.setSwitchingDistance(switch_distance)
+    # the 1-4 interactions are in the NonbondedForce exceptions
+    for i, j in np.concatenate([excluded, pairs_14]).tolist():
+        lj_force.addExclusion(i, j)
+    system.addForce(lj_force)
+
+def _get_block_positions(atom_blocks, coord_store=None):
+    """Return the (n_atoms, 3) coordinates of the atom blocks in nm. The atom
+    coordinates are gathered from the coordinate store of the model if 
+    attached."""
+    coords = []
+    for _, block in atom_blocks:
+        if isinstance(block, list) and coord_store is not None:
+            rows = coord_store.get_rows(block)
+            block_coords = coord_store.coords[rows]
+            for i in np.flatnonzero(rows < 0):
+                block_coords[i] = block[i].coord
+            coords.append(block_coords.reshape(-1, 3))
+        elif isinstance(block, list):
+            coords.append(np.array([atom.coord for atom in block], dtype=float).reshape(-1, 3))
+        else:
+            coords.append(np.asarray(block.coords, dtype=float).reshape(-1, 3))
+    if not coords:
+        return np.zeros((0, 3))
+    return np.concatenate(coords)*ANGSTROM_TO_NM
+
+def create_omm_system(
+        model: Model, param_loaders=None,
+        nonbonded_method=openmm.NonbondedForce.NoCutoff,
+        nonbonded_cutoff=1.2, switch_distance=1.0, box_vectors=None
+    ):
+    """Build an OpenMM System directly from the topology of a crimm model, 
+    without writing and reading PSF/CRD files. The atoms and topology elements
+    are taken as index arrays in PSF order (see PSFWriter.get_topology_arrays),
+    and the parameters are looked up once per distinct atom type combination.
+    The energy terms follow the CHARMM force field (harmonic bonds, angles, 
+    Urey-Bradley and impropers, periodic dihedrals, CMAP, Lennard-Jones with 
+    NBFIX and 1-4 parameters).
+
+    Args:
+        model: Model with topology generated (e.g. by 
+            TopologyGenerator.generate_model)
+        param_loaders: list of ParameterLoaders to look up the parameters from.
+            Default to the loaders of model.topology_loader. Ligand parameters
+            (e.g. from CGenFF) need to be provided here.
+        nonbonded_method: nonbonded method of openmm.NonbondedForce
+            (e.g. NoCutoff, CutoffNonPeriodic, PME)
+        nonbonded_cutoff: cutoff distance in nm (ignored for NoCutoff)
+        switch_distance: Lennard-Jones switching distance in nm, or None for no
+            switching function (ignored for NoCutoff)
+        box_vectors: (3, 3) periodic box vectors in angstrom. Default to the unit
+            cell of the parent structure if available.
+
+    Returns:
+        system: openmm.System
+        positions: (n_atoms, 3) coordinates as a Quantity in nm, in the particle
+            order of the system
+    """
+    arrays = PSFWriter().get_topology_arrays(model)
+    if arrays['n_lonepairs'] > 0:
+        raise NotImplementedError(
+            'Lone pairs (virtual sites) are not supported by create_omm_system! '
+            'Use the PSF file with openmm.app.CharmmPsfFile instead.'
+        )
+    param_loaders = get_model_param_loaders(model, param_loaders)
+
+    system = openmm.System()
+    for mass in arrays['masses'].tolist():
+        system.addParticle(mass)
+    if box_vectors is not None:
+        box_vectors = np.asarray(box_vectors, dtype=float)*ANGSTROM_TO_NM
+        system.setDefaultPeriodicBoxVectors(*(openmm.Vec3(*vec) for vec in box_vectors))
+    elif (
+        (structure := model.parent) is not None and 
+        getattr(structure, 'cell_info', None) is not None
+    ):
+        cell = structure.cell_info
+        system.setDefaultPeriodicBoxVectors(*computePeriodicBoxVectors(
+            *(cell[k]*unit.angstroms for k in ("length_a", "length_b", "length_c")),
+            *(cell[k]*unit.degrees for k in ("angle_alpha", "angle_beta", "angle_gamma"))
+        ))
+
+    _add_bonded_forces(system, arrays, param_loaders)
+    _add_nonbonded_forces(
+        system, arrays, param_loaders, nonbonded_method, nonbonded_cutoff,
+        switch_distance
+    )
+    block_positions = _get_block_positions(
+        arrays['atom_blocks'], getattr(model, 'coord_store', None)
+    )
+    positions = unit.Quantity(value=block_positions, unit=unit.nanometers)
+    return system, positions
@@ -1,7 +1,9 @@
 """Derived Propka Atom class to facilitate atom class conversion for pKa calculation"""
 import os
 import warnings
+from copy import deepcopy
 from typing import Optional, Tuple
+import numpy as np
 from propka.input import read_parameter_file
 from propka.parameters import Parameters
 from propka.version import VersionA
@@ -12,11 +14,74 @@ from propka.hydrogens import setup_bonding_and_protonation
 from propka.atom import Atom as _ppAtom
 from crimm.Modeller import TopologyGenerator
 from crimm.Modeller.TopoFixer import ResidueFixer, fix_chain
+from crimm.Modeller.TopoLoader import ChainTopology
+from crimm.Utils.StructureUtils import get_coord_store
 
 from crimm import Data
 
 dir_path = os.path.dirname(os.path.realpath(Data.__file__))
 
+# initial values of the PropKa atom attributes, the mutable containers
+# (number_of_bonded_elements and bonded_atoms) are created for each atom
+_PROPKA_ATOM_DEFAULTS = {
+    'occ': None, 'numb': None, 'res_name': None, 'type': None,
+    'chain_id': None, 'beta': None, 'icode': None, 'res_num': None,
+    'name': None, 'element': None, 'x': None, 'y': None, 'z': None,
+    'group': None, 'group_type': None, 'cysteine_bridge': False,
+    'residue': None, 'conformation_container': None,
+    'molecular_container': None, 'is_protonated': False,
+    'steric_num_lone_pairs_set': False, 'terminal': None, 'charge': 0,
+    'charge_set': False, 'steric_number': 0, 'number_of_lone_pairs': 0,
+    'number_of_protons_to_add': 0, 'num_pi_elec_2_3_bonds': 0,
+    'num_pi_elec_conj_2_3_bonds': 0, 'groups_extracted': 0,
+    # ligand atom types
+    'sybyl_type': '', 'sybyl_assigned': False, 'marvin_pka': False,
+}
+
+def get_propka_atom_columns(chain, keep_protons=False):
+    """Return the atom properties of a chain needed by PropKa as a dict of 
+    columns (lists of equal length, and an (N, 3) coordinate array). The 
+    residue properties are looked up once per residue, and the coordinates 
+    are gathered from the coordinate store of the model if attached. Only 
+    the selected child of disordered atoms is included, and hydrogens are 
+    excluded unless keep_protons is True."""
+    atoms = []
+    res_num, res_name, atom_type, icode = [], [], [], []
+    for residue in chain:
+        hetflag, resseq, cur_icode = residue.id
+        cur_type = 'atom' if hetflag == ' ' else 'hetatom'
+        n_atoms = len(atoms)
+        for atom in residue.get_atoms():
+            if not keep_protons and atom.element == 'H':
+                continue
+            atoms.append(atom)
+        n_added = len(atoms) - n_atoms
+        res_num.extend([resseq]*n_added)
+        res_name.extend([residue.resname]*n_added)
+        atom_type.extend([cur_type]*n_added)
+        icode.extend([cur_icode]*n_added)
+
+    coords = None
+    if (store := get_coord_store(chain)) is not None:
+        rows = store.get_rows(atoms)
+        if np.all(rows >= 0):
+            coords = store.coords[rows]
+    if coords is None:
+        coords = np.array([atom.coord for atom in atoms], dtype=float)
+    return {
+        'name': [atom.name for atom in atoms],
+        'numb': [atom.serial_number for atom in atoms],
+        'coords': coords.reshape(-1, 3),
+        'res_num': res_num,
+        'res_name': res_name,
+        'chain_id': [chain.id]*len(atoms),
+        'type': atom_type,
+        'occ': [atom.occupancy for atom in atoms],
+        'beta': [atom.bfactor for atom in atoms],
+        'element': [atom.element for atom in atoms],
+        'icode': icode,
+    }
+
 class PropKaAtom(_ppAtom):
     """PropKa Atom class - contains all atom information found in the PDB file
 
@@ -26,53 +91,56 @@ class PropKaAtom(_ppAtom):
        removed as reading/writing PROPKA input is no longer supported.
     """
 
-    def __init__(self, biopython_atom):
+    def __init__(self, biopython_atom=None):
         """Initialize the Atom object. This method overwrite the default 
         init method from the super class
 
         Args:
-            line:  Line from a PDB file to set properties of atom.
+            biopython_atom: Biopython Atom to set properties of atom. If None,
+                the properties are left unset (see from_columns).
         """
-        self.occ = None
-        self.numb = None
-        self.res_name = None
-        self.type = None
-        self.chain_id = None
-        self.beta = None
-        self.icode = None
-        self.res_num = None
-        self.name = None
-        self.element = None
-        self.x = None
-        self.y = None
-        self.z = None
-        self.group = None
-        self.group_type = None
+        self.__dict__.update(_PROPKA_ATOM_DEFAULTS)
         self.number_of_bonded_elements = {}
-        self.cysteine_bridge = False
         self.bonded_atoms = []
-        self.residue = None
-        self.conformation_container = None
-        self.molecular_container = None
-        self.is_protonated = False
-        self.steric_num_lone_pairs_set = False
-        self.terminal = None
-        self.charge = 0
-        self.charge_set = False
-        self.steric_number = 0
-        self.number_of_lone_pairs = 0
-        self.number_of_protons_to_add = 0
-        self.num_pi_elec_2_3_bonds = 0
-        self.num_pi_elec_conj_2_3_bonds = 0
-        self.groups_extracted = 0
-        self.set_properties_from_biopython_atom(biopython_atom)
+        if biopython_atom is not None:
+            self.set_properties_from_biopython_atom(biopython_atom)
+            self._set_residue_label()
+
+    def _set_residue_label(self):
         fmt = "{r.name:3s}{r.res_num:>4d}{r.chain_id:>2s}"
         self.residue_label = fmt.format(r=self)
 
-        # ligand atom types
-        self.sybyl_type = ''
-        self.sybyl_assigned = False
-        self.marvin_pka = False
+    @classmethod
+    def from_columns(cls, columns):
+        """Create the PropKa atoms from the atom columns of a chain (see 
+        get_propka_atom_columns) without accessing the Biopython atoms."""
+        pka_atoms = []
+        for (
+            name, numb, (x, y, z), res_num, res_name, chain_id, 
+            atom_type, occ, beta, element, icode
+        ) in zip(
+            columns['name'], columns['numb'], columns['coords'].tolist(),
+            columns['res_num'], columns['res_name'], columns['chain_id'],
+            columns['type'], columns['occ'], columns['beta'],
+            columns['element'], columns['icode']
+        ):
+            pka_atom = cls()
+            pka_atom.name = name
+            pka_atom.numb = numb
+            pka_atom.x, pka_atom.y, pka_atom.z = x, y, z
+            pka_atom.res_num = res_num
+            pka_atom.res_name = res_name
+            pka_atom.chain_id = chain_id
+            pka_atom.type = atom_type
+            pka_atom.occ = occ
+            pka_atom.beta = beta
+            pka_atom.element = element
+            pka_atom.icode = icode
+            pka_atom.residue_label = (
+                f"{name:3s}{res_num:>4d}{chain_id:>2s}"
+            )
+            pka_atoms.append(pka_atom)
+        return pka_atoms
 
     def set_properties_from_biopython_atom(self, bp_atom):
         """Set properties of propKa atom from a Biopython Atom.
@@ -171,6 +239,8 @@ class PropKaProtonator:
         self.model = None
         self.conf_container = None
         self.reportable_groups = None
+        # (chain_id, resseq, resname, pKa) of the computed titratable groups
+        self.pka_table = None
         self.topo = topology_loader
         self.param = self.topo.param_dict['protein']
 
@@ -220,11 +290,10 @@ class PropKaProtonator:
     def add_chain_to_conf_container(self, chain):
         """Add all atoms from a chain to the ConformationContainer. Terminal atom
         will be labeled accordingly."""
-        pka_atoms = []
-        for atom in chain.get_atoms():
-            if not self.keep_protons and atom.element == 'H':
-                continue
-            pka_atoms.append(PropKaAtom(atom))
+        columns = get_propka_atom_columns(chain, self.keep_protons)
+        pka_atoms = PropKaAtom.from_columns(columns)
+        if not pka_atoms:
+            return
         # label NTER and CTER
         if pka_atoms[0].element == 'N':
             pka_atoms[0].terminal = 'N+'
@@ -234,22 +303,66 @@ class PropKaProtonator:
             self.conf_container.add_atom(pka_atom)
 
     def _get_patch_name(self):
-        self.patches = {}
         self.reportable_groups = {}
+        self.pka_table = []
         for g in self.conf_container.groups:
             resname, _, chain_id = g.label.split()
             resseq = g.atom.res_num
-            if chain_id not in self.patches:
-                self.patches[chain_id] = {}
+            if chain_id not in self.reportable_groups:
                 self.reportable_groups[chain_id] = {}
             if g.pka_value == 0.0:
                 continue
             self.reportable_groups[chain_id][resseq] = g
+            self.pka_table.append((chain_id, resseq, resname, g.pka_value))
+        self.patches = self.get_patches(self.pH)
+
+    def get_patches(self, pH):
+        """Return the protonation patches {chain_id: {resseq: patch_name}} at
+        the given pH from the computed pKa values. No pKa calculation is 
+        done, so the patches for several pH values come from one load_model
+        call."""
+        if self.pka_table is None:
+            raise ValueError('No pKa values computed! Use load_model() first.')
+        patches = {chain_id: {} for chain_id in self.reportable_groups}
+        for chain_id, resseq, resname, pka in self.pka_table:
             if resname not in self.protonation_dict:
                 continue
             eval_function, patch_name = self.protonation_dict[resname]
-            if eval_function(self.pH, g.pka_value):
-                self.patches[chain_id][resseq] = patch_name
+            if eval_function(pH, pka):
+                patches[chain_id][resseq] = patch_name
+        return patches
+
+    def set_pH(self, pH):
+        """Set the pH and update the patches from the computed pKa values."""
+        self.pH = pH
+        self.patches = self.get_patches(pH)
+
+    def _copy_model(self):
+        """Deep copy the loaded model, sharing the topology definitions and
+        the topology generator, and leaving out the parent structure."""
+        model = self.model
+        memo = {}
+        if model.parent is not None:
+            memo[id(model.parent)] = None
+        if (topology_loader := getattr(model, 'topology_loader', None)) is not None:
+            memo[id(topology_loader)] = topology_loader
+        for chain in model:
+            for obj in model._get_shared_templates(chain):
+                memo[id(obj)] = obj
+        return deepcopy(model, memo)
+
+    def protonate_at(self, pH_values):
+        """Protonate copies of the loaded model at each pH value with one pKa
+        calculation. The loaded model itself is not modified. Return a dict
+        of the protonated models keyed by pH."""
+        if self.model is None:
+            raise ValueError('No model loaded! Use load_model() first.')
+        protonated = {}
+        for pH in pH_values:
+            model = self._copy_model()
+            self.apply_patches(model=model, patches=self.get_patches(pH))
+            protonated[pH] = model
+        return protonated
 
     def _patch_residue(self, residue, patch_name:str):
         fixer = ResidueFixer()
@@ -264,23 +377,35 @@ class PropKaProtonator:
         fixer.build_hydrogens()
         fixer.remove_undefined_atoms()
 
-    def apply_patches(self):
-        """Apply patches to the model."""
-        for chain_id, patches in self.patches.items():
-            if len(patches) == 0:
+    def apply_patches(self, model=None, patches=None):
+        """Apply patches to the model. By default, the patches at the current
+        pH are applied to the loaded model. A copy of the loaded model (with 
+        the same chain ids and residue numbers) and the patches from 
+        get_patches can be provided instead."""
+        if model is None:
+            model = self.model
+        if patches is None:
+            patches = self.patches
+        for chain_id, chain_patches in patches.items():
+            if len(chain_patches) == 0:
                 print(f"No protonation patches to apply on chain {chain_id}.")
                 continue
-            for resseq, patch_name in patches.items():
-                residue = self.model[chain_id][resseq]
+            chain = model[chain_id]
+            patched_residues = []
+            for resseq, patch_name in chain_patches.items():
+                residue = chain[resseq]
                 self._patch_residue(residue, patch_name)
                 # Update residue name for HIS
                 if residue.resname == 'HIS':
                     residue.resname = residue.topo_definition.resname
-            chain = self.model[chain_id]
-            if chain.topology is not None:
+                patched_residues.append(residue)
+            if isinstance(chain.topology, ChainTopology):
+                # Update the topology elements of the patched residues only
+                chain.topology.update_residues(patched_residues, self.param)
+            elif chain.topology is not None:
                 # Update topology elements if they are already defined
                 chain.topology.update()
-            print(f"Protonation patches applied on chain {chain_id}:\n{patches}")
+            print(f"Protonation patches applied on chain {chain_id}:\n{chain_patches}")
 
     def report(self):
         fmt = (
@@ -31,6 +31,7 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 import warnings
+import hashlib
 import requests, json
 from crimm.Fetchers import fetch_rcsb_as_dict
 from crimm.IO.PDBString import get_pdb_str
@@ -204,6 +205,29 @@ def _generate_mol2_atom_name(atom, atom_counts: dict):
     atom_name = f"{symbol}{atom_counts[symbol]}"
     return atom_name
 
+def get_mol_content_key(mol, ligname, salt=''):
+    """Return a content key (SHA-256 hex digest) of a ligand for caching its
+    generated parameters. The key is built from the canonical isomeric SMILES,
+    the ligand name and the mol2 atom names in canonical atom order, so it does
+    not depend on the coordinates or the atom order of the entry, but changes
+    if the atoms are named differently. The salt (e.g. the identity of the
+    parameterization program) is included in the key."""
+    atom_counts = {}
+    atom_names = []
+    for atom in mol.GetAtoms():
+        if pdbinfo := atom.GetPDBResidueInfo():
+            atom_names.append(pdbinfo.GetName().strip())
+        else:
+            atom_names.append(_generate_mol2_atom_name(atom, atom_counts))
+    ranks = Chem.CanonicalRankAtoms(mol, breakTies=True)
+    canonical_names = [
+        name for _, name in sorted(zip(ranks, atom_names))
+    ]
+    content = '\n'.join((
+        Chem.MolToSmiles(mol), ligname, ' '.join(canonical_names), salt
+    ))
+    return hashlib.sha256(content.encode('utf-8')).hexdigest()
+
 def MolToMol2Block(mol, ligname = None):
     """Write a mol2 block string from a RDKit Mol Object."""
     if ligname is None:
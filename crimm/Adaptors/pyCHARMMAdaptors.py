@@ -14,14 +14,132 @@ from pycharmm.generate import patch as charmm_patch
 from pycharmm.psf import get_natom, delete_atoms
 from Bio.PDB.Selection import unfold_entities
 from crimm.IO.PDBString import get_pdb_str
-from crimm.IO import write_psf, write_crd
+from crimm.IO import PSFWriter, write_crd
 from crimm.StructEntities.Residue import Heterogen
 from crimm.Data.components_dict import nucleic_letters_1to3
 
+# atom maps of the entities loaded into the CHARMM runtime by _load_psf_crd
+_charmm_atom_maps = []
+
 def empty_charmm():
     """If any atom exists in current CHARMM runtime, remove them."""
     if get_natom() > 0:
         delete_atoms()
+    _charmm_atom_maps.clear()
+
+
+class CharmmAtomMap:
+    """Persistent map between the atoms of a crimm entity and their (0-indexed)
+    atom indices in the CHARMM runtime.
+
+    The map is built from the atom order of the PSF file the entity is loaded 
+    with, so coordinate synchronization is a single gather (fetch_coords) or 
+    scatter (push_coords) on the CHARMM position array, without matching the 
+    atoms by SEGID, residue and atom names. The map needs to be rebuilt (by
+    loading the entity again) if atoms are added to or removed from the entity.
+
+    Parameters
+    ----------
+    entity : Model, Chain, or Residue
+        The entity loaded into CHARMM
+    atom_blocks : list
+        The atom blocks from PSFWriter.get_atom_blocks()
+    offset : int, default 0
+        Number of CHARMM atoms before the entity (when appended to a PSF)
+    """
+    def __init__(self, entity, atom_blocks, offset=0):
+        self.entity = entity
+        self.atoms = []
+        atom_indices = []
+        # array-backed solvent chains and their first atom index
+        self.bulk_blocks = []
+        for start, block in atom_blocks:
+            start = start - 1 + offset
+            if getattr(block, 'is_array_backed', False):
+                self.bulk_blocks.append((block, start))
+                continue
+            self.atoms.extend(block)
+            atom_indices.append(np.arange(start, start+len(block)))
+        if atom_indices:
+            self.indices = np.concatenate(atom_indices)
+        else:
+            self.indices = np.zeros(0, dtype=int)
+        self.n_charmm_atoms = get_natom()
+        # rows of the atoms in the coordinate store of the entity
+        self._store, self._store_rows = None, None
+
+    def __repr__(self):
+        return (
+            f'<CharmmAtomMap entity={self.entity} atoms={len(self.atoms)} '
+            f'array-backed chains={len(self.bulk_blocks)}>'
+        )
+
+    def is_valid(self):
+        """Check if the number of atoms in CHARMM is unchanged since the map 
+        was built."""
+        return get_natom() == self.n_charmm_atoms
+
+    def _get_store_rows(self):
+        """Return the CoordinateStore of the entity and the store rows of the
+        mapped atoms (-1 for atoms not in the store), or (None, None)."""
+        store = getattr(self.entity, 'coord_store', None)
+        if store is None:
+            return None, None
+        if store is not self._store:
+            self._store = store
+            self._store_rows = store.get_rows(self.atoms)
+        return self._store, self._store_rows
+
+    def fetch_coords(self):
+        """Copy the coordinates from CHARMM to the crimm atoms."""
+        positions = coor.get_positions().to_numpy()
+        atoms, indices = self.atoms, self.indices
+        store, rows = self._get_store_rows()
+        if store is not None:
+            # single scatter into the coordinate store
+            in_store = rows >= 0
+            store.coords[rows[in_store]] = positions[indices[in_store]]
+            atoms = [atom for atom, i in zip(atoms, in_store) if not i]
+            indices = indices[~in_store]
+        for atom, coord in zip(atoms, positions[indices]):
+            atom.coord = coord
+        for chain, start in self.bulk_blocks:
+            chain_pos = positions[start:start+chain.n_atoms]
+            if chain.is_array_backed:
+                chain.coords[:] = chain_pos.reshape(chain.coords.shape)
+            else:
+                # materialized after loading, atoms are in residue order
+                for atom, coord in zip(chain.get_atoms(), chain_pos):
+                    atom.coord = coord
+
+    def push_coords(self):
+        """Copy the coordinates of the crimm atoms to CHARMM."""
+        positions = coor.get_positions()
+        pos_array = positions.to_numpy(dtype=float, copy=True)
+        store, rows = self._get_store_rows()
+        if store is not None:
+            in_store = rows >= 0
+            pos_array[self.indices[in_store]] = store.coords[rows[in_store]]
+            other_atoms = [
+                (atom, i) for atom, i, is_stored
+                in zip(self.atoms, self.indices, in_store) if not is_stored
+            ]
+            for atom, i in other_atoms:
+                pos_array[i] = atom.coord
+        elif self.atoms:
+            pos_array[self.indices] = [atom.coord for atom in self.atoms]
+        for chain, start in self.bulk_blocks:
+            pos_array[start:start+chain.n_atoms] = chain.coords.reshape(-1, 3)
+        positions.iloc[:, :] = pos_array
+        coor.set_positions(positions)
+
+
+def get_charmm_atom_map(entity):
+    """Return the CharmmAtomMap of an entity loaded by PSF/CRD, or None if the
+    entity was not loaded as a whole or the CHARMM atoms have changed since."""
+    for atom_map in _charmm_atom_maps:
+        if atom_map.entity is entity and atom_map.is_valid():
+            return atom_map
 
 
 def _entity_has_lonepairs(entity) -> bool:
@@ -61,7 +179,8 @@ def _load_psf_crd(entity, append=False):
             crd_path = crd_f.name
 
         # Write PSF and CRD files (these functions handle their own file I/O)
-        write_psf(entity, psf_path)
+        psf_writer = PSFWriter()
+        psf_writer.write(entity, psf_path)
         write_crd(entity, crd_path)
 
         # Validate files were written correctly
@@ -71,6 +190,7 @@ def _load_psf_crd(entity, append=False):
             raise RuntimeError(f"CRD file was not written correctly: {crd_path}")
 
         # Load into pyCHARMM
+        offset = get_natom() if append else 0
         read.psf_card(psf_path, append=append)
         read.coor_card(crd_path)
     finally:
@@ -85,6 +205,12 @@ def _load_psf_crd(entity, append=False):
         print("[crimm] Creating lone pair coordinates using COOR SHAKE")
         pcm.lingo.charmm_script("coor shake")
 
+    if not append:
+        _charmm_atom_maps.clear()
+    atom_map = CharmmAtomMap(entity, psf_writer.get_atom_blocks(), offset)
+    _charmm_atom_maps.append(atom_map)
+    return atom_map
+
 
 def load_topology(topo_generator):
     """Load topology and parameter files from a TopoGenerator object."""
@@ -685,7 +811,11 @@ def create_water_hs_from_charmm(model):
         _build_water_with_dicts(missing_h_dict, h_coords_dict[segid])
 
 def fetch_coords_from_charmm(entity):
-    """Fetch coordinates from CHARMM to the entity."""
+    """Fetch coordinates from CHARMM to the entity. If the entity was loaded 
+    by PSF/CRD, the persistent atom map from loading is used."""
+    if (atom_map := get_charmm_atom_map(entity)) is not None:
+        atom_map.fetch_coords()
+        return
     res_list = unfold_entities(entity, 'R')
     all_charmm_atoms = pcm.SelectAtoms().all_atoms()
     charmm_coord_dict = get_charmm_coord_dict(all_charmm_atoms)
@@ -718,6 +848,16 @@ def fetch_coords_from_charmm(entity):
                 )
             atom.coord = charmm_coord_dict[segid][atom_key]
 
+def push_coords_to_charmm(entity):
+    """Push the coordinates of an entity loaded by PSF/CRD to CHARMM."""
+    if (atom_map := get_charmm_atom_map(entity)) is None:
+        raise ValueError(
+            f'No valid CHARMM atom map for {entity}! The entity has to be '
+            'loaded by PSF/CRD (e.g. load_model), and the CHARMM atoms must '
+            'not be changed since.'
+        )
+    atom_map.push_coords()
+
 def minimize(constrained_atoms='CA', sd_nstep=1000, abnr_nstep=500):
     """Simple minimization with harmonic constraints on specified atoms.
 
@@ -1,42 +1,107 @@
 import os
 import io
-import requests
+import gzip
+import tempfile
+import threading
 import warnings
+from concurrent.futures import ThreadPoolExecutor
+import requests
 from Bio.Seq import Seq
 
 from crimm.StructEntities.OrganizedModel import OrganizedModel
 from crimm.IO import MMCIFParser, PDBParser
-from crimm.IO.MMCIF2Dict import MMCIF2Dict
+from crimm.IO.MMCIF2Dict import MMCIF2Dict, LazyMMCIF2Dict
 from crimm.Superimpose.ChainSuperimposer import ChainSuperimposer
 from crimm.Utils.query_db import uniprot_id_query
 
+RCSB_DOWNLOAD_URL = "https://files.rcsb.org/download"
+# number of concurrent downloads in fetch_rcsb_multiple
+FETCH_MAX_WORKERS = 8
+
+_thread_local = threading.local()
+
+def _get_session():
+    """Return the requests session of the current thread. The session keeps
+    the connections alive between requests to the same server."""
+    if not hasattr(_thread_local, 'session'):
+        _thread_local.session = requests.Session()
+    return _thread_local.session
+
+def _get_mirror_dir(mirror_dir = None):
+    """Return the local mirror directory for downloaded entries, which can 
+    also be set by the environment variable CRIMM_PDB_MIRROR."""
+    if mirror_dir is None:
+        mirror_dir = os.environ.get('CRIMM_PDB_MIRROR')
+    return mirror_dir
+
 def _find_local_cif_path(pdb_id, entry_point):
-    """Find the path to a local cif file"""
+    """Find the path to a local cif file (plain or gzipped)"""
     pdb_id = pdb_id.lower()
     subdir = pdb_id[1:3]
-    file_path = os.path.join(entry_point, subdir, pdb_id+'.cif')
-    if os.path.exists(file_path):
+    for ext in ('.cif', '.cif.gz'):
+        file_path = os.path.join(entry_point, subdir, pdb_id+ext)
+        if os.path.exists(file_path):
+            return file_path
+
+def _open_local_cif(file_path):
+    """Return the path of a plain cif file, or a file handle to the decompressed
+    content of a gzipped one"""
+    if file_path is None or not file_path.endswith('.gz'):
         return file_path
+    with gzip.open(file_path, 'rt', encoding='utf-8') as f:
+        return io.StringIO(f.read())
 
-def _file_handle_from_url(cif_url):
-    """Get a cif file from a url, return a file handle to the cif file"""
-    f_handle = io.StringIO()
-    result = requests.get(cif_url,timeout=500)
+def _get_url_content(url):
+    """Return the content from a url as bytes"""
+    result = _get_session().get(url, timeout=500)
     if (code := result.status_code) != 200:
         warnings.warn(
             "GET request for file did not return valid result!\n"
             f"[Status Code] {code}"
         )
         return
-    f_handle.write(result.content.decode('utf-8'))
+    return result.content
+
+def _file_handle_from_url(cif_url):
+    """Get a cif file from a url, return a file handle to the cif file"""
+    content = _get_url_content(cif_url)
+    if content is None:
+        return
+    f_handle = io.StringIO()
+    f_handle.write(content.decode('utf-8'))
     f_handle.seek(0)
     return f_handle
 
+def _fetch_to_mirror(pdb_id, mirror_dir):
+    """Download the gzipped mmcif file of an entry into the local mirror, laid 
+    out as the PDB archive (<mirror_dir>/<id[1:3]>/<id>.cif.gz), and return its 
+    path. Entries already in the mirror are not downloaded again."""
+    if (file_path := _find_local_cif_path(pdb_id, mirror_dir)) is not None:
+        return file_path
+    pdb_id = pdb_id.lower()
+    content = _get_url_content(f"{RCSB_DOWNLOAD_URL}/{pdb_id}.cif.gz")
+    if content is None:
+        return
+    subdir = os.path.join(mirror_dir, pdb_id[1:3])
+    os.makedirs(subdir, exist_ok=True)
+    file_path = os.path.join(subdir, pdb_id+'.cif.gz')
+    # write atomically, concurrent fetches of the same entry never see a
+    # partially written file
+    fd, tmp_path = tempfile.mkstemp(dir=subdir, suffix='.tmp')
+    try:
+        with os.fdopen(fd, 'wb') as f:
+            f.write(content)
+        os.replace(tmp_path, file_path)
+    except BaseException:
+        os.unlink(tmp_path)
+        raise
+    return file_path
+
 def _get_alphafold_fh(uniprot_id):
     """Get a mmcif file handle from the alphafold database for a given uniprot id
     """
     query_url = f"https://alphafold.ebi.ac.uk/api/prediction/{uniprot_id}"
-    response = requests.get(query_url, timeout=500)
+    response = _get_session().get(query_url, timeout=500)
     if (code := response.status_code) != 200:
         warnings.warn(
             f"GET request on AlphaFold DB for \"{uniprot_id}\"  did not return "
@@ -82,11 +147,35 @@ def _get_mmcif_fh(pdb_id):
     rcsb_cif_url = f"{entry_point}/{pdb_id}.cif"
     return _file_handle_from_url(rcsb_cif_url)
 
-def fetch_rcsb_as_dict(pdb_id):
-    """Get info about a pdb entry as a dictionary from rcsb"""
-    file = _get_mmcif_fh(pdb_id)
+def _get_rcsb_file(pdb_id, local_entry = None, mirror_dir = None):
+    """Return the path or a file handle of the mmcif file of an entry, from the
+    local PDB archive, the local mirror, or downloaded from rcsb"""
+    if local_entry is not None:
+        return _open_local_cif(_find_local_cif_path(pdb_id, local_entry))
+    mirror_dir = _get_mirror_dir(mirror_dir)
+    if mirror_dir is not None and len(pdb_id) == 4:
+        return _open_local_cif(_fetch_to_mirror(pdb_id, mirror_dir))
+    return _get_mmcif_fh(pdb_id)
+
+def fetch_rcsb_as_dict(pdb_id, local_entry = None, lazy = False, mirror_dir = None):
+    """Get info about a pdb entry as a dictionary from rcsb or from a local 
+    mmcif file
+    Args:
+        pdb_id (str): The pdb id of the entry to fetch
+        local_entry (str): The path to the local mmcif file entry point if the 
+            PDB archive is downloaded.
+        lazy (bool): Whether to return a LazyMMCIF2Dict, where categories are 
+            only decoded when accessed. This avoids parsing the atom_site loop 
+            for metadata-only queries (e.g. entity_poly, resolution).
+        mirror_dir (str): The directory of the local mirror where downloaded 
+            entries are kept (defaults to the environment variable 
+            CRIMM_PDB_MIRROR, no mirror if not set).
+    """
+    file = _get_rcsb_file(pdb_id, local_entry, mirror_dir)
     if file is None:
         raise ValueError(f"Could not load file for {pdb_id}")
+    if lazy:
+        return LazyMMCIF2Dict(file)
     cifdict = MMCIF2Dict(file)
     return cifdict
 
@@ -100,6 +189,8 @@ def fetch_rcsb(
         organize = False,
         rename_charmm_ions=True,
         rename_solvent_oxygen=True,
+        mirror_dir = None,
+        expand_bio_assembly = True,
     ):
     """Get a structure from rcsb with a pdb id or from a local mmcif file
     Args:
@@ -125,20 +216,37 @@ def fetch_rcsb(
         name "OH2" in the crystallographic water. Doing so will allow crimm to 
          generate topology definitions on the water. This only takeseffect 
          if `organize` is True
+        mirror_dir (str): The directory of the local mirror where downloaded 
+            entries are kept as gzipped mmcif files (defaults to the environment
+            variable CRIMM_PDB_MIRROR, no mirror if not set).
+        expand_bio_assembly (bool): Whether to create the copies of the bio 
+            assembly right away. Otherwise, the model is the asymmetric unit 
+            holding the pending assembly operations, and the copies are 
+            created by `model.expand_assembly()`. Only takes effect if 
+            `use_bio_assembly` is True
     Returns:
         structure (Structure): The structure object
     """
     if len(pdb_id) == 3:
         raise ValueError("Ligand entries are not supported yet!")
-    if local_entry is not None:
-        file = _find_local_cif_path(pdb_id, entry_point = local_entry)
-    else:
-        file = _get_mmcif_fh(pdb_id)
+    file = _get_rcsb_file(pdb_id, local_entry, mirror_dir)
+    return _structure_from_rcsb_file(
+        pdb_id, file, first_model_only, use_bio_assembly, include_solvent,
+        include_hydrogens, organize, rename_charmm_ions, rename_solvent_oxygen,
+        expand_bio_assembly
+    )
+
+def _structure_from_rcsb_file(
+        pdb_id, file, first_model_only, use_bio_assembly, include_solvent,
+        include_hydrogens, organize, rename_charmm_ions, rename_solvent_oxygen,
+        expand_bio_assembly=True
+    ):
     if file is None:
         raise ValueError(f"Could not load file for {pdb_id}")
     parser = MMCIFParser(
         first_model_only = first_model_only,
         use_bio_assembly = use_bio_assembly,
+        expand_bio_assembly = expand_bio_assembly,
         include_hydrogens = include_hydrogens,
         include_solvent=include_solvent
     )
@@ -152,6 +260,52 @@ def fetch_rcsb(
             )
     return structure
 
+def fetch_rcsb_multiple(
+        pdb_ids,
+        local_entry = None,
+        mirror_dir = None,
+        n_workers = FETCH_MAX_WORKERS,
+        first_model_only = True,
+        use_bio_assembly = True,
+        include_solvent = True,
+        include_hydrogens = False,
+        organize = False,
+        rename_charmm_ions=True,
+        rename_solvent_oxygen=True,
+        expand_bio_assembly = True,
+    ):
+    """Get structures for a list of pdb ids from rcsb or from a local mmcif 
+    entry point. The files are downloaded concurrently by up to n_workers 
+    threads, and each structure is parsed as soon as its file has arrived, 
+    while the remaining downloads are still pending.
+    Args:
+        pdb_ids (list): The pdb ids of the structures to fetch
+        n_workers (int): The maximum number of concurrent downloads
+        The other arguments are the same as in `fetch_rcsb`.
+    Returns:
+        A generator of (pdb_id, structure) in the order of pdb_ids
+    """
+    pdb_ids = list(pdb_ids)
+    for pdb_id in pdb_ids:
+        if len(pdb_id) == 3:
+            raise ValueError("Ligand entries are not supported yet!")
+    executor = ThreadPoolExecutor(max_workers=max(1, n_workers))
+    try:
+        futures = [
+            executor.submit(_get_rcsb_file, pdb_id, local_entry, mirror_dir)
+            for pdb_id in pdb_ids
+        ]
+        for pdb_id, future in zip(pdb_ids, futures):
+            structure = _structure_from_rcsb_file(
+                pdb_id, future.result(), first_model_only, use_bio_assembly,
+                include_solvent, include_hydrogens, organize,
+                rename_charmm_ions, rename_solvent_oxygen, expand_bio_assembly
+            )
+            yield pdb_id, structure
+    finally:
+        # drop the pending downloads if the generator is closed early
+        executor.shutdown(wait=False, cancel_futures=True)
+
 def fetch_swiss_model(uniprot_id, first_model_only = False):
     """Get the first matching stucuture from the Swiss Model database for a given 
     uniprot id
@@ -162,7 +316,7 @@ def fetch_swiss_model(uniprot_id, first_model_only = False):
     )
     header_url = base_url.format(uniprot_id = uniprot_id, ext = 'json')
     struct_url = base_url.format(uniprot_id = uniprot_id, ext = 'pdb')
-    result = requests.get(header_url,timeout=500)
+    result = _get_session().get(header_url,timeout=500)
     if (code := result.status_code) != 200:
         warnings.warn(
             "GET request for header did not return valid result!\n"
@@ -197,7 +351,7 @@ def fetch_swiss_model_multiple(uniprot_id, first_model_only = False):
         f"https://swissmodel.expasy.org/repository/uniprot/{uniprot_id}.json"
         "?provider=swissmodel"
     )
-    result = requests.get(header_url,timeout=500)
+    result = _get_session().get(header_url,timeout=500)
     if (code := result.status_code) != 200:
         warnings.warn(
             "GET request for header did not return valid result!\n"
@@ -11,6 +11,7 @@ Format specification (from CHARMM source io/coorio.F90):
 """
 
 from typing import Union, List
+import numpy as np
 from crimm.StructEntities import Model, Structure, Chain, Residue, Atom
 
 # Extended format (EXT) - for systems with >99999 atoms
@@ -62,6 +63,58 @@ def _get_atoms_from_entity(entity, include_lonepairs: bool = True) -> List[Atom]
     return atoms
 
 
+def _get_atom_blocks(entity, include_lonepairs: bool = True) -> list:
+    """Split the atoms of an entity into blocks for writing.
+
+    Array-backed solvent chains are returned as is, so that their lines can be
+    generated from the coordinate arrays. All other atoms are returned as lists
+    in the same order as _get_atoms_from_entity, with lone pairs at the end.
+
+    Parameters
+    ----------
+    entity : Model, Structure, Chain, or Residue
+        The entity to extract atoms from
+    include_lonepairs : bool
+        Whether to include lone pair pseudo-atoms for CGENFF ligands
+
+    Returns
+    -------
+    list
+        List of atom lists and array-backed solvent chains in order
+    """
+    level = getattr(entity, 'level', None)
+    if level == 'S':
+        chains = [chain for model in entity for chain in model]
+    elif level == 'M':
+        chains = list(entity)
+    elif level == 'C':
+        chains = [entity]
+    else:
+        return [_get_atoms_from_entity(entity, include_lonepairs)]
+
+    blocks = []
+    atoms = []
+    for chain in chains:
+        if getattr(chain, 'is_array_backed', False):
+            if atoms:
+                blocks.append(atoms)
+                atoms = []
+            blocks.append(chain)
+        else:
+            atoms.extend(chain.get_atoms())
+
+    if include_lonepairs:
+        for chain in chains:
+            if getattr(chain, 'is_array_backed', False):
+                continue
+            for residue in chain.get_residues():
+                if hasattr(residue, 'lone_pair_dict') and residue.lone_pair_dict:
+                    atoms.extend(residue.lone_pair_dict.values())
+    if atoms:
+        blocks.append(atoms)
+    return blocks
+
+
 def _generate_system_info(entity) -> list:
     """Generate informative title lines from entity metadata.
 
@@ -170,9 +223,9 @@ def _generate_system_info(entity) -> list:
         for chain in model:
             chain_type = getattr(chain, 'chain_type', 'Unknown')
             if chain_type == 'Solvent':
-                n_waters = len(list(chain.get_residues()))
+                n_waters = len(chain)
             elif chain_type == 'Ion':
-                n_ions = len(list(chain.get_residues()))
+                n_ions = len(chain)
 
     # Check for solvation metadata (salt concentration, preserved waters)
     solvation_info = []
@@ -268,6 +321,56 @@ def _format_title_lines(title: str = "", entity=None) -> str:
     return "".join(lines)
 
 
+def _get_bulk_solvent_lines(
+    chain, atom_fmt: str, str_width: int, first_serial: int,
+    first_resno: int, reset_serial: bool
+) -> List[str]:
+    """Format the atom lines of an array-backed solvent chain directly from
+    its coordinate and residue number arrays."""
+    coords = chain.coords
+    if not np.isfinite(coords).all():
+        res_i, atom_j = np.argwhere(~np.isfinite(coords).all(axis=-1))[0]
+        raise ValueError(
+            f"Atom {chain.atom_names[atom_j]} of residue {chain.resseqs[res_i]} "
+            f"in chain {chain.id} has invalid coordinates: "
+            f"{tuple(coords[res_i, atom_j])}. Coordinates must be finite numbers."
+        )
+    if not reset_serial and chain.serial_start is not None:
+        first_serial = chain.serial_start
+    template = chain.template
+    resname = template.resname[:str_width]
+    segid = (chain.segid or "")[:str_width]
+    template_info = [
+        (
+            atom.name[:str_width],
+            atom.bfactor if atom.bfactor is not None else 0.0
+        )
+        for atom in template.get_atoms()
+    ]
+    lines = []
+    serial = first_serial
+    for i, (resseq, res_coords) in enumerate(
+        zip(chain.resseqs.tolist(), coords.tolist())
+    ):
+        resid = str(resseq)[:str_width]
+        resno = first_resno + i
+        for (atomname, weight), (x, y, z) in zip(template_info, res_coords):
+            lines.append(atom_fmt.format(
+                serial=serial,
+                resno=resno,
+                resname=resname,
+                atomname=atomname,
+                x=x,
+                y=y,
+                z=z,
+                segid=segid,
+                resid=resid,
+                weight=weight
+            ))
+            serial += 1
+    return lines
+
+
 def get_crd_str(
     entity: Union[Model, Structure, Chain, Residue],
     extended: bool = True,
@@ -296,8 +399,11 @@ def get_crd_str(
         CRD format string
     """
     # Get atoms
-    atoms = _get_atoms_from_entity(entity, include_lonepairs)
-    natom = len(atoms)
+    blocks = _get_atom_blocks(entity, include_lonepairs)
+    natom = sum(
+        len(block) if isinstance(block, list) else block.n_atoms
+        for block in blocks
+    )
 
     if natom == 0:
         raise ValueError("No atoms found in entity")
@@ -325,66 +431,81 @@ def get_crd_str(
     # RESNO in CRD format must be sequential across the entire system (1, 2, 3...)
     # while RESID is the segment-local residue identifier
     resno_map = {}  # Maps residue object to global resno
+    bulk_resno_start = {}  # Maps array-backed chain to its first resno
     global_resno = 1
     last_residue = None
 
-    for atom in atoms:
-        residue = atom.parent
-        if residue is not last_residue and residue is not None:
-            if residue not in resno_map:
-                resno_map[residue] = global_resno
-                global_resno += 1
-            last_residue = residue
+    for block in blocks:
+        if not isinstance(block, list):
+            bulk_resno_start[block] = global_resno
+            global_resno += len(block)
+            continue
+        for atom in block:
+            residue = atom.parent
+            if residue is not last_residue and residue is not None:
+                if residue not in resno_map:
+                    resno_map[residue] = global_resno
+                    global_resno += 1
+                last_residue = residue
 
     # Atom lines
-    for idx, atom in enumerate(atoms, start=1):
-        serial = idx if reset_serial else (atom.serial_number or idx)
-
-        # Get parent residue info
-        residue = atom.parent
-        if residue is not None:
-            resname = residue.resname[:str_width]
-            segid = (residue.segid or "")[:str_width]
-            # Use global sequential RESNO for CHARMM compatibility
-            resno = resno_map.get(residue, 1)
-            # RESID is the segment-local residue ID as string
-            resid = str(residue.id[1])[:str_width]
-        else:
-            resname = "UNK"[:str_width]
-            segid = ""[:str_width]
-            resno = 1
-            resid = "1"[:str_width]
-
-        atomname = atom.name[:str_width]
-
-        # Get coordinates
-        if atom.coord is None:
-            raise ValueError(f"Atom {atom.name} (serial {serial}) has no coordinates")
-        x, y, z = atom.coord
-
-        # Validate coordinates are finite numbers
-        import numpy as np
-        if not all(np.isfinite([x, y, z])):
-            raise ValueError(
-                f"Atom {atom.name} (serial {serial}) has invalid coordinates: "
-                f"({x}, {y}, {z}). Coordinates must be finite numbers."
-            )
-
-        # Weight/temperature factor
-        weight = atom.bfactor if atom.bfactor is not None else 0.0
-
-        lines.append(atom_fmt.format(
-            serial=serial,
-            resno=resno,
-            resname=resname,
-            atomname=atomname,
-            x=x,
-            y=y,
-            z=z,
-            segid=segid,
-            resid=resid,
-            weight=weight
-        ))
+    idx = 0
+    for block in blocks:
+        if not isinstance(block, list):
+            lines.extend(_get_bulk_solvent_lines(
+                block, atom_fmt, str_width, idx + 1,
+                bulk_resno_start[block], reset_serial
+            ))
+            idx += block.n_atoms
+            continue
+        for atom in block:
+            idx += 1
+            serial = idx if reset_serial else (atom.serial_number or idx)
+
+            # Get parent residue info
+            residue = atom.parent
+            if residue is not None:
+                resname = residue.resname[:str_width]
+                segid = (residue.segid or "")[:str_width]
+                # Use global sequential RESNO for CHARMM compatibility
+                resno = resno_map.get(residue, 1)
+                # RESID is the segment-local residue ID as string
+                resid = str(residue.id[1])[:str_width]
+            else:
+                resname = "UNK"[:str_width]
+                segid = ""[:str_width]
+                resno = 1
+                resid = "1"[:str_width]
+
+            atomname = atom.name[:str_width]
+
+            # Get coordinates
+            if atom.coord is None:
+                raise ValueError(f"Atom {atom.name} (serial {serial}) has no coordinates")
+            x, y, z = atom.coord
+
+            # Validate coordinates are finite numbers
+            if not all(np.isfinite([x, y, z])):
+                raise ValueError(
+                    f"Atom {atom.name} (serial {serial}) has invalid coordinates: "
+                    f"({x}, {y}, {z}). Coordinates must be finite numbers."
+                )
+
+            # Weight/temperature factor
+            weight = atom.bfactor if atom.bfactor is not None else 0.0
+
+            lines.append(atom_fmt.format(
+                serial=serial,
+                resno=resno,
+                resname=resname,
+                atomname=atomname,
+                x=x,
+                y=y,
+                z=z,
+                segid=segid,
+                resid=resid,
+                weight=weight
+            ))
 
     return "".join(lines)
 
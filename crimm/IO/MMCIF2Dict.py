@@ -1,15 +1,212 @@
+import re
+import io
 from collections import namedtuple
 import numpy
-from Bio.PDB.MMCIF2Dict import MMCIF2Dict as _MMCIF2Dict
+
+# Start of a category: an optional "loop_" line followed by the first tag line.
+# The first alternative matches a whole semicolon-delimited text field, so
+# that tag and data_ lines inside multi-line values are skipped (group 1 is
+# None for these matches).
+_CATEGORY_START_RE = re.compile(
+    r"^;.*?\r?\n;|^(?:loop_[ \t]*\r?\n)?(_[^.\s]+)\.", re.M | re.I | re.S
+)
+_CATEGORY_START_RE_B = re.compile(
+    rb"^;.*?\r?\n;|^(?:loop_[ \t]*\r?\n)?(_[^.\s]+)\.", re.M | re.I | re.S
+)
+_DATA_BLOCK_RE = re.compile(r"^;.*?\r?\n;|^data_(\S*)", re.M | re.S)
+_DATA_BLOCK_RE_B = re.compile(rb"^;.*?\r?\n;|^data_(\S*)", re.M | re.S)
+
+# A quoted token only terminates at a quote followed by whitespace (or line end),
+# and a comment only starts at the beginning of a token
+_TOKEN_RE = re.compile(r"""'(.*?)'(?=\s|$)|"(.*?)"(?=\s|$)|(#.*)|(\S+)""")
+
+def _split_line(line):
+    """Split a line of mmCIF into tokens following the STAR/CIF quoting rules"""
+    if "'" not in line and '"' not in line and '#' not in line:
+        # fast path for the vast majority of loop rows
+        return line.split()
+    tokens = []
+    for single_q, double_q, comment, bare in _TOKEN_RE.findall(line):
+        if comment:
+            break
+        tokens.append(single_q or double_q or bare)
+    return tokens
+
+def _iter_token_lines(handle):
+    """Yield the tokens of a mmCIF file line by line. Semicolon-delimited text
+    fields are yielded as a single token joined by newlines."""
+    text_buffer = None
+    for line in handle:
+        line = line.rstrip('\r\n')
+        if text_buffer is not None:
+            if not line.startswith(';'):
+                text_buffer.append(line.rstrip())
+                continue
+            tokens = ['\n'.join(text_buffer)]
+            text_buffer = None
+            tokens.extend(_split_line(line[1:]))
+        elif line.startswith(';'):
+            text_buffer = [line[1:].rstrip()]
+            continue
+        else:
+            tokens = _split_line(line)
+        if tokens:
+            yield tokens
+
+def _is_tag(token):
+    return token.startswith('_') or token.lower() == 'loop_' or token[:5] == 'data_'
+
+def _read_raw_cif(handle):
+    """Read the first data block of a mmCIF file into a flat dictionary of
+    {tag: [str values]} in one pass. Loop bodies are collected as one flat token
+    list and sliced into columns once the loop ends."""
+    raw = {}
+    loop_tags = None
+    loop_values = None
+    pending_tag = None
+
+    def close_loop():
+        n_tags = len(loop_tags)
+        for i, tag in enumerate(loop_tags):
+            raw[tag] = loop_values[i::n_tags]
+
+    for tokens in _iter_token_lines(handle):
+        if loop_values is not None and not _is_tag(tokens[0]):
+            # fast path: the whole row belongs to the loop body
+            loop_values.extend(tokens)
+            continue
+        for token in tokens:
+            if loop_values is not None:
+                if not (_is_tag(token) and len(loop_values) % len(loop_tags) == 0):
+                    loop_values.append(token)
+                    continue
+                close_loop()
+                loop_tags = loop_values = None
+            if loop_tags is not None and token.startswith('_'):
+                loop_tags.append(token)
+            elif loop_tags is not None:
+                loop_values = [token]
+            elif pending_tag is not None:
+                raw[pending_tag] = [token]
+                pending_tag = None
+            elif token.lower() == 'loop_':
+                loop_tags = []
+            elif token[:5] == 'data_':
+                if 'data_' in raw:
+                    # only the first data block is read
+                    return raw
+                raw['data_'] = token[5:]
+            else:
+                pending_tag = token
+    if loop_values is not None:
+        close_loop()
+    return raw
+
+def _open_cif(filename):
+    if hasattr(filename, 'read'):
+        return filename, False
+    return open(filename, encoding='utf-8'), True
+
+_MISSING_VALUES = ('?', '.')
+
+class AtomSiteTable(dict):
+    """Columnar storage of the mmCIF "atom_site" loop. Each column is stored as
+    a typed numpy array (float32 for Cartesian coordinates, float64 for
+    occupancy and B-factors, int64 for serial and sequence numbers, and object
+    arrays of shared string instances for names). Missing values ("?" or ".")
+    are recorded as boolean masks in `missing` for numeric columns and as None
+    for string columns. The (N, 3) coordinate array is available as `coords`.
+    """
+    float_columns = frozenset((
+        'Cartn_x', 'Cartn_y', 'Cartn_z', 'occupancy', 'B_iso_or_equiv'
+    ))
+    int_columns = frozenset((
+        'id', 'label_entity_id', 'label_seq_id', 'auth_seq_id',
+        'pdbx_PDB_model_num', 'pdbx_formal_charge'
+    ))
+    str_columns = frozenset((
+        'group_PDB', 'type_symbol', 'label_atom_id', 'label_alt_id',
+        'label_comp_id', 'label_asym_id', 'pdbx_PDB_ins_code', 'auth_comp_id',
+        'auth_asym_id', 'auth_atom_id'
+    ))
+
+    def __init__(self, raw_columns):
+        super().__init__()
+        self.missing = {}
+        for key, values in raw_columns.items():
+            self[key] = self._convert_column(key, values)
+        coord_keys = ("Cartn_x", "Cartn_y", "Cartn_z")
+        if all(k in self for k in coord_keys):
+            self.coords = numpy.stack(
+                [self[k] for k in coord_keys], axis=1
+            ).astype('f')
+        else:
+            self.coords = numpy.empty((0, 3), 'f')
+
+    @property
+    def n_atoms(self):
+        """Number of rows in the atom_site loop"""
+        return len(self.coords)
+
+    def _convert_numeric(self, key, str_arr, dtype):
+        missing = numpy.isin(str_arr, _MISSING_VALUES)
+        if missing.any():
+            str_arr = str_arr.copy()
+            str_arr[missing] = 'nan' if dtype != numpy.int64 else '0'
+            self.missing[key] = missing
+        return str_arr.astype(dtype)
+
+    @staticmethod
+    def _convert_str(str_arr):
+        # unique names are converted to python str objects once and shared
+        uniq, inverse = numpy.unique(str_arr, return_inverse=True)
+        uniq = uniq.astype(object)
+        uniq[numpy.isin(uniq, _MISSING_VALUES)] = None
+        return uniq[inverse.reshape(-1)]
+
+    def _convert_column(self, key, values):
+        str_arr = numpy.asarray(values, dtype=str)
+        if key in self.str_columns:
+            return self._convert_str(str_arr)
+        if key in self.float_columns:
+            dtype = 'f' if key.startswith('Cartn') else numpy.float64
+            return self._convert_numeric(key, str_arr, dtype)
+        if key in self.int_columns:
+            candidates = (numpy.int64,)
+        else:
+            # unknown columns get the same int -> float -> str precedence as
+            # MMCIF2Dict._convert_type
+            candidates = (numpy.int64, numpy.float64)
+        for dtype in candidates:
+            try:
+                return self._convert_numeric(key, str_arr, dtype)
+            except ValueError:
+                self.missing.pop(key, None)
+        return self._convert_str(str_arr)
+
+    def as_list(self, key):
+        """Return the column as a list of python objects with missing values
+        as None"""
+        values = self[key].tolist()
+        if key in self.missing:
+            for i in numpy.flatnonzero(self.missing[key]).tolist():
+                values[i] = None
+        return values
 
 class MMCIF2Dict(dict):
-    """A dictionary-like object that reads a mmCIF file and stores the data in a dictionary."""
+    """A dictionary-like object that reads a mmCIF file and stores the data in a dictionary.
+    The "atom_site" category is stored as an `AtomSiteTable` of typed columns."""
     def __init__(self, filename):
-        orig_dict = _MMCIF2Dict(filename)
+        handle, should_close = _open_cif(filename)
+        try:
+            orig_dict = _read_raw_cif(handle)
+        finally:
+            if should_close:
+                handle.close()
         self._organize_mmcif_dict(orig_dict)
- 
+
     def _convert_type(self, entry: str):
-        sign = -1 if entry[0] == '-' else 1
+        sign = -1 if entry.startswith('-') else 1
         entry = entry.lstrip('-')
         if entry.isnumeric():
             return sign*int(entry)
@@ -18,23 +215,33 @@ class MMCIF2Dict(dict):
             if a.isnumeric() and b.isnumeric():
                 return sign*float(entry)
         return entry
-    
+
     def _reformat_str(self, entry: str):
         if entry in ('?','.'):
             return None
         elif '\n' in entry:
             return ''.join(entry.split('\n'))
         return self._convert_type(entry)
-    
+
+    @staticmethod
+    def _normalize_key(k):
+        k = k.strip('_')
+        if '[' in k:
+            k = ''.join([s.replace(']','') for s in k.split('[')])
+        if '-' in k:
+            k = '_'.join([s for s in k.split('-')])
+        return k
+
     def _organize_mmcif_dict(self, orig_dict):
+        atom_site_columns = {}
         for k, v in orig_dict.items():
-            k = k.strip('_')
+            k = self._normalize_key(k)
+            if k.startswith('atom_site.'):
+                # typed conversion is done column-wise below
+                atom_site_columns[k.split('.')[1]] = v
+                continue
             if isinstance(v, list):
                 v = [self._reformat_str(x) for x in v]
-            if '[' in k:
-                k = ''.join([s.replace(']','') for s in k.split('[')])
-            if '-' in k:
-                k = '_'.join([s for s in k.split('-')])
             if '.' not in k:
                 # second level does not exist
                 self[k] = v
@@ -43,12 +250,14 @@ class MMCIF2Dict(dict):
             if main not in self:
                 self[main] = dict()
             self[main][sec] = v
+        if atom_site_columns:
+            self['atom_site'] = AtomSiteTable(atom_site_columns)
 
     def level_two_get(self, key, subkey):
         if key in self:
             return self[key].get(subkey)
         return None
-    
+
     def retrieve_single_value_dict(self, key):
         citation = dict()
         subdict = self.get(key)
@@ -59,31 +268,141 @@ class MMCIF2Dict(dict):
                 raise ValueError(
                     'Sub-dict "{}" is not a single value dict'.format(key)
                 )
-            if v[0] is not None: 
+            if v[0] is not None:
                 citation[k] = v[0]
         return citation
-    
+
     def create_namedtuples(self, key, single_value = False):
         '''Create a list of namedtuples from a section of the mmcif dict'''
         if key not in self:
             return ()
         sub_dict = self[key]
         named_entries = namedtuple(key, sub_dict.keys())
+        if isinstance(sub_dict, AtomSiteTable):
+            columns = [sub_dict.as_list(k) for k in sub_dict]
+        else:
+            columns = sub_dict.values()
 
         if single_value:
-            entry = list(zip(*sub_dict.values()))[0]
+            entry = list(zip(*columns))[0]
             return named_entries(*entry)
-        
+
         all_entries = []
-        for entry in zip(*sub_dict.values()):
+        for entry in zip(*columns):
             all_entries.append(named_entries(*entry))
         return all_entries
-    
+
     def find_atom_coords(self):
-        sub_dict = self['atom_site']
-        n_atoms = len(sub_dict['label_atom_id'])
-        
-        coords = numpy.empty((n_atoms, 3),'f') 
-        for i,k in enumerate(["Cartn_x", "Cartn_y", "Cartn_z"]):
-            coords[:,i] = numpy.asarray(sub_dict[k],'f')
-        return coords
\ No newline at end of file
+        return self['atom_site'].coords
+
+class LazyMMCIF2Dict(MMCIF2Dict):
+    """A lazily decoded MMCIF2Dict. The file is scanned once to record the 
+    offsets of every category (and loop) in the first data block, and a 
+    category is only tokenized and type-converted when it is accessed. This is
+    useful for header or metadata queries (e.g. entity_poly, resolution or 
+    pdbx_struct_assembly) where decoding the atom_site loop is unnecessary."""
+    def __init__(self, filename):
+        dict.__init__(self)
+        if hasattr(filename, 'read'):
+            content = filename.read()
+        else:
+            with open(filename, 'rb') as fh:
+                content = fh.read()
+        self._content = content
+        self._category_index = self._index_categories(content)
+
+    def _index_categories(self, content):
+        """Return a dict of {category: [(start, end), ...]} offsets into the
+        content for the first data block"""
+        if isinstance(content, bytes):
+            category_re, data_re = _CATEGORY_START_RE_B, _DATA_BLOCK_RE_B
+        else:
+            category_re, data_re = _CATEGORY_START_RE, _DATA_BLOCK_RE
+        block_start, block_end = 0, len(content)
+        data_blocks = (
+            match for match in data_re.finditer(content)
+            if match.group(1) is not None
+        )
+        first_block = next(data_blocks, None)
+        if first_block is not None:
+            data_id = first_block.group(1)
+            if isinstance(data_id, bytes):
+                data_id = data_id.decode()
+            dict.__setitem__(self, 'data', data_id)
+            block_start = first_block.end()
+            second_block = next(data_blocks, None)
+            if second_block is not None:
+                block_end = second_block.start()
+
+        index = {}
+        cur_category, cur_start = None, None
+        for match in category_re.finditer(content, block_start, block_end):
+            category = match.group(1)
+            if category is None:
+                # text field
+                continue
+            if isinstance(category, bytes):
+                category = category.decode()
+            category = self._normalize_key(category)
+            if category == cur_category:
+                continue
+            if cur_category is not None:
+                index.setdefault(cur_category, []).append(
+                    (cur_start, match.start())
+                )
+            cur_category, cur_start = category, match.start()
+        if cur_category is not None:
+            index.setdefault(cur_category, []).append((cur_start, block_end))
+        return index
+
+    def _decode_category(self, key):
+        for start, end in self._category_index.pop(key):
+            chunk = self._content[start:end]
+            if isinstance(chunk, bytes):
+                chunk = chunk.decode('utf-8')
+            self._organize_mmcif_dict(_read_raw_cif(io.StringIO(chunk)))
+        if not self._category_index:
+            # everything is decoded, release the raw content
+            self._content = None
+
+    def load_all(self):
+        """Decode all remaining categories"""
+        for key in list(self._category_index):
+            self._decode_category(key)
+
+    @property
+    def loaded_categories(self):
+        """Names of the categories that have been decoded"""
+        return [k for k in dict.keys(self) if k != 'data']
+
+    def __missing__(self, key):
+        if key not in self._category_index:
+            raise KeyError(key)
+        self._decode_category(key)
+        return dict.__getitem__(self, key)
+
+    def __contains__(self, key):
+        return dict.__contains__(self, key) or key in self._category_index
+
+    def get(self, key, default=None):
+        if key in self:
+            return self[key]
+        return default
+
+    def __iter__(self):
+        yield from dict.__iter__(self)
+        yield from list(self._category_index)
+
+    def __len__(self):
+        return dict.__len__(self) + len(self._category_index)
+
+    def keys(self):
+        return list(self)
+
+    def items(self):
+        self.load_all()
+        return dict.items(self)
+
+    def values(self):
+        self.load_all()
+        return dict.values(self)
@@ -5,7 +5,6 @@
 
 """Module containing the parser class for constructing structures from mmCIF 
 files from PDB"""
-from copy import deepcopy
 import warnings
 import numpy as np
 from Bio.PDB.PDBExceptions import PDBConstructionWarning
@@ -16,9 +15,7 @@ from crimm.StructEntities.Chain import (
     Chain, PolymerChain, Heterogens, Oligosaccharide, Solvent, Macrolide
 )
 from crimm.StructEntities.Model import Model
-from crimm.Utils.StructureUtils import (
-    get_coords, index_to_letters, letters_to_index
-)
+from crimm.Utils.Instrumentation import instrumented, count, is_enabled
 
 class MMCIFParser:
     """Parser class for standard mmCIF files from PDB"""
@@ -26,6 +23,7 @@ class MMCIFParser:
             self,
             first_model_only = True,
             use_bio_assembly = True,
+            expand_bio_assembly = True,
             include_solvent = True,
             include_hydrogens = False,
             strict_parser = True,
@@ -35,6 +33,7 @@ class MMCIFParser:
         self.QUIET = QUIET
         self.first_model_only = first_model_only
         self.use_bio_assembly = use_bio_assembly
+        self.expand_bio_assembly = expand_bio_assembly
         self.include_solvent = include_solvent
         self.include_hydrogens = include_hydrogens
         self.strict_parser = strict_parser
@@ -73,6 +72,7 @@ class MMCIFParser:
 
         return header
 
+    @instrumented('mmcif_parse')
     def get_structure(self, filepath, structure_id = None):
         """Return the structure.
 
@@ -87,6 +87,9 @@ class MMCIFParser:
             # mmCIF will be parsed into dictionary first and then namedtuples
             # to gather all the necessary info to construct the structure
             self.cifdict = MMCIF2Dict(filepath)
+            if is_enabled():
+                atom_ids = self.cifdict.level_two_get('atom_site', 'id')
+                count('atoms', len(atom_ids) if atom_ids is not None else 0)
             self.structure_id = structure_id
             self.model_template = self.create_model_template()
             # get bioassembly info
@@ -189,36 +192,6 @@ class MMCIFParser:
             model_temp.add(cur_chain)
         return model_temp
 
-    def create_atom_from_namedtuple(self, atom_entry):
-        """Create an Atom object from the namedtuple of an "atom_site" entry
-        from the mmCIF dict
-
-        Arguments:
-         :param atom_entry: A namedtuple created from mmCIF "atom_site" entries
-                           with field names as attributes in the tuple
-         :type atom_entry: namedtuple
-        """
-        coord = np.array(
-                [atom_entry.Cartn_x, atom_entry.Cartn_y, atom_entry.Cartn_z]
-        )
-        altloc = atom_entry.label_alt_id
-        if altloc is None:
-            altloc = ' '
-        else:
-            altloc = str(atom_entry.label_alt_id)
-
-        atom = Atom(
-            name = atom_entry.label_atom_id,
-            fullname = atom_entry.label_atom_id,
-            coord = coord,
-            bfactor = atom_entry.B_iso_or_equiv,
-            occupancy = atom_entry.occupancy,
-            altloc = altloc,
-            serial_number = atom_entry.id,
-            element = atom_entry.type_symbol,
-        )
-        return atom
-
     @staticmethod
     def _assign_hetflag(fieldname, resname):
         if fieldname != "HETATM":
@@ -227,28 +200,40 @@ class MMCIFParser:
             return "W"
         return "H"
 
-    def _create_residue_dict_entry(self, atom_entry, resseq):
+    def _create_residue_dict_entry(
+            self, resname, group_pdb, icode, resseq, author_seq_id
+        ):
         """Create a residue dictionary entry with empty atom list"""
-        resname = str(atom_entry.label_comp_id)
-        hetatm_flag = self._assign_hetflag(
-            atom_entry.group_PDB, resname
-        )
-        icode = atom_entry.pdbx_PDB_ins_code
+        resname = str(resname)
+        hetatm_flag = self._assign_hetflag(group_pdb, resname)
         if icode is None:
             icode = ' '
         res_id = (hetatm_flag, resseq, icode)
         res_dict_entry = {
             "resname": resname,
             "res_id": res_id,
-            "author_seq_id": atom_entry.auth_seq_id,
+            "author_seq_id": author_seq_id,
             "atom_list": []
         }
         return res_dict_entry
-        
+
+    def _select_atom_site_rows(self, atom_site):
+        """Return the row indices of atom_site entries to be built, with 
+        hydrogens and models other than the first removed if requested"""
+        selected = np.ones(atom_site.n_atoms, dtype=bool)
+        if not self.include_hydrogens and 'type_symbol' in atom_site:
+            selected &= atom_site['type_symbol'] != 'H'
+        if self.first_model_only and atom_site.n_atoms > 0:
+            model_nums = atom_site['pdbx_PDB_model_num']
+            selected &= model_nums == model_nums[0]
+        return np.flatnonzero(selected).tolist()
+
     def create_atom_site_entry_dict(self):
         """Create a dictionary containing structured data from all "atom_site" 
         fields in mmCIF. Return a dictionary that contains four levels, which 
-        are keyed by [model_id,[chain_id,[resseq]]].
+        are keyed by [model_id,[chain_id,[resseq]]]. The typed columns of the 
+        atom_site table are read directly, and coordinates of the atoms are 
+        rows of the table's float32 coordinate array.
 
         The dictionary adopt the strucuture as following.
         structure_dict : {
@@ -263,31 +248,42 @@ class MMCIFParser:
             }
         }
         """
-        atom_site = self.cifdict.create_namedtuples('atom_site')
+        atom_site = self.cifdict['atom_site']
+        # float64 copies per atom below, so that the atoms share no array
+        coords = atom_site.coords.astype(np.float64)
+        # python lists are much faster to index per atom than numpy arrays
+        (
+            serial_nums, elements, atom_names, altlocs, resnames, group_pdbs,
+            entity_ids, chain_ids, label_seqs, auth_seqs, icodes, model_nums,
+            occupancies, bfactors
+        ) = (
+            atom_site.as_list(key) for key in (
+                'id', 'type_symbol', 'label_atom_id', 'label_alt_id',
+                'label_comp_id', 'group_PDB', 'label_entity_id', 
+                'label_asym_id', 'label_seq_id', 'auth_seq_id', 
+                'pdbx_PDB_ins_code', 'pdbx_PDB_model_num', 'occupancy', 
+                'B_iso_or_equiv'
+            )
+        )
         model_dict = dict()
-
-        for atom_entry in atom_site:
-            if not self.include_hydrogens and atom_entry.type_symbol == 'H':
-                continue
-            model_num = atom_entry.pdbx_PDB_model_num
+        for i in self._select_atom_site_rows(atom_site):
+            model_num = model_nums[i]
             if model_num not in model_dict:
-                if self.first_model_only and len(model_dict) > 0:
-                    break
                 model_dict[model_num] = dict()
             entity_dict = model_dict[model_num]
-            entity_id = atom_entry.label_entity_id
+            entity_id = entity_ids[i]
             if entity_id not in entity_dict:
                 entity_dict[entity_id] = dict()
             chain_dict = entity_dict[entity_id]
-            chain_id = atom_entry.label_asym_id
+            chain_id = chain_ids[i]
             if chain_id not in chain_dict:
                 last_auth_seq = None
                 het_chain_resseq = 0
                 chain_dict[chain_id] = dict()
             res_dict = chain_dict[chain_id]
 
-            resseq = atom_entry.label_seq_id
-            auth_seq_id = atom_entry.auth_seq_id
+            resseq = label_seqs[i]
+            auth_seq_id = auth_seqs[i]
             if resseq is None:
                 # The residue sequence for HETATOM is not defined in mmCIF, 
                 # we need to manually increment it from the last sequence number
@@ -297,8 +293,20 @@ class MMCIFParser:
                 resseq = het_chain_resseq
 
             if resseq not in res_dict:
-                res_dict[resseq] = self._create_residue_dict_entry(atom_entry, resseq)
-            atom = self.create_atom_from_namedtuple(atom_entry)
+                res_dict[resseq] = self._create_residue_dict_entry(
+                    resnames[i], group_pdbs[i], icodes[i], resseq, auth_seq_id
+                )
+            altloc = altlocs[i]
+            atom = Atom(
+                name = atom_names[i],
+                fullname = atom_names[i],
+                coord = coords[i].copy(),
+                bfactor = bfactors[i],
+                occupancy = occupancies[i],
+                altloc = ' ' if altloc is None else altloc,
+                serial_number = serial_nums[i],
+                element = elements[i],
+            )
             res_dict[resseq]['atom_list'].append(atom)
 
         return model_dict
@@ -382,34 +390,19 @@ class MMCIFParser:
     def _execute_symmetry_operations(self, model):
         if not self.symmetry_ops:
             return
-        reference_model = deepcopy(model)
-        reference_model.detach_parent()
-        idx_translations = [letters_to_index(chain.id) for chain in model]
-        last_idx = max(idx_translations)
+        operations = []
         for op_id in self._find_first_assembly_ops():
             if op_id not in self.symmetry_ops:
                 raise ValueError(
                     f'Operation id {op_id} not found in listed symmetry ops'
                 )
-            operation = self.symmetry_ops[op_id]
-            if operation['type'] == 'identity operation':
-                continue
-            warnings.warn(
-                f"{operation['type'].upper()} performed as specified in mmCIF file."
-            )
-            matrix, vector = operation['matrix'], operation['vector']
-            copy_model = deepcopy(reference_model)
-            copy_coords = get_coords(copy_model)
-            new_coords = copy_coords @ matrix + vector
-            for i, atom in enumerate(copy_model.get_atoms()):
-                atom.coord = new_coords[i]
-            for chain in copy_model:
-                last_idx += 1
-                chain.detach_parent()
-                chain.id = index_to_letters(last_idx)
-            for chain in copy_model:
-                model.add(chain)
-        
+            operations.append(self.symmetry_ops[op_id])
+        model.assembly_operations = operations
+        # if not expanded, the model is the asymmetric unit with the pending
+        # operations, and Model.expand_assembly() creates the copies on demand
+        if self.expand_bio_assembly and model.expand_assembly():
+            # serial numbers are already reset on the expanded model
+            return
         model.reset_atom_serial_numbers()
 
     def _build_structure(self, structure_id):
@@ -187,6 +187,31 @@ def _get_atom_line(
         )
     return format_string % args
 
+def _get_array_backed_chain_lines(chain, trunc_resname=False, use_charmm_format=False):
+    """Return the PDB lines of an array-backed solvent chain (PRIVATE), followed
+    by its TER line. The lines are generated from the coordinate arrays with one
+    scratch copy of each template atom, so no per-molecule atoms are created."""
+    template = chain.template
+    hetfield, _, icode = template.id
+    resname = template.resname
+    if len(resname) > 3 and trunc_resname:
+        resname = resname[:3]
+    chain_id = chain.get_id()[0]
+    scratch_atoms = [atom.copy() for atom in template.get_atoms()]
+    serial = chain.serial_start if chain.serial_start is not None else 1
+    lines = []
+    for resseq, res_coords in zip(chain.resseqs.tolist(), chain.coords):
+        for atom, coord in zip(scratch_atoms, res_coords):
+            atom.coord = coord
+            lines.append(_get_atom_line(
+                atom, hetfield, chain.segid, serial, resname, resseq, icode,
+                chain_id, trunc_resname=trunc_resname,
+                use_charmm_format=use_charmm_format
+            ))
+            serial += 1
+    lines.append(_TER_FORMAT_STRING % (serial-1, resname, chain_id, resseq, icode))
+    return ''.join(lines)
+
 ##TODO: Add support for CONECT records
 def get_pdb_str(
         entity, reset_serial=True,
@@ -211,6 +236,12 @@ def get_pdb_str(
     
     pdb_str = ''
     for chain in chains:
+        if getattr(chain, 'is_array_backed', False):
+            if len(chain) != 0:
+                pdb_str += _get_array_backed_chain_lines(
+                    chain, trunc_resname, use_charmm_format
+                )
+            continue
         atoms = list(chain.get_atoms(include_alt=include_alt))
         if len(atoms) == 0:
             continue
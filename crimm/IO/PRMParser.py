@@ -11,12 +11,21 @@ nonbond_par = namedtuple('nonbond_param', ['epsilon', 'rmin_half'])
 nonbond14_par = namedtuple('nonbond14_param', ['epsilon', 'rmin_half'])
 nbfix_par = namedtuple('nbfix_param', ['emin','rmin'])
 
+# Module level aliases with the namedtuple type names, which pickle needs to
+# find the classes (see crimm.IO.TopparCache)
+bond_param, angle_param, ub_param = bond_par, angle_par, ub_par
+dihedral_param, improper_param, cmap_param = dihe_par, impr_par, cmap_par
+nonbond_param, nonbond14_param, nbfix_param = nonbond_par, nonbond14_par, nbfix_par
+
 def categorize_lines(lines):
     line_dict = {
         'mass': [], 'bonds': [], 'angles': [], 'dihedrals': [],
         'improper': [], 'cmap': [], 'nonbonded': [], 'nbfix':[]
     }
     is_continued = False
+    # lines before the first section (e.g. the read param command of a
+    # stream file) are skipped
+    cur_section = None
     for line in lines:
         l = line.strip().upper()
         if skip_line(l):
@@ -50,7 +59,7 @@ def categorize_lines(lines):
             pass
         elif l.startswith('END'):
             break
-        else:
+        elif cur_section is not None:
             cur_section.append(l)
     return line_dict
 
@@ -217,4 +226,10 @@ def parse_line_dict(line_dict):
         'nonbonded': nonbond_dict,
         'nonbonded14': nonbond14_dict,
         'nbfix': nbfix_dict
-    }
\ No newline at end of file
+    }
+
+def parse_prm_block(prm_block):
+    """Parse the parameter block of a stream file (e.g. the PRM part of the
+    CGenFF output) into the parameter dictionary."""
+    lines = [l.rstrip() for l in prm_block.split('\n')]
+    return parse_line_dict(categorize_lines(lines))
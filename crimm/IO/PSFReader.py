@@ -9,10 +9,45 @@ Format specification (from CHARMM source io/psfres.F90):
 - Extended format (EXT): I10 for integers, A8 for strings
 - Standard format: I8 for integers, A4 for strings
 - XPLOR format: Uses atom type names instead of parameter file indices
+
+Besides the record-based ``PSFData``, files can be read into a columnar
+``PSFArrays`` container (``read_psf(..., as_arrays=True)``), which holds the
+atom table as a numpy structured array and every index section as an
+(N, k) int32 array.
 """
 
-from typing import List, Tuple, Dict, Any, NamedTuple
+import re
+import warnings
+from bisect import bisect_right
+from typing import List, Tuple, Dict, Any, NamedTuple, Optional, Union
 from dataclasses import dataclass, field
+import numpy as np
+
+# Atom table columns of PSFArrays, in PSF order. String columns are sized to
+# the longest value in the file.
+PSF_ATOM_FIELDS = (
+    ('serial', np.int32),
+    ('segid', str),
+    ('resid', str),
+    ('resname', str),
+    ('atomname', str),
+    ('atomtype', str),
+    ('charge', np.float64),
+    ('mass', np.float64),
+    ('imove', np.int32),
+)
+
+# Index sections stored as (N, k) arrays: label -> (attribute, k)
+PSF_INDEX_SECTIONS = {
+    'NBOND': ('bonds', 2),
+    'NTHETA': ('angles', 3),
+    'NPHI': ('dihedrals', 4),
+    'NIMPHI': ('impropers', 4),
+    'NDON': ('donors', 2),
+    'NACC': ('acceptors', 2),
+    'NGRP': ('groups', 3),
+    'NCRTERM': ('cmap', 8),
+}
 
 
 class PSFAtom(NamedTuple):
@@ -81,6 +116,114 @@ class PSFData:
     xplor: bool = False
     has_cmap: bool = False
 
+    def to_arrays(self) -> 'PSFArrays':
+        """Return the columnar (numpy array) form of this data."""
+        arrays = PSFArrays(
+            title=list(self.title),
+            atoms=_build_atom_table(tuple(zip(*self.atoms)) or None),
+            nonbonded=np.asarray(self.nonbonded, dtype=np.int32),
+            lonepairs=list(self.lonepairs),
+            extended=self.extended,
+            xplor=self.xplor,
+            has_cmap=self.has_cmap
+        )
+        for attr, width in PSF_INDEX_SECTIONS.values():
+            setattr(
+                arrays, attr,
+                np.asarray(getattr(self, attr), dtype=np.int32).reshape(-1, width)
+            )
+        return arrays
+
+
+def _empty_index_array(width: int):
+    return lambda: np.empty((0, width), dtype=np.int32)
+
+
+@dataclass
+class PSFArrays:
+    """Columnar container for parsed PSF topology data.
+
+    Same sections as ``PSFData``, stored as numpy arrays.
+
+    Attributes
+    ----------
+    title : List[str]
+        Title lines from PSF file
+    atoms : np.ndarray
+        Structured array with the fields of ``PSF_ATOM_FIELDS``
+    bonds, angles, dihedrals, impropers : np.ndarray
+        (N, k) int32 arrays of 1-based atom indices
+    donors, acceptors : np.ndarray
+        (N, 2) int32 arrays of H-bond donor/acceptor pairs
+    nonbonded : np.ndarray
+        1D int32 array of non-bonded exclusion indices
+    groups : np.ndarray
+        (N, 3) int32 array of (pointer, type, move_flag)
+    cmap : np.ndarray
+        (N, 8) int32 array of CMAP cross-term atom indices
+    lonepairs : List[Dict[str, Any]]
+        Lone pair definitions
+    extended : bool
+        Whether file was in extended format
+    xplor : bool
+        Whether file was in XPLOR format
+    has_cmap : bool
+        Whether file contains CMAP terms
+    """
+    title: List[str] = field(default_factory=list)
+    atoms: np.ndarray = field(default_factory=lambda: _build_atom_table(None))
+    bonds: np.ndarray = field(default_factory=_empty_index_array(2))
+    angles: np.ndarray = field(default_factory=_empty_index_array(3))
+    dihedrals: np.ndarray = field(default_factory=_empty_index_array(4))
+    impropers: np.ndarray = field(default_factory=_empty_index_array(4))
+    donors: np.ndarray = field(default_factory=_empty_index_array(2))
+    acceptors: np.ndarray = field(default_factory=_empty_index_array(2))
+    nonbonded: np.ndarray = field(
+        default_factory=lambda: np.empty(0, dtype=np.int32)
+    )
+    groups: np.ndarray = field(default_factory=_empty_index_array(3))
+    cmap: np.ndarray = field(default_factory=_empty_index_array(8))
+    lonepairs: List[Dict[str, Any]] = field(default_factory=list)
+    extended: bool = False
+    xplor: bool = False
+    has_cmap: bool = False
+
+    def to_psf_data(self) -> PSFData:
+        """Return the record-based (``PSFData``) form of this data."""
+        data = PSFData(
+            title=list(self.title),
+            atoms=[PSFAtom(*row) for row in self.atoms.tolist()],
+            nonbonded=self.nonbonded.tolist(),
+            lonepairs=list(self.lonepairs),
+            extended=self.extended,
+            xplor=self.xplor,
+            has_cmap=self.has_cmap
+        )
+        for attr, _ in PSF_INDEX_SECTIONS.values():
+            setattr(data, attr, [tuple(row) for row in getattr(self, attr).tolist()])
+        return data
+
+
+def _build_atom_table(columns) -> np.ndarray:
+    """Build the PSF atom structured array from one sequence per column.
+
+    Columns may hold strings straight from the file or already typed values.
+    ``None`` gives an empty table.
+    """
+    if columns is None:
+        columns = [()] * len(PSF_ATOM_FIELDS)
+    arrays = []
+    for (_, kind), col in zip(PSF_ATOM_FIELDS, columns):
+        if kind is str:
+            arrays.append(np.array(col, dtype=str))
+        else:
+            arrays.append(np.array(col).astype(kind))
+    dtype = [(name, arr.dtype) for (name, _), arr in zip(PSF_ATOM_FIELDS, arrays)]
+    table = np.empty(len(arrays[0]), dtype=dtype)
+    for (name, _), arr in zip(PSF_ATOM_FIELDS, arrays):
+        table[name] = arr
+    return table
+
 
 class PSFReader:
     """Read CHARMM PSF files into structured data.
@@ -164,6 +307,106 @@ class PSFReader:
 
         return data
 
+    def read_arrays(self, filepath: str) -> PSFArrays:
+        """Parse PSF file into columnar numpy arrays.
+
+        Each section is located from its header and the blank line that
+        ends it. The whole block is then tokenized at once instead of line
+        by line.
+
+        Parameters
+        ----------
+        filepath : str
+            Path to PSF file
+
+        Returns
+        -------
+        PSFArrays
+            Parsed topology data
+        """
+        with open(filepath, 'r', encoding='utf-8') as f:
+            self._lines = [line.rstrip() for line in f]
+
+        self._line_idx = 0
+        self._parse_header()
+        data = PSFArrays(
+            extended=self.extended, xplor=self.xplor, has_cmap=self.has_cmap
+        )
+
+        lines = self._lines
+        # section headers and the blank lines terminating the sections
+        stops = [i for i, line in enumerate(lines) if not line or '!' in line]
+        resume = self._line_idx
+        for idx in stops:
+            line = lines[idx]
+            if idx < resume or not line or line.startswith('!'):
+                continue
+            label = line.partition('!')[2].split(':')[0].split()
+            label = label[0] if label else ''
+            if label not in PSF_INDEX_SECTIONS and label not in (
+                'NTITLE', 'NATOM', 'NNB', 'NUMLP'
+            ):
+                continue
+            count = self._parse_count(line)
+
+            if label == 'NTITLE':
+                self._line_idx = idx
+                data.title = self._parse_title(line)
+                resume = self._line_idx
+            elif label == 'NATOM':
+                data.atoms = self._parse_atom_table(idx, count)
+                resume = idx + count + 1
+            elif label in PSF_INDEX_SECTIONS:
+                attr, width = PSF_INDEX_SECTIONS[label]
+                values, resume = self._read_index_block(idx, count * width, stops)
+                setattr(data, attr, values.reshape(-1, width))
+            elif label == 'NNB':
+                data.nonbonded, resume = self._read_index_block(idx, count, stops)
+            elif label == 'NUMLP':
+                self._line_idx = idx
+                data.lonepairs = self._parse_lonepairs(line)
+                resume = self._line_idx
+
+        return data
+
+    def _parse_atom_table(self, header_idx: int, count: int) -> np.ndarray:
+        """Parse the NATOM block following header_idx into a structured array.
+
+        When the block has as many fields as its first line times the atom
+        count, it is tokenized at once and the columns are taken by striding
+        over the tokens. Otherwise, or if a numeric column does not parse,
+        the atom lines are split one by one.
+        """
+        block = self._lines[header_idx + 1:header_idx + 1 + count]
+        n_fields = len(block[0].split()) if block else 0
+        if n_fields >= 9:
+            tokens = " ".join(block).split()
+            if len(tokens) == count * n_fields:
+                try:
+                    return _build_atom_table(
+                        [tokens[k::n_fields] for k in range(9)]
+                    )
+                except ValueError:
+                    pass
+        rows = [line.split()[:9] for line in block]
+        for row in rows:
+            if len(row) < 9:
+                raise ValueError(f"Invalid atom line: {' '.join(row)}")
+        return _build_atom_table(tuple(zip(*rows)) or None)
+
+    def _read_index_block(
+        self, header_idx: int, n_ints: int, stops: List[int]
+    ) -> Tuple[np.ndarray, int]:
+        """Read up to n_ints integers from the block after header_idx.
+
+        Returns the int32 array and the index of the line ending the block.
+        """
+        i = bisect_right(stops, header_idx)
+        end = stops[i] if i < len(stops) else len(self._lines)
+        tokens = " ".join(self._lines[header_idx + 1:end]).split()[:n_ints]
+        values = np.array(tokens).astype(np.int32)
+        return values, end
+
     def _current_line(self) -> str:
         """Get current line."""
         if self._line_idx < len(self._lines):
@@ -405,31 +648,157 @@ class PSFReader:
 
 # Convenience function
 
-def read_psf(filepath: str) -> PSFData:
+def read_psf(filepath: str, as_arrays: bool = False) -> Union[PSFData, PSFArrays]:
     """Read CHARMM PSF file and return parsed data.
 
     Parameters
     ----------
     filepath : str
         Path to PSF file
+    as_arrays : bool, default False
+        Return the columnar ``PSFArrays`` instead of ``PSFData``
 
     Returns
     -------
-    PSFData
+    PSFData or PSFArrays
         Parsed topology data
     """
     reader = PSFReader()
+    if as_arrays:
+        return reader.read_arrays(filepath)
     return reader.read(filepath)
 
 
+def _as_arrays(psf: Union[PSFData, PSFArrays]) -> PSFArrays:
+    if isinstance(psf, PSFArrays):
+        return psf
+    return psf.to_arrays()
+
+
+def _bond_keys(bonds: np.ndarray) -> np.ndarray:
+    """Unique order-independent int64 keys for an (N, 2) bond array."""
+    pairs = np.sort(bonds.astype(np.int64), axis=1)
+    return np.unique((pairs[:, 0] << 32) | pairs[:, 1])
+
+
+_RESID_RE = re.compile(r'^(-?\d+)(.*)$')
+
+
+def psf_to_structure(
+    psf: Union[PSFData, PSFArrays],
+    coords: Optional[np.ndarray] = None,
+    structure_id: str = 'PSF',
+    include_solvent: bool = True
+):
+    """Build a crimm Structure from parsed PSF data.
+
+    Chains are built from segids and residues from changes in resid or
+    resname, in the same way as ``CRDParser``. A PSF has no coordinates,
+    so atoms are placed at the origin unless coords is given.
+
+    Parameters
+    ----------
+    psf : PSFData or PSFArrays
+        Parsed topology data
+    coords : np.ndarray, optional
+        (N, 3) coordinates in PSF atom order
+    structure_id : str, default 'PSF'
+        Id of the new structure
+    include_solvent : bool, default True
+        Keep the solvent chains
+
+    Returns
+    -------
+    Structure
+        Structure with a single model
+    """
+    from crimm.IO.StructureBuilder import StructureBuilder
+    from crimm.IO.PDBParser import (
+        protein_letters_3to1, nucleic_letters_3to1, convert_chains
+    )
+    from crimm.Data.element_dict import all_element_dict
+    from crimm.Utils.StructureUtils import index_to_letters
+
+    atoms = _as_arrays(psf).atoms
+    n_atoms = len(atoms)
+    if coords is None:
+        coords = np.zeros((n_atoms, 3))
+    coords = np.asarray(coords, dtype=float)
+    if coords.shape != (n_atoms, 3):
+        raise ValueError(
+            f"coords must have shape ({n_atoms}, 3), got {coords.shape}"
+        )
+
+    sb = StructureBuilder()
+    sb.init_structure(structure_id)
+    sb.init_model(1)
+    sb.header = {}
+    cur_segid = cur_resid = cur_resname = None
+    n_chains = 0
+    for atom, coord in zip(atoms.tolist(), coords):
+        serial, segid, resid, resname, atomname = atom[:5]
+        if segid != cur_segid:
+            cur_segid = segid
+            sb.init_seg(segid)
+            sb.init_chain(index_to_letters(n_chains))
+            n_chains += 1
+            cur_resid = None
+        if resid != cur_resid or resname != cur_resname:
+            cur_resid, cur_resname = resid, resname
+            match = _RESID_RE.match(resid)
+            if match is None:
+                raise ValueError(f"Invalid resid {resid} for atom {serial}")
+            resseq, icode = int(match.group(1)), match.group(2) or ' '
+            if resname in ('HOH', 'WAT', 'TIP3', 'TIP4'):
+                het_field = 'W'
+            elif (
+                resname not in protein_letters_3to1 and
+                resname not in nucleic_letters_3to1
+            ):
+                het_field = 'H'
+            else:
+                het_field = ' '
+            sb.init_residue(resname, het_field, resseq, icode)
+        if atomname in all_element_dict:
+            element = all_element_dict.get(atomname)
+        else:
+            element = atomname[0]
+            warnings.warn(
+                f'Element type cannot be determined from atom name {atomname}! '
+                f'Element is assigned as \'{element}\'.'
+            )
+        sb.init_atom(
+            atomname, coord.copy(), 0.0,
+            occupancy=1.0,
+            altloc=' ',
+            fullname=atomname,
+            serial_number=serial,
+            element=element
+        )
+
+    structure = sb.get_structure()
+    for model in structure:
+        new_chains = convert_chains(model.child_list)
+        if not include_solvent:
+            new_chains = [c for c in new_chains if c.chain_type != 'Solvent']
+        for chain in new_chains:
+            chain.set_parent(model)
+        model.child_list = new_chains
+        model.child_dict = {c.id: c for c in new_chains}
+    return structure
+
+
 def compare_psf(psf1: PSFData, psf2: PSFData, verbose: bool = False) -> Dict[str, Any]:
     """Compare two PSF data structures.
 
+    Both inputs are compared in their columnar form; sections are diffed
+    with vectorized array operations.
+
     Parameters
     ----------
-    psf1 : PSFData
+    psf1 : PSFData or PSFArrays
         First PSF data
-    psf2 : PSFData
+    psf2 : PSFData or PSFArrays
         Second PSF data
     verbose : bool, default False
         Print detailed comparison results
@@ -440,46 +809,49 @@ def compare_psf(psf1: PSFData, psf2: PSFData, verbose: bool = False) -> Dict[str
         Comparison results with keys: 'equal', 'differences'
     """
     differences = []
+    arrays1, arrays2 = _as_arrays(psf1), _as_arrays(psf2)
+    atoms1, atoms2 = arrays1.atoms, arrays2.atoms
 
     # Compare atom counts
-    if len(psf1.atoms) != len(psf2.atoms):
-        differences.append(f"Atom count: {len(psf1.atoms)} vs {len(psf2.atoms)}")
+    if len(atoms1) != len(atoms2):
+        differences.append(f"Atom count: {len(atoms1)} vs {len(atoms2)}")
 
     # Compare atoms (if same count)
-    if len(psf1.atoms) == len(psf2.atoms):
-        for i, (a1, a2) in enumerate(zip(psf1.atoms, psf2.atoms)):
-            if a1.atomname != a2.atomname:
-                differences.append(f"Atom {i+1} name: {a1.atomname} vs {a2.atomname}")
-            if a1.atomtype != a2.atomtype:
-                differences.append(f"Atom {i+1} type: {a1.atomtype} vs {a2.atomtype}")
-            if abs(a1.charge - a2.charge) > 1e-4:
-                differences.append(f"Atom {i+1} charge: {a1.charge} vs {a2.charge}")
-            if abs(a1.mass - a2.mass) > 1e-4:
-                differences.append(f"Atom {i+1} mass: {a1.mass} vs {a2.mass}")
+    if len(atoms1) == len(atoms2):
+        mismatch = {
+            'atomname': atoms1['atomname'] != atoms2['atomname'],
+            'atomtype': atoms1['atomtype'] != atoms2['atomtype'],
+            'charge': np.abs(atoms1['charge'] - atoms2['charge']) > 1e-4,
+            'mass': np.abs(atoms1['mass'] - atoms2['mass']) > 1e-4,
+        }
+        labels = {
+            'atomname': 'name', 'atomtype': 'type',
+            'charge': 'charge', 'mass': 'mass'
+        }
+        any_mismatch = np.logical_or.reduce(list(mismatch.values()))
+        for i in np.flatnonzero(any_mismatch).tolist():
+            for key, mask in mismatch.items():
+                if mask[i]:
+                    differences.append(
+                        f"Atom {i+1} {labels[key]}: "
+                        f"{atoms1[key][i].item()} vs {atoms2[key][i].item()}"
+                    )
 
     # Compare topology counts
-    counts = [
-        ('bonds', len(psf1.bonds), len(psf2.bonds)),
-        ('angles', len(psf1.angles), len(psf2.angles)),
-        ('dihedrals', len(psf1.dihedrals), len(psf2.dihedrals)),
-        ('impropers', len(psf1.impropers), len(psf2.impropers)),
-        ('cmap', len(psf1.cmap), len(psf2.cmap)),
-    ]
-
-    for name, c1, c2 in counts:
+    for name in ('bonds', 'angles', 'dihedrals', 'impropers', 'cmap'):
+        c1, c2 = len(getattr(arrays1, name)), len(getattr(arrays2, name))
         if c1 != c2:
             differences.append(f"{name.capitalize()} count: {c1} vs {c2}")
 
     # Compare bond sets (order-independent)
-    bonds1 = set(tuple(sorted(b)) for b in psf1.bonds)
-    bonds2 = set(tuple(sorted(b)) for b in psf2.bonds)
-    if bonds1 != bonds2:
-        missing1 = bonds2 - bonds1
-        missing2 = bonds1 - bonds2
-        if missing1:
-            differences.append(f"Bonds in psf2 but not psf1: {len(missing1)}")
-        if missing2:
-            differences.append(f"Bonds in psf1 but not psf2: {len(missing2)}")
+    bonds1 = _bond_keys(arrays1.bonds)
+    bonds2 = _bond_keys(arrays2.bonds)
+    n_missing1 = np.setdiff1d(bonds2, bonds1, assume_unique=True).size
+    n_missing2 = np.setdiff1d(bonds1, bonds2, assume_unique=True).size
+    if n_missing1:
+        differences.append(f"Bonds in psf2 but not psf1: {n_missing1}")
+    if n_missing2:
+        differences.append(f"Bonds in psf1 but not psf2: {n_missing2}")
 
     result = {
         'equal': len(differences) == 0,
@@ -14,9 +14,53 @@ Format specification (from CHARMM source io/psfres.F90):
 
 from typing import Union, List, Dict, Tuple, Optional, Any
 from dataclasses import dataclass
+import numpy as np
 from crimm.StructEntities import Model, Residue, Atom
 from crimm.StructEntities.Chain import Chain
 from crimm.StructEntities.TopoElements import CMap
+from crimm.Utils.Instrumentation import instrumented, count
+
+# Number of lines formatted per chunk when streaming a PSF
+PSF_CHUNK_LINES = 1 << 16
+
+
+def _format_fixed_width_ints(
+    values: np.ndarray, width: int, items_per_line: int
+) -> str:
+    """Format integers as right-aligned fixed-width fields.
+
+    Digits are computed for the whole array at once and assembled as an
+    ASCII byte matrix, which gives the same text as formatting each value
+    with f"{value:>{width}d}" and joining items_per_line values per line.
+    Values that do not fit in the field (or are negative) fall back to
+    Python formatting.
+
+    Returns the lines joined by newlines, without a trailing newline.
+    """
+    values = np.asarray(values, dtype=np.int64).ravel()
+    if values.size == 0:
+        return ""
+    if values.min() < 0 or values.max() >= 10**width:
+        return "\n".join(
+            "".join(f"{idx:>{width}d}" for idx in values[i:i + items_per_line].tolist())
+            for i in range(0, values.size, items_per_line)
+        )
+    powers = 10 ** np.arange(width - 1, -1, -1, dtype=np.int64)
+    chars = (values[:, None] // powers % 10 + ord('0')).astype(np.uint8)
+    # Blank out leading zeros, but always keep the last digit
+    leading = values[:, None] < powers
+    leading[:, -1] = False
+    chars[leading] = ord(' ')
+
+    n_full = values.size // items_per_line * items_per_line
+    full = chars[:n_full].reshape(-1, items_per_line * width)
+    lines = np.empty((full.shape[0], full.shape[1] + 1), dtype=np.uint8)
+    lines[:, :-1] = full
+    lines[:, -1] = ord('\n')
+    text = lines.tobytes().decode('ascii')
+    if n_full < values.size:
+        return text + chars[n_full:].tobytes().decode('ascii')
+    return text[:-1]
 
 
 @dataclass
@@ -52,6 +96,10 @@ class PSFWriter:
         self.xplor = xplor
         self._atom_map: Dict[Atom, int] = {}
         self._atoms: List[Atom] = []
+        # Ordered (first PSF index, atoms or array-backed solvent chain) blocks
+        self._atom_blocks: List[Tuple[int, Any]] = []
+        self._bulk_offsets: Dict[Any, int] = {}  # First PSF index of array-backed chains
+        self._n_atoms = 0
         self._lonepairs: List[LonePairInfo] = []
         self._segid_map: Dict[Any, str] = {}  # Maps chain to assigned segid
 
@@ -102,7 +150,12 @@ class PSFWriter:
                             )
 
             # Check 2: Atoms without topology definitions
-            for residue in chain.get_residues():
+            # (all molecules of array-backed solvent share the template residue)
+            if getattr(chain, 'is_array_backed', False):
+                residues = [chain.template]
+            else:
+                residues = chain.get_residues()
+            for residue in residues:
                 res_id = f"{residue.resname} {residue.id[1]}"
                 res_def = getattr(residue, 'topo_definition', None)
 
@@ -148,21 +201,45 @@ class PSFWriter:
 
         return issues
 
-    def write(self, model: Model, filepath: str, title: str = "") -> None:
+    @instrumented('psf_write')
+    def write(self, model: Model, filepath, title: str = "") -> None:
         """Write PSF file for the given Model.
 
+        The file is written in chunks as the sections are formatted, so the
+        full PSF string is never held in memory.
+
         Parameters
         ----------
         model : Model
             The Model object with topology to write
-        filepath : str
-            Path to output file
+        filepath : str or file-like
+            Path to output file, or an open text file handle
         title : str, default ""
             Title line(s) for the PSF header
         """
-        psf_str = self.get_psf_string(model, title)
-        with open(filepath, 'w', encoding='utf-8') as f:
-            f.write(psf_str)
+        n_chars = 0
+        if hasattr(filepath, 'write'):
+            for chunk in self.iter_psf_chunks(model, title):
+                filepath.write(chunk)
+                n_chars += len(chunk)
+        else:
+            with open(filepath, 'w', encoding='utf-8') as f:
+                for chunk in self.iter_psf_chunks(model, title):
+                    f.write(chunk)
+                    n_chars += len(chunk)
+        # PSF files are ASCII, one byte per character
+        count('bytes_written', n_chars)
+
+    def get_atom_blocks(self) -> List[Tuple[int, Any]]:
+        """Return the atom blocks of the last written entity in PSF atom order.
+
+        Returns
+        -------
+        List[Tuple[int, Any]]
+            (first atom index (1-indexed), block) pairs, where block is either
+            a list of Atom objects or an array-backed solvent chain
+        """
+        return list(self._atom_blocks)
 
     def _get_chains(self, entity: Union[Model, Chain]) -> List[Chain]:
         """Normalize input to a list of chains.
@@ -247,6 +324,7 @@ class PSFWriter:
 
         return combined
 
+    @instrumented('psf_write')
     def get_psf_string(self, model: Union[Model, Chain], title: str = "") -> str:
         """Return PSF content as string.
 
@@ -262,9 +340,117 @@ class PSFWriter:
         str
             PSF format string
         """
+        psf_string = "".join(self.iter_psf_chunks(model, title))
+        count('bytes_written', len(psf_string))
+        return psf_string
+
+    def iter_psf_chunks(self, model: Union[Model, Chain], title: str = ""):
+        """Generate the PSF content in chunks of at most PSF_CHUNK_LINES lines.
+
+        Concatenating the chunks gives the same string as get_psf_string.
+
+        Parameters
+        ----------
+        model : Model or Chain
+            The Model or Chain object with topology to write
+        title : str, default ""
+            Title line(s) for the PSF header
+
+        Yields
+        ------
+        str
+            Consecutive pieces of the PSF file
+        """
+        topology, has_cmap = self._prepare(model)
+
+        # Sections are generators, each section is only formatted when it
+        # is reached
+        sections = [
+            iter([self._write_header(has_cmap)]),
+            iter([self._write_title(title, model)]),
+            self._iter_atoms(),
+            self._iter_topo_section(topology, 'bonds', "NBOND: bonds", 4),
+            self._iter_topo_section(topology, 'angles', "NTHETA: angles", 3),
+            self._iter_topo_section(topology, 'dihedrals', "NPHI: dihedrals", 2),
+            self._iter_topo_section(topology, 'impropers', "NIMPHI: impropers", 2),
+            self._iter_donors(model),
+            self._iter_acceptors(model),
+            self._iter_nonbonded(),
+            self._iter_groups(model),
+            # Lone pair section (CHARMM always writes this, even if 0)
+            # Must come before CMAP section
+            iter([self._write_lonepairs()]),
+        ]
+
+        # CMAP section (if present) - always last
+        if has_cmap:
+            sections.append(iter([self._write_cmap(topology)]))
+
+        # Join sections with blank lines between them (CHARMM format)
+        for i, section in enumerate(sections):
+            if i > 0:
+                yield "\n\n"
+            yield from section
+        yield "\n"
+
+    def get_topology_arrays(self, model: Model) -> Dict[str, Any]:
+        """Return the atoms and topology elements of a Model in PSF order as
+        arrays, without formatting the PSF file (e.g. for building a simulation
+        system in memory).
+
+        Parameters
+        ----------
+        model : Model or Chain
+            The Model or Chain object with topology
+
+        Returns
+        -------
+        dict
+            'atom_blocks': the atom blocks (see get_atom_blocks),
+            'atom_types', 'charges', 'masses': (n_atoms,) arrays,
+            'bonds', 'angles', 'dihedrals', 'impropers', 'cmap': (n, k) arrays
+            of 0-indexed atom indices,
+            'n_lonepairs': number of lone pairs
+        """
+        topology, has_cmap = self._prepare(model)
+        atom_types, charges, masses = [], [], []
+        for _, block in self._atom_blocks:
+            if isinstance(block, list):
+                atom_params = [self._get_atom_params(atom) for atom in block]
+            else:
+                atom_params = [
+                    self._get_atom_params(atom) 
+                    for atom in block.template.get_atoms()
+                ] * len(block)
+            for atom_type, charge, mass in atom_params:
+                atom_types.append(atom_type)
+                charges.append(charge)
+                masses.append(mass)
+        arrays = {
+            'atom_blocks': self.get_atom_blocks(),
+            'atom_types': np.array(atom_types, dtype=object),
+            'charges': np.array(charges, dtype=float),
+            'masses': np.array(masses, dtype=float),
+            'n_lonepairs': len(self._lonepairs),
+        }
+        for topo_type, n_atoms in (
+            ('bonds', 2), ('angles', 3), ('dihedrals', 4), ('impropers', 4)
+        ):
+            indices = self._get_topo_indices(topology, topo_type)
+            arrays[topo_type] = np.asarray(indices, dtype=np.int64).reshape(-1, n_atoms) - 1
+        cmap_indices = self._get_cmap_indices(topology) if has_cmap else []
+        arrays['cmap'] = np.asarray(cmap_indices, dtype=np.int64).reshape(-1, 8) - 1
+        return arrays
+
+    def _prepare(self, model: Model):
+        """Reset the writer state, validate the model and build the atom index
+        map. Return the topology container and if CMAP terms are present."""
         # Reset state
         self._atom_map = {}
         self._atoms = []
+        self._atom_blocks = []
+        self._bulk_offsets = {}
+        self._n_atoms = 0
         self._lonepairs = []
         self._segid_map = {}
 
@@ -297,31 +483,7 @@ class PSFWriter:
 
         # Build atom index map (including lone pairs)
         self._build_atom_index_map(model)
-
-        # Build sections
-        sections = []
-        sections.append(self._write_header(has_cmap))
-        sections.append(self._write_title(title, model))
-        sections.append(self._write_atoms(model))
-        sections.append(self._write_bonds(topology))
-        sections.append(self._write_angles(topology))
-        sections.append(self._write_dihedrals(topology))
-        sections.append(self._write_impropers(topology))
-        sections.append(self._write_donors(model))
-        sections.append(self._write_acceptors(model))
-        sections.append(self._write_nonbonded())
-        sections.append(self._write_groups(model))
-
-        # Lone pair section (CHARMM always writes this, even if 0)
-        # Must come before CMAP section
-        sections.append(self._write_lonepairs())
-
-        # CMAP section (if present) - always last
-        if has_cmap:
-            sections.append(self._write_cmap(topology))
-
-        # Join sections with blank lines between them (CHARMM format)
-        return "\n\n".join(sections) + "\n"
+        return topology, has_cmap
 
     def _assign_segids(self, model: Union[Model, Chain]) -> None:
         """Assign automatic segment IDs to chains without segids.
@@ -345,6 +507,13 @@ class PSFWriter:
 
         chains = [model] if isinstance(model, Chain) else model
         for chain in chains:
+            if getattr(chain, 'is_array_backed', False):
+                # Array-backed solvent keeps a single segid for all molecules
+                if not (chain.segid and chain.segid.strip()):
+                    chain.segid = 'SOLV'
+                self._segid_map[chain] = chain.segid
+                continue
+
             # Check if chain already has segid set on its residues
             # Note: segid might be whitespace-only ('    '), which is truthy but empty
             has_segid = False
@@ -417,6 +586,8 @@ class PSFWriter:
         """
         cmaps = []
         for chain in self._get_chains(model):
+            if getattr(chain, 'is_array_backed', False) and not chain.template.cmap:
+                continue
             residues = list(chain.get_residues())
             for i, res in enumerate(residues):
                 if not hasattr(res, 'cmap') or not res.cmap:
@@ -512,11 +683,22 @@ class PSFWriter:
         # Normalize input: if Chain, wrap in list; if Model, iterate directly
         chains = [model] if isinstance(model, Chain) else model
         for chain in chains:
+            if getattr(chain, 'is_array_backed', False):
+                # Array-backed solvent occupies a contiguous index range and
+                # is written directly from its arrays
+                self._bulk_offsets[chain] = idx
+                self._atom_blocks.append((idx, chain))
+                idx += chain.n_atoms
+                continue
+
+            block_atoms = []
+            self._atom_blocks.append((idx, block_atoms))
             for residue in chain:
                 # Regular atoms
                 for atom in residue.get_atoms():
                     self._atom_map[atom] = idx
                     self._atoms.append(atom)
+                    block_atoms.append(atom)
                     idx += 1
 
                 # Lone pairs (for CGENFF ligands)
@@ -524,6 +706,7 @@ class PSFWriter:
                     for lp_name, lp_atom in residue.lone_pair_dict.items():
                         self._atom_map[lp_atom] = idx
                         self._atoms.append(lp_atom)
+                        block_atoms.append(lp_atom)
                         idx += 1
                         # Track lone pair info for NUMLP section
                         # Find host atom from topology definition
@@ -539,6 +722,7 @@ class PSFWriter:
                                         angle=lp_def.lonepair_info.get('angle', 0.0),
                                         dihedral=lp_def.lonepair_info.get('dihedral', 0.0)
                                     ))
+        self._n_atoms = idx - 1
 
     def _write_header(self, has_cmap: bool) -> str:
         """Write PSF header line with format keywords."""
@@ -595,54 +779,94 @@ class PSFWriter:
             lines.append(padded_line)
         return "\n".join(lines)
 
-    def _write_atoms(self, model: Model) -> str:
-        """Write NATOM section with atom properties."""
-        lines = []
-        lines.append(self._format_section_header(len(self._atoms), "NATOM"))
-
-        for atom in self._atoms:
-            serial = self._atom_map[atom]
-            residue = atom.parent
-
-            # Get residue/segment info
-            if residue is not None:
-                segid = residue.segid or ""
-                resid = str(residue.id[1])
-                resname = residue.resname
-            else:
-                segid = ""
-                resid = "1"
-                resname = "UNK"
-
-            atomname = atom.name
+    def _iter_atoms(self):
+        """Generate the NATOM section with atom properties in chunks.
 
-            # Get topology info
-            if atom.topo_definition is not None:
-                atomtype = atom.topo_definition.atom_type
-                charge = atom.topo_definition.charge
-                mass = atom.topo_definition.mass
-            else:
-                # Missing topology - use fallback values with warning
-                import warnings
-                warnings.warn(
-                    f"Atom {atom.name} in residue {residue.resname} {residue.id} "
-                    f"has no topology definition. Using fallback values: "
-                    f"type={atom.element or 'X'}, charge=0.0, mass={atom.mass or 0.0}. "
-                    f"Simulation results may be incorrect!",
-                    UserWarning
-                )
-                atomtype = atom.element or "X"
-                charge = 0.0
-                mass = atom.mass if atom.mass else 0.0
-
-            imove = 0  # Movement flag (0 = free to move, non-zero = constrained)
+        The residue and atom parts of each line are formatted once per
+        residue and once per distinct atom (name, type, charge, mass), and
+        then only combined with the serial number.
+        """
+        yield self._format_section_header(self._n_atoms, "NATOM")
 
-            lines.append(self._format_atom_line(
-                serial, segid, resid, resname, atomname,
-                atomtype, charge, mass, imove
-            ))
+        imove = 0  # Movement flag (0 = free to move, non-zero = constrained)
+        serial_fmt = "%10d" if self.extended else "%8d"
+        tail_cache = {}
+        lines = []
+        for start, block in self._atom_blocks:
+            if not isinstance(block, list):
+                for chunk in self._iter_bulk_atom_lines(block, start, imove):
+                    lines.extend(chunk)
+                    if len(lines) >= PSF_CHUNK_LINES:
+                        yield "\n" + "\n".join(lines)
+                        lines = []
+                continue
 
-        return "\n".join(lines)
+            last_residue = prefix = None
+            for atom in block:
+                residue = atom.parent
+                if prefix is None or residue is not last_residue:
+                    # Get residue/segment info
+                    if residue is not None:
+                        prefix = self._format_atom_prefix(
+                            residue.segid or "", str(residue.id[1]), residue.resname
+                        )
+                    else:
+                        prefix = self._format_atom_prefix("", "1", "UNK")
+                    last_residue = residue
+
+                key = (atom.name, *self._get_atom_params(atom))
+                if (tail := tail_cache.get(key)) is None:
+                    tail = tail_cache[key] = self._format_atom_tail(*key, imove)
+                lines.append(serial_fmt % self._atom_map[atom] + prefix + tail)
+                if len(lines) >= PSF_CHUNK_LINES:
+                    yield "\n" + "\n".join(lines)
+                    lines = []
+        if lines:
+            yield "\n" + "\n".join(lines)
+
+    def _get_atom_params(self, atom: Atom) -> Tuple[str, float, float]:
+        """Return (atom type, charge, mass) of an atom from its topology."""
+        if atom.topo_definition is not None:
+            return (
+                atom.topo_definition.atom_type,
+                atom.topo_definition.charge,
+                atom.topo_definition.mass
+            )
+        # Missing topology - use fallback values with warning
+        import warnings
+        residue = atom.parent
+        warnings.warn(
+            f"Atom {atom.name} in residue {residue.resname} {residue.id} "
+            f"has no topology definition. Using fallback values: "
+            f"type={atom.element or 'X'}, charge=0.0, mass={atom.mass or 0.0}. "
+            f"Simulation results may be incorrect!",
+            UserWarning
+        )
+        mass = atom.mass if atom.mass else 0.0
+        return atom.element or "X", 0.0, mass
+
+    def _iter_bulk_atom_lines(self, chain, start: int, imove: int):
+        """Generate the atom lines of an array-backed solvent chain from its
+        template residue and residue number array, in lists of lines."""
+        template = chain.template
+        tails = [
+            self._format_atom_tail(atom.name, *self._get_atom_params(atom), imove)
+            for atom in template.get_atoms()
+        ]
+        segid = chain.segid or ""
+        serial_fmt = "%10d" if self.extended else "%8d"
+        n_tails = len(tails)
+        resseqs = chain.resseqs.tolist()
+        res_per_chunk = max(PSF_CHUNK_LINES // max(n_tails, 1), 1)
+        serial = start
+        for i in range(0, len(resseqs), res_per_chunk):
+            lines = []
+            for resseq in resseqs[i:i + res_per_chunk]:
+                prefix = self._format_atom_prefix(segid, str(resseq), template.resname)
+                for tail in tails:
+                    lines.append(serial_fmt % serial + prefix + tail)
+                    serial += 1
+            yield lines
 
     def _format_g14_6(self, value: float) -> str:
         """Format a float value in Fortran G14.6 style.
@@ -668,156 +892,240 @@ class PSFWriter:
         atomname: str, atomtype: str, charge: float, mass: float, imove: int
     ) -> str:
         """Format a single atom line using Fortran-compatible G14.6 format."""
+        serial_str = f"{serial:>10d}" if self.extended else f"{serial:>8d}"
+        return (
+            serial_str
+            + self._format_atom_prefix(segid, resid, resname)
+            + self._format_atom_tail(atomname, atomtype, charge, mass, imove)
+        )
+
+    def _format_atom_prefix(self, segid: str, resid: str, resname: str) -> str:
+        """Format the residue part of an atom line (after the serial number)."""
+        if self.extended:
+            # Extended XPLOR format: I10 A8 A8 A8 A8 A6 2G14.6 I8
+            return f" {segid:<8s} {resid:<8s} {resname:<8s} "
+        # Standard XPLOR format: I8 A4 A4 A4 A4 A4 2G14.6 I8
+        return f" {segid:<4s} {resid:<4s} {resname:<4s} "
+
+    def _format_atom_tail(
+        self, atomname: str, atomtype: str, charge: float, mass: float, imove: int
+    ) -> str:
+        """Format the atom part of an atom line (name, type, charge, mass, imove)."""
         charge_str = self._format_g14_6(charge)
         mass_str = self._format_g14_6(mass)
-
         if self.extended:
-            # Extended XPLOR format: I10 A8 A8 A8 A8 A6 2G14.6 I8
-            return (
-                f"{serial:>10d} {segid:<8s} {resid:<8s} {resname:<8s} "
-                f"{atomname:<8s} {atomtype:<6s}{charge_str}{mass_str}{imove:>8d}"
-            )
-        else:
-            # Standard XPLOR format: I8 A4 A4 A4 A4 A4 2G14.6 I8
-            return (
-                f"{serial:>8d} {segid:<4s} {resid:<4s} {resname:<4s} "
-                f"{atomname:<4s} {atomtype:<4s}{charge_str}{mass_str}{imove:>8d}"
-            )
+            return f"{atomname:<8s} {atomtype:<6s}{charge_str}{mass_str}{imove:>8d}"
+        return f"{atomname:<4s} {atomtype:<4s}{charge_str}{mass_str}{imove:>8d}"
 
-    def _write_bonds(self, topology) -> str:
-        """Write NBOND section."""
-        bonds = topology.bonds if topology.bonds else []
-        indices = []
-        for bond in bonds:
-            a1, a2 = bond
-            if a1 in self._atom_map and a2 in self._atom_map:
-                indices.extend([self._atom_map[a1], self._atom_map[a2]])
-        return self._format_index_section(indices, "NBOND: bonds", items_per_line=4)
-
-    def _write_angles(self, topology) -> str:
-        """Write NTHETA section."""
-        angles = topology.angles if topology.angles else []
-        indices = []
-        for angle in angles:
-            a1, a2, a3 = angle
-            if all(a in self._atom_map for a in (a1, a2, a3)):
-                indices.extend([
-                    self._atom_map[a1],
-                    self._atom_map[a2],
-                    self._atom_map[a3]
-                ])
-        return self._format_index_section(indices, "NTHETA: angles", items_per_line=3)
-
-    def _write_dihedrals(self, topology) -> str:
-        """Write NPHI section."""
-        dihedrals = topology.dihedrals if topology.dihedrals else []
-        indices = []
-        for dihe in dihedrals:
-            atoms = list(dihe)
-            if all(a in self._atom_map for a in atoms):
-                indices.extend([self._atom_map[a] for a in atoms])
-        return self._format_index_section(indices, "NPHI: dihedrals", items_per_line=2)
+    def _get_topo_indices(self, topology, topo_type: str) -> np.ndarray:
+        """Collect the flattened PSF indices of one topology element type.
 
-    def _write_impropers(self, topology) -> str:
-        """Write NIMPHI section."""
-        impropers = topology.impropers if topology.impropers else []
-        indices = []
-        for impr in impropers:
-            atoms = list(impr)
-            if all(a in self._atom_map for a in atoms):
-                indices.extend([self._atom_map[a] for a in atoms])
-        return self._format_index_section(indices, "NIMPHI: impropers", items_per_line=2)
-
-    def _write_donors(self, model: Union[Model, Chain]) -> str:
-        """Write NDON section.
+        Array-backed solvent chains contribute their implicit index arrays,
+        so no per-molecule element objects are created for them. Elements
+        with atoms outside the atom map are skipped.
+        """
+        if hasattr(topology, 'disu_bonds'):
+            # ModelTopology: disulfide bonds first, then chains in order
+            sources = [topology.disu_bonds] if topo_type == 'bonds' else []
+            sources.extend(
+                chain.topology for chain in topology.containing_entity
+                if chain.topology is not None
+            )
+        else:
+            sources = [topology]
+
+        index_arrays = []
+        for source in sources:
+            chain = getattr(source, 'containing_entity', None)
+            if chain in self._bulk_offsets:
+                index_array = source.get_index_array(
+                    topo_type, self._bulk_offsets[chain]
+                )
+                index_arrays.append(index_array.ravel())
+                continue
+            get_local = getattr(source, 'get_local_index_array', None)
+            local = get_local(topo_type) if get_local is not None else None
+            if local is not None:
+                # elements still stored as graph atom indices
+                atoms, local_indices = local
+                atom_indices = np.array(
+                    [self._atom_map.get(a, -1) for a in atoms], dtype=np.int64
+                )
+                mapped = atom_indices[local_indices]
+                mapped = mapped[(mapped >= 0).all(axis=1)]
+                index_arrays.append(mapped.ravel())
+                continue
+            if isinstance(source, list):
+                elements = source
+            else:
+                elements = getattr(source, topo_type, None) or []
+            indices = []
+            for element in elements:
+                if all(a in self._atom_map for a in element):
+                    indices.extend([self._atom_map[a] for a in element])
+            index_arrays.append(indices)
+        return self._concat_indices(index_arrays)
+
+    def _iter_topo_section(
+        self, topology, topo_type: str, label: str, items_per_line: int
+    ):
+        """Generate a bond, angle, dihedral or improper section."""
+        indices = self._get_topo_indices(topology, topo_type)
+        yield from self._iter_index_section(indices, label, items_per_line)
+
+    def _get_residue_donors(self, residue: Residue) -> List[Tuple[Atom, Atom]]:
+        """Return (heavy_atom, hydrogen) donor pairs of a residue."""
+        donors = []
+        if not (hasattr(residue, 'H_donors') and residue.H_donors):
+            return donors
+        for donor_pair in residue.H_donors:
+            if len(donor_pair) >= 2:
+                # RTF stores (hydrogen, heavy) but PSF writes (heavy, hydrogen)
+                first, second = donor_pair[0], donor_pair[1]
+
+                # Handle both string names and Atom objects
+                if isinstance(first, str):
+                    # Tuple of atom names from RTF: (hydrogen, heavy)
+                    h_name, d_name = first, second
+                    if h_name in residue and d_name in residue:
+                        h_atom = residue[h_name]
+                        d_atom = residue[d_name]
+                    else:
+                        continue
+                else:
+                    # Atom objects directly
+                    h_atom, d_atom = first, second
+                donors.append((d_atom, h_atom))
+        return donors
+
+    def _get_residue_acceptors(
+        self, residue: Residue
+    ) -> List[Tuple[Atom, Optional[Atom]]]:
+        """Return (acceptor, antecedent) pairs of a residue. The antecedent
+        is None if not specified."""
+        acceptors = []
+        if not (hasattr(residue, 'H_acceptors') and residue.H_acceptors):
+            return acceptors
+        for acc_info in residue.H_acceptors:
+            # Handle both tuple of names and Atom objects
+            if isinstance(acc_info, (list, tuple)):
+                if len(acc_info) >= 2:
+                    first, second = acc_info[0], acc_info[1]
+                    if isinstance(first, str):
+                        # Tuple of atom names: (acceptor, antecedent)
+                        acc_name, ante_name = first, second
+                        if acc_name in residue and ante_name in residue:
+                            acc_atom = residue[acc_name]
+                            ante_atom = residue[ante_name]
+                        else:
+                            continue
+                    else:
+                        # Atom objects directly
+                        acc_atom, ante_atom = first, second
+                elif len(acc_info) == 1:
+                    # Single acceptor (no antecedent specified)
+                    acc_name = acc_info[0]
+                    if isinstance(acc_name, str):
+                        if acc_name in residue:
+                            acc_atom = residue[acc_name]
+                            ante_atom = None
+                        else:
+                            continue
+                    else:
+                        acc_atom = acc_name
+                        ante_atom = None
+                else:
+                    continue
+            else:
+                # Single Atom object
+                acc_atom = acc_info
+                ante_atom = None
+            acceptors.append((acc_atom, ante_atom))
+        return acceptors
+
+    def _tile_template_atoms(
+        self, chain, template_atoms: List[Tuple[Optional[Atom], ...]]
+    ) -> np.ndarray:
+        """Map tuples of template residue atoms to the PSF indices of the same
+        atoms in every molecule of an array-backed solvent chain. Atoms that
+        are None (or not in the template) are written as index 0."""
+        n_cols = len(template_atoms[0]) if template_atoms else 1
+        local_index = {
+            atom: i for i, atom in enumerate(chain.template.get_atoms())
+        }
+        local = np.array(
+            [[local_index.get(atom, -1) for atom in atoms] for atoms in template_atoms],
+            dtype=np.int64
+        ).reshape(-1, n_cols)
+        missing = local < 0
+        tiled = chain.tile_local_indices(
+            np.where(missing, 0, local), self._bulk_offsets[chain]
+        )
+        tiled[np.tile(missing, (len(chain), 1))] = 0
+        return tiled
+
+    def _iter_donors(self, model: Union[Model, Chain]):
+        """Generate NDON section.
 
         RTF format: DONOR HN N (hydrogen, heavy_atom)
         PSF format: (heavy_atom, hydrogen) - so we swap the order
         """
-        indices = []
+        index_arrays = []
         for chain in self._get_chains(model):
+            if chain in self._bulk_offsets:
+                donors = self._get_residue_donors(chain.template)
+                index_arrays.append(self._tile_template_atoms(chain, donors).ravel())
+                continue
+            indices = []
+            index_arrays.append(indices)
             for residue in chain:
-                if hasattr(residue, 'H_donors') and residue.H_donors:
-                    for donor_pair in residue.H_donors:
-                        if len(donor_pair) >= 2:
-                            # RTF stores (hydrogen, heavy) but PSF writes (heavy, hydrogen)
-                            first, second = donor_pair[0], donor_pair[1]
-
-                            # Handle both string names and Atom objects
-                            if isinstance(first, str):
-                                # Tuple of atom names from RTF: (hydrogen, heavy)
-                                h_name, d_name = first, second
-                                if h_name in residue and d_name in residue:
-                                    h_atom = residue[h_name]
-                                    d_atom = residue[d_name]
-                                else:
-                                    continue
-                            else:
-                                # Atom objects directly
-                                h_atom, d_atom = first, second
-
-                            if d_atom in self._atom_map and h_atom in self._atom_map:
-                                # Write as (heavy, hydrogen) for PSF format
-                                indices.extend([
-                                    self._atom_map[d_atom],
-                                    self._atom_map[h_atom]
-                                ])
-        return self._format_index_section(indices, "NDON: donors", items_per_line=4)
-
-    def _write_acceptors(self, model: Union[Model, Chain]) -> str:
-        """Write NACC section.
+                for d_atom, h_atom in self._get_residue_donors(residue):
+                    if d_atom in self._atom_map and h_atom in self._atom_map:
+                        # Write as (heavy, hydrogen) for PSF format
+                        indices.extend([
+                            self._atom_map[d_atom],
+                            self._atom_map[h_atom]
+                        ])
+        yield from self._iter_index_section(
+            self._concat_indices(index_arrays), "NDON: donors", items_per_line=4
+        )
+
+    def _iter_acceptors(self, model: Union[Model, Chain]):
+        """Generate NACC section.
 
         RTF format: ACCE O C (acceptor, antecedent)
         PSF format: (acceptor, antecedent) - same order
         """
-        indices = []
+        index_arrays = []
         for chain in self._get_chains(model):
+            if chain in self._bulk_offsets:
+                acceptors = self._get_residue_acceptors(chain.template)
+                index_arrays.append(self._tile_template_atoms(chain, acceptors).ravel())
+                continue
+            indices = []
+            index_arrays.append(indices)
             for residue in chain:
-                if hasattr(residue, 'H_acceptors') and residue.H_acceptors:
-                    for acc_info in residue.H_acceptors:
-                        # Handle both tuple of names and Atom objects
-                        if isinstance(acc_info, (list, tuple)):
-                            if len(acc_info) >= 2:
-                                first, second = acc_info[0], acc_info[1]
-                                if isinstance(first, str):
-                                    # Tuple of atom names: (acceptor, antecedent)
-                                    acc_name, ante_name = first, second
-                                    if acc_name in residue and ante_name in residue:
-                                        acc_atom = residue[acc_name]
-                                        ante_atom = residue[ante_name]
-                                    else:
-                                        continue
-                                else:
-                                    # Atom objects directly
-                                    acc_atom, ante_atom = first, second
-                            elif len(acc_info) == 1:
-                                # Single acceptor (no antecedent specified)
-                                acc_name = acc_info[0]
-                                if isinstance(acc_name, str):
-                                    if acc_name in residue:
-                                        acc_atom = residue[acc_name]
-                                        ante_atom = None
-                                    else:
-                                        continue
-                                else:
-                                    acc_atom = acc_name
-                                    ante_atom = None
-                            else:
-                                continue
-                        else:
-                            # Single Atom object
-                            acc_atom = acc_info
-                            ante_atom = None
-
-                        if acc_atom in self._atom_map:
-                            acc_idx = self._atom_map[acc_atom]
-                            # Use antecedent index if available, otherwise 0
-                            ante_idx = self._atom_map.get(ante_atom, 0) if ante_atom else 0
-                            indices.extend([acc_idx, ante_idx])
-        return self._format_index_section(indices, "NACC: acceptors", items_per_line=4)
-
-    def _write_nonbonded(self) -> str:
-        """Write NNB section (non-bonded exclusion list).
+                for acc_atom, ante_atom in self._get_residue_acceptors(residue):
+                    if acc_atom in self._atom_map:
+                        acc_idx = self._atom_map[acc_atom]
+                        # Use antecedent index if available, otherwise 0
+                        ante_idx = self._atom_map.get(ante_atom, 0) if ante_atom else 0
+                        indices.extend([acc_idx, ante_idx])
+        yield from self._iter_index_section(
+            self._concat_indices(index_arrays), "NACC: acceptors", items_per_line=4
+        )
+
+    @staticmethod
+    def _concat_indices(index_arrays: List[Any]) -> np.ndarray:
+        """Concatenate index lists and arrays into one integer array."""
+        if not index_arrays:
+            return np.empty(0, dtype=np.int64)
+        return np.concatenate([
+            np.asarray(indices, dtype=np.int64) for indices in index_arrays
+        ])
+
+    def _iter_nonbonded(self):
+        """Generate NNB section (non-bonded exclusion list).
 
         PSF format for NNB section:
         - Header: NNB !NNB (number of explicit exclusion pairs)
@@ -827,32 +1135,36 @@ class PSFWriter:
         For simplicity, write NNB=0 (no explicit exclusions beyond bonded).
         The INBLO array still needs to be output (all zeros).
         """
-        lines = []
         nnb = 0  # Number of explicit exclusion pairs (not atom count!)
 
         # Header: "       0 !NNB"
-        lines.append(self._format_section_header(nnb, "NNB"))
-
         # CHARMM format requires blank line after NNB header before INBLO array
-        lines.append("")
+        yield self._format_section_header(nnb, "NNB") + "\n"
 
         # INBLO array: one entry per atom (all zeros = no exclusions)
-        inblo = [0] * len(self._atoms)
-        if inblo:
-            lines.append(self._format_indices(inblo, items_per_line=8))
+        if self._n_atoms:
+            inblo = np.zeros(self._n_atoms, dtype=np.int64)
+            yield "\n"
+            yield from self._iter_index_lines(inblo, items_per_line=8)
 
-        return "\n".join(lines)
-
-    def _write_groups(self, model: Union[Model, Chain]) -> str:
-        """Write NGRP section (atom groups for charge computation).
+    def _iter_groups(self, model: Union[Model, Chain]):
+        """Generate NGRP section (atom groups for charge computation).
 
         Groups are defined per residue from atom_groups.
         Groups must be sorted by first atom index in ascending order.
         """
-        lines = []
-        groups = []
+        pointer_arrays = []
 
         for chain in self._get_chains(model):
+            if chain in self._bulk_offsets:
+                template_groups = chain.template.atom_groups or []
+                first_atoms = [(group[0],) for group in template_groups if group]
+                pointer_arrays.append(
+                    self._tile_template_atoms(chain, first_atoms).ravel() - 1
+                )
+                continue
+            pointers = []
+            pointer_arrays.append(pointers)
             for residue in chain:
                 if hasattr(residue, 'atom_groups') and residue.atom_groups:
                     for group in residue.atom_groups:
@@ -860,34 +1172,30 @@ class PSFWriter:
                         if group:
                             first_atom = group[0]
                             if first_atom in self._atom_map:
-                                groups.append((
-                                    self._atom_map[first_atom] - 1,  # 0-based pointer
-                                    1,  # Group type (1 for protein/standard groups)
-                                    0   # Move flag (0 = free)
-                                ))
+                                # 0-based pointer
+                                pointers.append(self._atom_map[first_atom] - 1)
 
         # CRITICAL: Groups must be sorted by first atom index (igpbs) in ascending order
         # CHARMM expects groups in order for proper charge neutrality calculations
-        groups.sort(key=lambda x: x[0])
+        pointers = np.sort(self._concat_indices(pointer_arrays), kind='stable')
 
-        ngrp = len(groups)
+        ngrp = len(pointers)
         nst2 = 0  # Number of groups with ST2 flag
 
         # Header: NGRP NST2
         if self.extended:
-            lines.append(f"{ngrp:>10d}{nst2:>10d} !NGRP NST2")
+            yield f"{ngrp:>10d}{nst2:>10d} !NGRP NST2"
         else:
-            lines.append(f"{ngrp:>8d}{nst2:>8d} !NGRP NST2")
+            yield f"{ngrp:>8d}{nst2:>8d} !NGRP NST2"
 
         # Group data (3 integers per group, but 9 integers per line per CHARMM fmt04)
-        indices = []
-        for igpbs, igptyp, imoveg in groups:
-            indices.extend([igpbs, igptyp, imoveg])
-
-        if indices:
-            lines.append(self._format_indices(indices, items_per_line=9))
-
-        return "\n".join(lines)
+        # Group type is 1 for protein/standard groups, move flag 0 = free
+        groups = np.zeros((ngrp, 3), dtype=np.int64)
+        groups[:, 0] = pointers
+        groups[:, 1] = 1
+        if ngrp:
+            yield "\n"
+            yield from self._iter_index_lines(groups, items_per_line=9)
 
     def _write_cmap(self, topology) -> str:
         """Write NCRTERM section (cross-map terms).
@@ -895,6 +1203,12 @@ class PSFWriter:
         Uses self._cmap_terms if available (from residue-level extraction),
         otherwise falls back to topology.cmap.
         """
+        indices = self._get_cmap_indices(topology)
+        # CMAP uses 8 atoms per entry, 1 entry per line (8 integers per line)
+        return self._format_index_section(indices, "NCRTERM: cross-terms", items_per_line=8)
+
+    def _get_cmap_indices(self, topology) -> List[int]:
+        """Collect the flattened PSF indices of the cross-map terms."""
         # Prefer stored CMAP terms from residue extraction
         if hasattr(self, '_cmap_terms') and self._cmap_terms:
             cmaps = self._cmap_terms
@@ -920,9 +1234,7 @@ class PSFWriter:
 
             if all(a in self._atom_map for a in atoms):
                 indices.extend([self._atom_map[a] for a in atoms])
-
-        # CMAP uses 8 atoms per entry, 1 entry per line (8 integers per line)
-        return self._format_index_section(indices, "NCRTERM: cross-terms", items_per_line=8)
+        return indices
 
     def _write_lonepairs(self) -> str:
         """Write NUMLP NUMLPH section for lone pairs.
@@ -967,8 +1279,12 @@ class PSFWriter:
         self, indices: List[int], label: str, items_per_line: int
     ) -> str:
         """Format a section with index data."""
-        lines = []
+        return "".join(self._iter_index_section(indices, label, items_per_line))
 
+    def _iter_index_section(
+        self, indices: Union[List[int], np.ndarray], label: str, items_per_line: int
+    ):
+        """Generate a section with index data (header and index lines)."""
         # Calculate count based on label
         # Each section stores data in a specific format:
         # - bonds, donors, acceptors: pairs (2 ints each)
@@ -988,9 +1304,9 @@ class PSFWriter:
         else:
             count = len(indices)
 
-        lines.append(self._format_section_header(count, label))
+        yield self._format_section_header(count, label)
 
-        if indices:
+        if len(indices) > 0:
             # Calculate actual integers per line (bonds: 4 pairs = 8 ints)
             if "bonds" in label.lower() or "donors" in label.lower() or "acceptors" in label.lower():
                 ints_per_line = items_per_line * 2
@@ -1003,21 +1319,27 @@ class PSFWriter:
             else:
                 ints_per_line = items_per_line
 
-            lines.append(self._format_indices(indices, ints_per_line))
-
-        return "\n".join(lines)
+            yield "\n"
+            yield from self._iter_index_lines(indices, ints_per_line)
 
     def _format_indices(self, indices: List[int], items_per_line: int) -> str:
         """Format a list of indices into lines."""
-        lines = []
-        int_width = 10 if self.extended else 8
+        return "".join(self._iter_index_lines(indices, items_per_line))
 
-        for i in range(0, len(indices), items_per_line):
-            chunk = indices[i:i + items_per_line]
-            line = "".join(f"{idx:>{int_width}d}" for idx in chunk)
-            lines.append(line)
-
-        return "\n".join(lines)
+    def _iter_index_lines(
+        self, indices: Union[List[int], np.ndarray], items_per_line: int
+    ):
+        """Generate index lines in chunks of at most PSF_CHUNK_LINES lines.
+        Chunks are separated by newlines, without a trailing newline."""
+        int_width = 10 if self.extended else 8
+        indices = np.asarray(indices, dtype=np.int64).ravel()
+        chunk_size = PSF_CHUNK_LINES * items_per_line
+        for start in range(0, len(indices), chunk_size):
+            if start > 0:
+                yield "\n"
+            yield _format_fixed_width_ints(
+                indices[start:start + chunk_size], int_width, items_per_line
+            )
 
 
 # Convenience functions
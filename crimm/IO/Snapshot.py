@@ -0,0 +1,805 @@
+"""
+Module for saving and loading prepared crimm models as binary snapshots.
+
+A snapshot stores a model (with its topology, parameters and solvation
+information) in a single versioned file of flat array sections that is
+memory-mapped when it is opened. Nothing in the file is pickled, so opening
+an untrusted snapshot never executes code.
+
+The hierarchy is stored as tables: one row per residue (id, name, segid,
+patch and the offset of its atoms) and one row per atom (name, element,
+serial number, occupancy, B-factor and coordinates). The chains and the model
+attributes are small and kept in the header. Array-backed solvent chains
+(BulkSolvent) are stored as their template residue and the coordinate and
+resseq arrays, which are zero-copy views into the memory-mapped file after
+loading, so a solvated system with a million water atoms is restored without
+creating objects for the solvent.
+
+The topology of the model in PSF order (atom types, charges, masses and the
+index arrays of the topology elements, see PSFWriter.get_topology_arrays) and
+the parameters applied to it (see Snapshot.get_parameter_arrays) are stored
+as separate sections, which are read on access without loading the model.
+The TopologyGenerator is not stored: it is passed to Snapshot.load_model to
+load the residue definitions again.
+
+File layout::
+
+    magic (8 bytes) | version (uint32) | reserved (uint32) |
+    header offset (uint64) | header size (uint64) |
+    sections (aligned to SECTION_ALIGNMENT) | header (JSON)
+
+The header holds the metadata, the chain table and the table of sections
+(offset, size, dtype and shape).
+"""
+import os
+import json
+import mmap
+import struct
+import tempfile
+import numpy as np
+from crimm.IO.PSFWriter import PSFWriter
+from crimm.StructEntities.Model import Model
+from crimm.StructEntities.OrganizedModel import OrganizedModel
+from crimm.StructEntities.Residue import Residue, Heterogen
+from crimm.StructEntities.Atom import Atom
+from crimm.StructEntities.Chain import (
+    Chain, PolymerChain, Heterogens, Ligand, Macrolide, Oligosaccharide,
+    Solvent, BulkSolvent, CoSolvent, Ion, Glycosylation, NucleosidePhosphate
+)
+
+SNAPSHOT_MAGIC = b'CRIMMSNP'
+# Bump when the layout of the snapshot file changes
+SNAPSHOT_VERSION = 2
+SECTION_ALIGNMENT = 64
+_PREAMBLE = struct.Struct('<8sIIQQ')
+# stored for integer fields that are None (e.g. residue author_seq_id)
+_NO_VALUE = np.iinfo(np.int64).min
+TOPOLOGY_ARRAY_NAMES = (
+    'atom_types', 'charges', 'masses', 'bonds', 'angles', 'dihedrals',
+    'impropers', 'cmap'
+)
+# parameter sections: (name, topology array, getter or dict name (see 
+# lookup_params), value fields)
+PARAMETER_SPECS = (
+    ('bonds', 'bonds', 'get_bond', ('kb', 'b0')),
+    ('angles', 'angles', 'get_angle', ('ktheta', 'theta0')),
+    ('urey_bradley', 'angles', 'urey_bradley', ('kub', 's0')),
+    ('dihedrals', 'dihedrals', 'get_dihedral', ('kchi', 'n', 'delta')),
+    ('impropers', 'impropers', 'get_improper', ('kpsi', 'psi0')),
+    ('cmap', 'cmap', 'cmap', ('grid_row',)),
+)
+NONBONDED_FIELDS = ('epsilon', 'rmin_half')
+_CHAIN_CLASSES = {
+    cls.__name__: cls for cls in (
+        Chain, PolymerChain, Heterogens, Ligand, Macrolide, Oligosaccharide,
+        Solvent, CoSolvent, Ion, Glycosylation, NucleosidePhosphate
+    )
+}
+_POLYMER_TYPES = (
+    'Polypeptide(L)', 'Polyribonucleotide', 'Polydeoxyribonucleotide'
+)
+
+def _json_default(obj):
+    """Convert the numpy values in the header (e.g. box_dim) to JSON."""
+    if isinstance(obj, np.generic):
+        return obj.item()
+    if isinstance(obj, np.ndarray):
+        return obj.tolist()
+    raise TypeError(f'{type(obj)} is not JSON serializable!')
+
+def _get_metadata(model):
+    return {
+        'model_id': model.get_id(),
+        'model_class': type(model).__name__,
+        'pdb_id': getattr(model, 'pdb_id', None),
+        'pdbx_description': getattr(model, 'pdbx_description', None),
+        'connect_dict': getattr(model, 'connect_dict', None) or {},
+        'chain_ids': [chain.get_id() for chain in model],
+        'solvation_info': getattr(model, '_solvation_info', None),
+    }
+
+def _get_topology_arrays(model):
+    """Return the flat topology arrays of the model, or None if the model has
+    no topology."""
+    if getattr(model, 'topology', None) is None:
+        return None
+    arrays = PSFWriter().get_topology_arrays(model)
+    atom_types = [
+        '' if atom_type is None else str(atom_type)
+        for atom_type in arrays['atom_types']
+    ]
+    arrays['atom_types'] = np.array(atom_types, dtype=str)
+    return {name: arrays[name] for name in TOPOLOGY_ARRAY_NAMES}
+
+def _get_param_rows(name, param):
+    """Return the value rows of a parameter (several rows for the dihedral
+    terms and the CMAP grid)."""
+    if name == 'dihedrals':
+        return [(term.kchi, term.n, term.delta) for term in param]
+    if name == 'cmap':
+        return [row.values for row in param]
+    return [tuple(param)]
+
+def _pack_params(name, unique_params, inverse):
+    """Return the parameter table of a topology element type: the (N,) index
+    of each element into the table (-1 if not found), the value rows and the
+    row offsets of each table entry."""
+    table_ids = np.full(len(unique_params), -1, dtype=np.int64)
+    rows, offsets = [], [0]
+    for i, param in enumerate(unique_params):
+        if param is None:
+            continue
+        table_ids[i] = len(offsets) - 1
+        rows.extend(_get_param_rows(name, param))
+        offsets.append(len(rows))
+    n_fields = len(rows[0]) if rows else 0
+    return {
+        'index': table_ids[inverse] if len(inverse) else inverse,
+        'values': np.array(rows, dtype=float).reshape(-1, n_fields),
+        'offsets': np.array(offsets, dtype=np.int64),
+    }
+
+def _get_parameter_arrays(model, topology_arrays):
+    """Return the parameter tables of the topology arrays, looked up with the
+    ParameterLoaders of the model (as create_omm_system does), or None if the
+    model has no topology loader."""
+    if getattr(model, 'topology_loader', None) is None:
+        return None
+    # TopoLoader imports crimm.IO, so it is only imported here
+    from crimm.Modeller.TopoLoader import (
+        get_model_param_loaders, lookup_params
+    )
+    param_loaders = get_model_param_loaders(model)
+    atom_types = topology_arrays['atom_types']
+    parameter_arrays = {}
+    for name, array_name, getter_name, _ in PARAMETER_SPECS:
+        type_rows = atom_types[topology_arrays[array_name]]
+        unique_params, inverse = lookup_params(
+            param_loaders, getter_name, type_rows
+        )
+        parameter_arrays[name] = _pack_params(name, unique_params, inverse)
+    lj_types, inverse = np.unique(atom_types, return_inverse=True)
+    for name in ('nonbonded', 'nonbonded14'):
+        unique_params = []
+        for atom_type in lj_types.tolist():
+            param = None
+            for param_loader in param_loaders:
+                if atom_type in param_loader.param_dict['nonbonded']:
+                    param = param_loader.param_dict[name].get(atom_type)
+                    break
+            unique_params.append(param)
+        parameter_arrays[name] = _pack_params(
+            name, unique_params, inverse.reshape(-1)
+        )
+    return parameter_arrays
+
+class _HierarchyTables:
+    """Flatten the chains, residues and atoms of a model into the header
+    chain table and the residue and atom arrays."""
+    def __init__(self):
+        self.chains = []
+        self.bulk_arrays = []
+        self.residues = {
+            'hetflag': [], 'resseq': [], 'icode': [], 'resname': [],
+            'segid': [], 'author_seq_id': [], 'is_heterogen': [], 'patch': []
+        }
+        self.atoms = {
+            'name': [], 'fullname': [], 'element': [], 'altloc': [],
+            'serial': [], 'occupancy': [], 'bfactor': [], 'coords': [],
+            'has_coord': []
+        }
+        self.atom_offsets = [0]
+
+    def add_model(self, model):
+        for chain in model:
+            self.add_chain(chain)
+
+    def add_chain(self, chain):
+        entry = {
+            'id': chain.get_id(),
+            'pdbx_description': chain.pdbx_description,
+            'residue_start': len(self.atom_offsets) - 1,
+        }
+        if isinstance(chain, BulkSolvent) and chain.is_array_backed:
+            entry['class'] = 'BulkSolvent'
+            entry['bulk'] = len(self.bulk_arrays)
+            entry['serial_start'] = chain.serial_start
+            self.bulk_arrays.append((chain._coords, chain._resseqs))
+            self.add_residue(chain.template)
+        else:
+            # a materialized BulkSolvent is a regular Solvent chain
+            cls = Solvent if isinstance(chain, BulkSolvent) else type(chain)
+            if cls.__name__ not in _CHAIN_CLASSES:
+                raise TypeError(
+                    f'Chain class {cls.__name__} of {chain} is not supported '
+                    'by snapshots!'
+                )
+            entry['class'] = cls.__name__
+            for residue in chain:
+                self.add_residue(residue)
+        if isinstance(chain, PolymerChain):
+            entry.update({
+                'entity_id': chain.entity_id,
+                'author_chain_id': chain.author_chain_id,
+                'chain_type': chain.chain_type,
+                'known_seq': str(chain.known_seq),
+                'can_seq': str(chain.can_seq),
+                'reported_res': chain.reported_res,
+                'reported_missing_res': chain.reported_missing_res,
+            })
+        if isinstance(chain, Solvent):
+            entry['source'] = chain.source
+            entry['solvent_model'] = self._get_solvent_model(chain)
+        if (resnames := getattr(chain, 'resnames', None)) is not None:
+            entry['resnames'] = resnames
+        entry['residue_stop'] = len(self.atom_offsets) - 1
+        self.chains.append(entry)
+
+    @staticmethod
+    def _get_solvent_model(chain):
+        """Return the name of the definition (e.g. TIP3) the solvent was
+        generated with, or None if it has no topology."""
+        if isinstance(chain, BulkSolvent) and chain.is_array_backed:
+            residue = chain.template
+        elif len(chain.child_list) > 0:
+            residue = chain.child_list[0]
+        else:
+            return None
+        if residue.topo_definition is None:
+            return None
+        return residue.topo_definition.resname
+
+    def add_residue(self, residue):
+        if residue.is_disordered() or type(residue) not in (Residue, Heterogen):
+            raise TypeError(
+                f'Residue {residue} is disordered or not supported by '
+                'snapshots! Select the alternate locations first (e.g. '
+                'with OrganizedModel).'
+            )
+        hetflag, resseq, icode = residue.get_id()
+        residues = self.residues
+        residues['hetflag'].append(hetflag)
+        residues['resseq'].append(resseq)
+        residues['icode'].append(icode)
+        residues['resname'].append(residue.resname)
+        residues['segid'].append(residue.segid)
+        author_seq_id = getattr(residue, 'author_seq_id', None)
+        residues['author_seq_id'].append(
+            _NO_VALUE if author_seq_id is None else author_seq_id
+        )
+        residues['is_heterogen'].append(isinstance(residue, Heterogen))
+        topo_def = residue.topo_definition
+        patch = getattr(topo_def, 'patch_with', None) if topo_def else None
+        residues['patch'].append(patch or '')
+        atoms = self.atoms
+        for atom in residue.get_atoms():
+            if atom.is_disordered():
+                raise TypeError(
+                    f'Atom {atom} of {residue} is disordered! Select the '
+                    'alternate locations first (e.g. with OrganizedModel).'
+                )
+            atoms['name'].append(atom.name)
+            atoms['fullname'].append(atom.fullname)
+            atoms['element'].append(atom.element or '')
+            atoms['altloc'].append(atom.altloc)
+            atoms['serial'].append(atom.serial_number or 0)
+            atoms['occupancy'].append(atom.occupancy)
+            atoms['bfactor'].append(atom.bfactor)
+            has_coord = atom.coord is not None
+            atoms['has_coord'].append(has_coord)
+            atoms['coords'].append(atom.coord if has_coord else (np.nan,)*3)
+        self.atom_offsets.append(len(atoms['name']))
+
+    def get_arrays(self):
+        """Return the dict of residue, atom and bulk solvent arrays by section
+        name."""
+        arrays = {}
+        res_dtypes = {
+            'resseq': np.int64, 'author_seq_id': np.int64,
+            'is_heterogen': bool
+        }
+        for key, values in self.residues.items():
+            arrays[f'residues/{key}'] = np.array(
+                values, dtype=res_dtypes.get(key, str)
+            )
+        arrays['residues/atom_offsets'] = np.array(
+            self.atom_offsets, dtype=np.int64
+        )
+        atom_dtypes = {
+            'serial': np.int64, 'occupancy': float, 'bfactor': float,
+            'has_coord': bool
+        }
+        for key, values in self.atoms.items():
+            if key == 'coords':
+                continue
+            arrays[f'atoms/{key}'] = np.array(
+                values, dtype=atom_dtypes.get(key, str)
+            )
+        arrays['atoms/coords'] = np.array(
+            self.atoms['coords'], dtype=float
+        ).reshape(-1, 3)
+        for i, (coords, resseqs) in enumerate(self.bulk_arrays):
+            arrays[f'bulk/{i}/coords'] = np.asarray(coords, dtype=float)
+            arrays[f'bulk/{i}/resseqs'] = np.asarray(resseqs, dtype=np.int64)
+        return arrays
+
+class _SectionWriter:
+    """Write aligned sections to a binary file and record their table."""
+    def __init__(self, f):
+        self.f = f
+        self.sections = {}
+
+    def _align(self):
+        pad = -self.f.tell() % SECTION_ALIGNMENT
+        self.f.write(b'\0' * pad)
+
+    def write_array(self, name, array):
+        self._align()
+        array = np.ascontiguousarray(array)
+        self.sections[name] = {
+            'offset': self.f.tell(), 'nbytes': array.nbytes,
+            'dtype': array.dtype.str, 'shape': list(array.shape)
+        }
+        self.f.write(memoryview(array.reshape(-1).view(np.uint8)))
+
+class SnapshotContents:
+    """The header entries and the array sections of a snapshot, collected
+    from a model by collect_snapshot and written to a file with `write`.
+
+    Collecting reads the model and the parameters of its topology loader,
+    while writing only reads the collected arrays. The model can thus be
+    collected where it is prepared (e.g. in the thread generating the
+    topology of the next entries with the same TopologyGenerator) and
+    written elsewhere.
+    """
+    def __init__(self, header, sections):
+        self.header = header
+        self.sections = sections
+
+    def __repr__(self):
+        return (
+            f'<SnapshotContents model={self.header["metadata"]["model_id"]} '
+            f'sections={len(self.sections)}>'
+        )
+
+    def write(self, file_path):
+        """Write the snapshot file. The file is written to a temporary file
+        first, so that an existing snapshot is never left partially
+        written."""
+        file_dir = os.path.dirname(os.path.abspath(file_path))
+        fd, tmp_path = tempfile.mkstemp(dir=file_dir, suffix='.tmp')
+        try:
+            with os.fdopen(fd, 'wb') as f:
+                f.write(_PREAMBLE.pack(SNAPSHOT_MAGIC, SNAPSHOT_VERSION, 0, 0, 0))
+                writer = _SectionWriter(f)
+                for name, array in self.sections.items():
+                    writer.write_array(name, array)
+                header = json.dumps(
+                    {**self.header, 'sections': writer.sections},
+                    default=_json_default
+                ).encode('utf-8')
+                header_offset = f.tell()
+                f.write(header)
+                f.seek(0)
+                f.write(_PREAMBLE.pack(
+                    SNAPSHOT_MAGIC, SNAPSHOT_VERSION, 0, header_offset,
+                    len(header)
+                ))
+            os.replace(tmp_path, file_path)
+        except BaseException:
+            os.unlink(tmp_path)
+            raise
+
+def collect_snapshot(
+        model, include_topology_arrays=True, include_parameters=True
+    ):
+    """Collect the snapshot contents of a model.
+
+    Parameters
+    ----------
+    model : Model
+        The crimm model to save. Disordered atoms and residues are not
+        supported, alternate locations need to be selected first.
+    include_topology_arrays : bool, default True
+        Store the topology of the model in PSF order as flat arrays. Skipped
+        if the model has no topology.
+    include_parameters : bool, default True
+        Store the parameters of the topology arrays, looked up with the
+        ParameterLoaders of the model's topology loader. Skipped if the
+        topology arrays are not stored or the model has no topology loader.
+
+    Returns
+    -------
+    SnapshotContents
+        The header and the array sections. The arrays of array-backed
+        solvent chains are referenced, not copied.
+    """
+    if model.level != 'M':
+        raise TypeError(
+            f'Snapshots store Model level entities, while {model.level} is '
+            'provided!'
+        )
+    tables = _HierarchyTables()
+    tables.add_model(model)
+    sections = tables.get_arrays()
+    parameter_arrays = None
+    if include_topology_arrays:
+        topology_arrays = _get_topology_arrays(model)
+        if topology_arrays is not None:
+            for name, array in topology_arrays.items():
+                sections[f'topology/{name}'] = array
+            if include_parameters:
+                parameter_arrays = _get_parameter_arrays(model, topology_arrays)
+    if parameter_arrays is not None:
+        for name, table in parameter_arrays.items():
+            for key, array in table.items():
+                sections[f'params/{name}/{key}'] = array
+    parameter_fields = {
+        name: list(fields) for name, _, _, fields in PARAMETER_SPECS
+    }
+    parameter_fields['nonbonded'] = list(NONBONDED_FIELDS)
+    parameter_fields['nonbonded14'] = list(NONBONDED_FIELDS)
+    header = {
+        'version': SNAPSHOT_VERSION,
+        # serialized now, the header does not change with the model
+        'metadata': json.loads(
+            json.dumps(_get_metadata(model), default=_json_default)
+        ),
+        'chains': tables.chains,
+        'parameter_fields': parameter_fields,
+    }
+    return SnapshotContents(header, sections)
+
+def write_snapshot(
+        model, file_path, include_topology_arrays=True,
+        include_parameters=True
+    ):
+    """Write a model to a binary snapshot file (see collect_snapshot for the
+    parameters)."""
+    collect_snapshot(
+        model, include_topology_arrays=include_topology_arrays,
+        include_parameters=include_parameters
+    ).write(file_path)
+
+class Snapshot:
+    """A memory-mapped crimm snapshot file.
+
+    Opening a snapshot only reads its header. The sections are read on
+    access, as views into the memory-mapped file, and the model is only
+    rebuilt from the hierarchy tables on `load_model`. The mapping is
+    copy-on-write: modifying the loaded arrays never changes the file.
+
+    The snapshot is closed with `close()` or by using it as a context
+    manager. Arrays still referencing the mapping (e.g. the coordinates of a
+    loaded BulkSolvent chain) stay valid, and the mapping is released with
+    the last of them.
+
+    Parameters
+    ----------
+    file_path : str
+        The path of the snapshot file
+    """
+    def __init__(self, file_path):
+        self.file_path = file_path
+        with open(file_path, 'rb') as f:
+            preamble = f.read(_PREAMBLE.size)
+            if len(preamble) < _PREAMBLE.size:
+                raise ValueError(f'{file_path} is not a crimm snapshot file!')
+            magic, version, _, header_offset, header_size = _PREAMBLE.unpack(
+                preamble
+            )
+            if magic != SNAPSHOT_MAGIC:
+                raise ValueError(f'{file_path} is not a crimm snapshot file!')
+            if version != SNAPSHOT_VERSION:
+                raise ValueError(
+                    f'Unsupported snapshot version {version} of {file_path}! '
+                    f'Expected version {SNAPSHOT_VERSION}.'
+                )
+            if header_offset == 0:
+                raise ValueError(f'Snapshot {file_path} is incomplete!')
+            f.seek(header_offset)
+            header = json.loads(f.read(header_size).decode('utf-8'))
+            self._mmap = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_COPY)
+        self.version = header['version']
+        self.metadata = header['metadata']
+        self.chains = header['chains']
+        self.parameter_fields = header['parameter_fields']
+        self.sections = header['sections']
+
+    def __repr__(self):
+        return (
+            f'<Snapshot {os.path.basename(self.file_path)} '
+            f'model={self.metadata["model_id"]} '
+            f'chains={len(self.chains)}>'
+        )
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    @property
+    def closed(self):
+        """If the snapshot is closed."""
+        return self._mmap is None
+
+    def close(self):
+        """Close the memory mapping. If arrays still reference it, it is
+        released when the last of them is deleted."""
+        if self._mmap is None:
+            return
+        try:
+            self._mmap.close()
+        except BufferError:
+            # exported views are alive, they keep the mapping open
+            pass
+        self._mmap = None
+
+    @property
+    def solvation_info(self):
+        """The solvation information of the model (box type and dimension,
+        ions, etc.), or None if the model is not solvated."""
+        return self.metadata['solvation_info']
+
+    def get_array(self, name):
+        """Return an array section (e.g. 'topology/bonds') as a view into the
+        memory-mapped file."""
+        if self._mmap is None:
+            raise ValueError(f'Snapshot {self.file_path} is closed!')
+        section = self.sections[name]
+        dtype = np.dtype(section['dtype'])
+        if section['nbytes'] == 0:
+            return np.empty(section['shape'], dtype=dtype)
+        start = section['offset']
+        buffer = memoryview(self._mmap)[start:start+section['nbytes']]
+        return np.frombuffer(buffer, dtype=dtype).reshape(section['shape'])
+
+    @property
+    def has_topology_arrays(self):
+        """If the snapshot stores the topology arrays of the model."""
+        return 'topology/atom_types' in self.sections
+
+    def get_topology_arrays(self):
+        """Return the dict of topology arrays in PSF order ('atom_types',
+        'charges', 'masses', 'bonds', 'angles', 'dihedrals', 'impropers' and
+        'cmap'), with 0-indexed atom indices."""
+        if not self.has_topology_arrays:
+            raise KeyError(
+                f'Snapshot {self.file_path} does not store topology arrays!'
+            )
+        return {
+            name: self.get_array(f'topology/{name}')
+            for name in TOPOLOGY_ARRAY_NAMES
+        }
+
+    @property
+    def has_parameters(self):
+        """If the snapshot stores the parameters of the topology arrays."""
+        return 'params/bonds/index' in self.sections
+
+    def get_parameter_arrays(self):
+        """Return the parameters of the topology arrays by name ('bonds',
+        'angles', 'urey_bradley', 'dihedrals', 'impropers' and 'cmap' per
+        element, 'nonbonded' and 'nonbonded14' per atom). Each entry is a
+        dict of:
+
+        'index': (N,) index of each element (or atom) into the table, -1 if
+            no parameter was found
+        'values': (n_rows, n_fields) value rows, with the fields listed in
+            parameter_fields. Dihedrals have one row per term, and CMAP one
+            row of the grid per row
+        'offsets': (n_entries+1,) the rows of table entry i are
+            values[offsets[i]:offsets[i+1]]
+        """
+        if not self.has_parameters:
+            raise KeyError(
+                f'Snapshot {self.file_path} does not store parameters!'
+            )
+        return {
+            name: {
+                key: self.get_array(f'params/{name}/{key}')
+                for key in ('index', 'values', 'offsets')
+            }
+            for name in self.parameter_fields
+        }
+
+    def _build_residues(self, start, stop):
+        """Create the residues of the residue table rows [start, stop)."""
+        res_arrays = {
+            key: self.get_array(f'residues/{key}')[start:stop].tolist()
+            for key in (
+                'hetflag', 'resseq', 'icode', 'resname', 'segid',
+                'author_seq_id', 'is_heterogen'
+            )
+        }
+        atom_offsets = self.get_array('residues/atom_offsets')[start:stop+1]
+        atom_start, atom_stop = int(atom_offsets[0]), int(atom_offsets[-1])
+        atom_arrays = {
+            key: self.get_array(f'atoms/{key}')[atom_start:atom_stop].tolist()
+            for key in (
+                'name', 'fullname', 'element', 'altloc', 'serial',
+                'occupancy', 'bfactor', 'has_coord'
+            )
+        }
+        # one copy, the atom coordinates are views of its rows
+        coords = np.array(self.get_array('atoms/coords')[atom_start:atom_stop])
+        residues = []
+        for i in range(stop - start):
+            res_id = (
+                res_arrays['hetflag'][i], res_arrays['resseq'][i],
+                res_arrays['icode'][i]
+            )
+            res_cls = Heterogen if res_arrays['is_heterogen'][i] else Residue
+            residue = res_cls(
+                res_id, res_arrays['resname'][i], res_arrays['segid'][i]
+            )
+            if (author_seq_id := res_arrays['author_seq_id'][i]) != _NO_VALUE:
+                residue.author_seq_id = author_seq_id
+            for j in range(
+                atom_offsets[i] - atom_start, atom_offsets[i+1] - atom_start
+            ):
+                residue.add(Atom(
+                    atom_arrays['name'][j],
+                    coords[j] if atom_arrays['has_coord'][j] else None,
+                    bfactor=atom_arrays['bfactor'][j],
+                    occupancy=atom_arrays['occupancy'][j],
+                    altloc=atom_arrays['altloc'][j],
+                    fullname=atom_arrays['fullname'][j],
+                    serial_number=atom_arrays['serial'][j],
+                    element=atom_arrays['element'][j] or None
+                ))
+            residues.append(residue)
+        return residues
+
+    def _build_chain(self, entry):
+        residues = self._build_residues(
+            entry['residue_start'], entry['residue_stop']
+        )
+        if entry['class'] == 'BulkSolvent':
+            bulk = entry['bulk']
+            chain = BulkSolvent(
+                entry['id'], residues[0],
+                self.get_array(f'bulk/{bulk}/coords'),
+                self.get_array(f'bulk/{bulk}/resseqs')
+            )
+            chain.serial_start = entry['serial_start']
+        elif entry['class'] == 'PolymerChain':
+            chain = PolymerChain(
+                entry['id'], entry['entity_id'], entry['author_chain_id'],
+                entry['chain_type'], entry['known_seq'], entry['can_seq'],
+                [tuple(res) for res in entry['reported_res']],
+                [tuple(res) for res in entry['reported_missing_res']]
+            )
+        else:
+            chain = _CHAIN_CLASSES[entry['class']](entry['id'])
+        if entry['class'] != 'BulkSolvent':
+            for residue in residues:
+                chain.add(residue)
+        chain.pdbx_description = entry['pdbx_description']
+        if 'source' in entry:
+            chain.source = entry['source']
+        if 'resnames' in entry:
+            chain.resnames = entry['resnames']
+        return chain
+
+    def _create_model(self):
+        metadata = self.metadata
+        if metadata['model_class'] == 'OrganizedModel':
+            # the chains are already organized, and no web data is fetched
+            model = OrganizedModel.__new__(OrganizedModel)
+            Model.__init__(model, metadata['model_id'])
+            model._ref_connect_atoms = {}
+            model.identify_ligands = False
+            model.rcsb_web_data = None
+            model.binding_info = None
+            model.bio_mol_info = None
+            model.lig_names = set()
+            model.bio_mol_names = set()
+            model.topology_loader = None
+        else:
+            model = Model(metadata['model_id'])
+        model.pdb_id = metadata['pdb_id']
+        model.pdbx_description = metadata['pdbx_description']
+        return model
+
+    def load_model(self, topology_loader=None):
+        """Rebuild the model from the hierarchy tables. The array-backed
+        solvent chains are views into the memory-mapped file.
+
+        The topology element objects and the residue definitions are not
+        stored (the topology and parameter arrays are, see
+        get_topology_arrays and get_parameter_arrays). If a
+        TopologyGenerator is provided as topology_loader, the definitions
+        are loaded again with the patches stored for each residue, and the
+        topology of the model is generated."""
+        model = self._create_model()
+        for entry in self.chains:
+            model.add(self._build_chain(entry))
+        if self.metadata['connect_dict']:
+            model.set_connect(self.metadata['connect_dict'])
+        if self.solvation_info is not None:
+            model._solvation_info = dict(self.solvation_info)
+        if topology_loader is not None:
+            self._attach_topology(model, topology_loader)
+        return model
+
+    def _get_chain_patches(self, entry):
+        """Return the patches of the first and last residue of a chain, and
+        the patches of the residues in between by residue position."""
+        patches = self.get_array('residues/patch')
+        start, stop = entry['residue_start'], entry['residue_stop']
+        if stop <= start:
+            return None, None, {}
+        first_patch, last_patch = str(patches[start]), str(patches[stop-1])
+        # the disulfide patches are applied again by ModelTopology from the
+        # connect records
+        mid_patches = {
+            i - start: str(patches[i]) for i in range(start+1, stop-1)
+            if patches[i] and str(patches[i]) != 'DISU'
+        }
+        return first_patch or None, last_patch or None, mid_patches
+
+    def _attach_topology(self, model, topology_loader):
+        """Load the residue definitions and generate the topology of the
+        rebuilt chains, in the order of TopologyGenerator.generate_model."""
+        # TopoLoader imports crimm.IO, so it is only imported here
+        from crimm.Modeller.TopoLoader import ModelTopology
+        entries = {entry['id']: entry for entry in self.chains}
+        ligand_residues = []
+        for chain in model:
+            entry = entries[chain.id]
+            if chain.chain_type in _POLYMER_TYPES:
+                first_patch, last_patch, mid_patches = (
+                    self._get_chain_patches(entry)
+                )
+                # the residues are in the stored order until generate sorts
+                # them
+                mid_patches = [
+                    (chain.child_list[i], patch)
+                    for i, patch in mid_patches.items()
+                ]
+                topology_loader.generate(
+                    chain, first_patch=first_patch, last_patch=last_patch,
+                    auto_correct_first_patch=False, QUIET=True
+                )
+                if mid_patches:
+                    self._apply_mid_patches(
+                        chain, mid_patches, topology_loader
+                    )
+            elif chain.chain_type == 'Ion':
+                topology_loader.generate(
+                    chain, auto_correct_first_patch=False, preserve_ic=False,
+                    QUIET=True
+                )
+        for chain in model:
+            if chain.chain_type == 'Solvent':
+                topology_loader.generate_solvent(
+                    chain, entries[chain.id].get('solvent_model') or 'TIP3',
+                    QUIET=True
+                )
+            elif chain.chain_type in (
+                'Ligand', 'CoSolvent', 'NucleosidePhosphate'
+            ):
+                ligand_residues.extend(chain)
+        if topology_loader.cgenff_loader is not None and ligand_residues:
+            topology_loader.cgenff_loader.generate_multiple(ligand_residues)
+        model.topology_loader = topology_loader
+        model.topology = ModelTopology(model)
+
+    @staticmethod
+    def _apply_mid_patches(chain, mid_patches, topology_loader):
+        """Patch the residues in the middle of the chain (e.g. ASPP, HSP or
+        LSN) and update the topology elements of the patched residues, as
+        TopologyGenerator.patch_termini does for the terminal residues."""
+        for residue, patch in mid_patches:
+            topology_loader.patch_residue(residue, patch, QUIET=True)
+        chain.topology.update_residues(
+            [residue for residue, _ in mid_patches], topology_loader.cur_param
+        )
+
+def load_snapshot(file_path, topology_loader=None):
+    """Load the model from a binary snapshot file (see Snapshot.load_model).
+    """
+    with Snapshot(file_path) as snapshot:
+        return snapshot.load_model(topology_loader=topology_loader)
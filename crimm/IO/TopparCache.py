@@ -0,0 +1,183 @@
+"""
+Module for caching parsed CHARMM topology (RTF) and parameter (PRM) files.
+
+Parsing the toppar text files takes several seconds for the large ones
+(e.g. cgenff.prm), and is repeated by every new process. The parsed data is
+therefore stored as a binary (pickle) file the first time a toppar file is
+read, and loaded from there afterwards.
+
+The cache is opt-in: it is used when the environment variable
+``CRIMM_TOPPAR_CACHE=1`` is set (the directory defaults to
+``~/.cache/crimm/toppar``), or when a cache directory is given with
+``CRIMM_TOPPAR_CACHE_DIR``. Setting ``CRIMM_TOPPAR_CACHE=0`` disables the
+cache in either case.
+
+Cache files are keyed by the SHA-256 digest of the toppar file content, by
+CACHE_VERSION and by the installed crimm version, so an edited toppar file,
+a change of the parsed data layout or an upgrade of crimm never picks up a
+stale cache. The versions are also stored in each cache file and checked on
+load.
+
+The cache files are pickles, and loading a pickle can execute arbitrary
+code. Only point the cache to a directory that is not writable by other
+users.
+
+The same directory holds the ligand parameters generated by CGenFF (in the
+``cgenff`` subdirectory), keyed by the content of the ligand (see
+RDKitConverter.get_mol_content_key), so that a ligand seen in many entries
+or processes is only parameterized once.
+"""
+
+import os
+import pickle
+import hashlib
+import tempfile
+import warnings
+from importlib import metadata
+from crimm.IO.RTFParser import RTFParser
+from crimm.IO.PRMParser import categorize_lines, parse_line_dict
+
+# Bump when the layout of the parsed RTF/PRM data changes
+CACHE_VERSION = 3
+
+def get_crimm_version():
+    """Return the installed crimm version, or 'dev' for a source tree that is
+    not installed."""
+    try:
+        return metadata.version('crimm')
+    except metadata.PackageNotFoundError:
+        return 'dev'
+
+def cache_enabled():
+    """Return if the toppar cache is enabled. The cache is off unless
+    CRIMM_TOPPAR_CACHE=1 or CRIMM_TOPPAR_CACHE_DIR is set."""
+    enabled = os.environ.get('CRIMM_TOPPAR_CACHE')
+    if enabled is not None:
+        return enabled != '0'
+    return os.environ.get('CRIMM_TOPPAR_CACHE_DIR') is not None
+
+def get_cache_dir():
+    """Return the directory of the toppar cache files."""
+    cache_dir = os.environ.get('CRIMM_TOPPAR_CACHE_DIR')
+    if cache_dir is None:
+        cache_dir = os.path.join(
+            os.path.expanduser('~'), '.cache', 'crimm', 'toppar'
+        )
+    return cache_dir
+
+def file_digest(file_path):
+    """Return the SHA-256 hex digest of the file content."""
+    sha = hashlib.sha256()
+    with open(file_path, 'rb') as f:
+        for block in iter(lambda: f.read(1 << 20), b''):
+            sha.update(block)
+    return sha.hexdigest()
+
+def get_cache_path(file_path, kind):
+    """Return the cache file path for a toppar file of the given kind
+    ('rtf' or 'prm')."""
+    basename = os.path.basename(file_path)
+    digest = file_digest(file_path)
+    return os.path.join(
+        get_cache_dir(),
+        f'{basename}.{kind}-{digest[:32]}-v{CACHE_VERSION}'
+        f'-crimm{get_crimm_version()}.pkl'
+    )
+
+def _get_cache_header():
+    return {
+        'cache_version': CACHE_VERSION,
+        'crimm_version': get_crimm_version(),
+    }
+
+def _read_cache(cache_path):
+    try:
+        with open(cache_path, 'rb') as f:
+            entry = pickle.load(f)
+    except FileNotFoundError:
+        return None
+    except Exception as e:
+        # corrupted or incompatible cache file, parse the text file again
+        warnings.warn(f'Failed to load toppar cache {cache_path}: {e}')
+        return None
+    if (
+        not isinstance(entry, dict) or
+        entry.get('header') != _get_cache_header() or
+        'data' not in entry
+    ):
+        warnings.warn(
+            f'Toppar cache {cache_path} was written by another version of '
+            'crimm and is ignored.'
+        )
+        return None
+    return entry['data']
+
+def _write_cache(cache_path, data):
+    """Write the cache file atomically, so that concurrent processes never
+    read a partially written file."""
+    cache_dir = os.path.dirname(cache_path)
+    try:
+        os.makedirs(cache_dir, exist_ok=True)
+        fd, tmp_path = tempfile.mkstemp(dir=cache_dir, suffix='.tmp')
+        try:
+            with os.fdopen(fd, 'wb') as f:
+                pickle.dump(
+                    {'header': _get_cache_header(), 'data': data},
+                    f, protocol=pickle.HIGHEST_PROTOCOL
+                )
+            os.replace(tmp_path, cache_path)
+        except BaseException:
+            os.unlink(tmp_path)
+            raise
+    except OSError as e:
+        # e.g. read-only home directory, the cache is only an optimization
+        warnings.warn(f'Failed to write toppar cache {cache_path}: {e}')
+
+def load_cached(file_path, kind, parse_func):
+    """Return the parsed data of a toppar file from the cache, or parse it
+    with parse_func(file_path) and store it in the cache."""
+    if not cache_enabled():
+        return parse_func(file_path)
+    cache_path = get_cache_path(file_path, kind)
+    data = _read_cache(cache_path)
+    if data is None:
+        data = parse_func(file_path)
+        _write_cache(cache_path, data)
+    return data
+
+def _parse_prm(file_path):
+    with open(file_path, 'r', encoding='utf-8') as f:
+        lines = [l.rstrip() for l in f.readlines()]
+    return lines, parse_line_dict(categorize_lines(lines))
+
+def load_rtf(file_path):
+    """Return the RTFParser of a topology file, loaded from the cache if
+    available."""
+    return load_cached(
+        file_path, 'rtf', lambda path: RTFParser(file_path=path)
+    )
+
+def load_prm(file_path):
+    """Return the raw lines and the parsed parameter dictionary of a parameter
+    file, loaded from the cache if available."""
+    return load_cached(file_path, 'prm', _parse_prm)
+
+def get_ligand_cache_path(key):
+    """Return the cache file path of the CGenFF output of a ligand key."""
+    return os.path.join(
+        get_cache_dir(), 'cgenff',
+        f'{key}-v{CACHE_VERSION}-crimm{get_crimm_version()}.pkl'
+    )
+
+def load_ligand_toppar(key):
+    """Return the cached CGenFF data of a ligand key, or None if it is not
+    in the cache."""
+    if not cache_enabled():
+        return None
+    return _read_cache(get_ligand_cache_path(key))
+
+def save_ligand_toppar(key, data):
+    """Store the CGenFF data of a ligand key in the cache. Concurrent
+    processes may write the same key, the last complete write wins."""
+    if cache_enabled():
+        _write_cache(get_ligand_cache_path(key), data)
@@ -7,7 +7,12 @@ from crimm.IO.CRDParser import CRDParser
 # Writers
 from crimm.IO.CRDWriter import write_crd, get_crd_str
 from crimm.IO.PSFWriter import PSFWriter, write_psf, get_psf_str
+from crimm.IO.Snapshot import (
+    Snapshot, SnapshotContents, collect_snapshot, write_snapshot, load_snapshot
+)
 
 # PSF Reader
-from crimm.IO.PSFReader import PSFReader, read_psf, PSFData, PSFAtom, compare_psf
+from crimm.IO.PSFReader import (
+    PSFReader, read_psf, PSFData, PSFArrays, PSFAtom, compare_psf, psf_to_structure
+)
 
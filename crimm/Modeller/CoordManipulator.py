@@ -3,8 +3,52 @@ from typing import List, Tuple
 from Bio.PDB.Atom import Atom
 import numpy as np
 from numpy.linalg import norm
+from scipy.spatial import ConvexHull
 from scipy.spatial.transform import Rotation as R
-from scipy.spatial.distance import pdist, squareform
+from scipy.spatial.distance import pdist, squareform, cdist
+from crimm.Utils.StructureUtils import get_coord_store
+
+# Number of points per tile when searching the farthest pair, a tile pair
+# allocates a (DIAMETER_TILE_SIZE, DIAMETER_TILE_SIZE) distance block
+DIAMETER_TILE_SIZE = 2048
+
+def find_farthest_pair(coords, tile_size=DIAMETER_TILE_SIZE) -> Tuple[int, int]:
+    """Return the indices (i, j), i < j, of the farthest pair of points (N, 3).
+
+    The farthest pair always lies on the convex hull, so only the hull vertices
+    are compared. They are compared tile by tile, which keeps the memory 
+    bounded by the tile size instead of growing with N^2. If no hull can be 
+    built (e.g. fewer than 4 or collinear points), all points are compared.
+    """
+    coords = np.asarray(coords, dtype=float)
+    if len(coords) < 2:
+        return 0, 0
+    candidates = None
+    # joggling the input ('QJ') lets qhull handle flat point sets
+    for qhull_options in (None, 'QJ'):
+        try:
+            candidates = ConvexHull(coords, qhull_options=qhull_options).vertices
+            break
+        except (RuntimeError, ValueError):
+            # QhullError (a RuntimeError) is raised for degenerate point sets
+            continue
+    if candidates is None:
+        candidates = np.arange(len(coords))
+    points = coords[candidates]
+    best_d2, best_pair = -1.0, (0, 0)
+    for start_i in range(0, len(points), tile_size):
+        tile_i = points[start_i:start_i+tile_size]
+        # only the upper triangle of tile pairs needs to be visited
+        for start_j in range(start_i, len(points), tile_size):
+            tile_j = points[start_j:start_j+tile_size]
+            d2 = cdist(tile_i, tile_j, 'sqeuclidean')
+            k = d2.argmax()
+            if d2.flat[k] > best_d2:
+                best_d2 = d2.flat[k]
+                i, j = np.unravel_index(k, d2.shape)
+                best_pair = (start_i+i, start_j+j)
+    i, j = sorted(int(candidates[k]) for k in best_pair)
+    return i, j
 
 class CoordManipulator:
     def __init__(self) -> None:
@@ -12,7 +56,7 @@ class CoordManipulator:
         self.include_alt = None
         self._atoms = None
         self.coords = None
-        self.dist_matrix = None
+        self._dist_matrix = None
         self.end_i, self.end_j = None, None
         self.op_mat = None
         self._convex_hull = None
@@ -26,12 +70,25 @@ class CoordManipulator:
         self._atoms, self.coords = self._extract_atoms_and_coords(
             self.entity, include_alt=self.include_alt
         )
-        self.dist_matrix = squareform(pdist(self.coords))
+        self._dist_matrix = None
         # pair of indices of the farthest atoms in the structure
         self.end_i, self.end_j = self._find_farthest_atom_indices()
         self.m_translation, self.m_rotation = None, None
 
+    @property
+    def dist_matrix(self) -> np.array:
+        """Full (N, N) distance matrix of the loaded coordinates. Not needed
+        for the orientation and only computed on first access, since it 
+        requires O(N^2) memory."""
+        if self._dist_matrix is None and self.coords is not None:
+            self._dist_matrix = squareform(pdist(self.coords))
+        return self._dist_matrix
+
     def _extract_atoms_and_coords(self, entity, include_alt) -> Tuple[List[Atom], np.array]:
+        if (store := get_coord_store(entity)) is not None:
+            # the atoms are not needed, coordinates are set through the store
+            chain_id = entity.id if entity.level == 'C' else None
+            return None, store.get_coords(include_alt, chain_id)
         coords = []
         atoms = []
         for atom in entity.get_atoms(include_alt=include_alt):
@@ -39,12 +96,17 @@ class CoordManipulator:
             atoms.append(atom)
         return atoms, np.asarray(coords)
 
+    def _set_coords(self, entity, atoms, coords) -> None:
+        """Write the coordinates back to the atoms extracted from the entity."""
+        if atoms is None:
+            chain_id = entity.id if entity.level == 'C' else None
+            get_coord_store(entity).set_coords(coords, self.include_alt, chain_id)
+            return
+        for i, atom in enumerate(atoms):
+            atom.coord = coords[i]
+
     def _find_farthest_atom_indices(self) -> Tuple[int, int]:
-        idx_pair = np.unravel_index(
-            np.argmax(self.dist_matrix, axis=None),
-            self.dist_matrix.shape
-        )
-        return idx_pair
+        return find_farthest_pair(self.coords)
 
     def get_transformation_matrix(self) -> Tuple[np.array, np.array]:
         """Return the 4x4 transformation matrix as numpy arrays."""
@@ -117,7 +179,7 @@ class CoordManipulator:
         """Return the dimensions of the bounding box of the coordinates (N, 3).
         The three sides of the box are parallel to the x, y, and z axes.
         """
-        return self.coords.ptp(0)
+        return np.ptp(self.coords, axis=0)
 
     def apply_coords(self, coords) -> np.array:
         """Apply the transformation to the coordinates (N, 3). Specifically, the 
@@ -136,13 +198,11 @@ class CoordManipulator:
             other_entity, self.include_alt
         )
         new_coords = self.apply_coords(coords)
-        for i, atom in enumerate(atoms):
-            atom.coord = new_coords[i]
+        self._set_coords(other_entity, atoms, new_coords)
 
     def _apply_to_loaded_entity(self) -> None:
         self.coords = self.apply_coords(self.coords)
-        for i, atom in enumerate(self._atoms):
-            atom.coord = self.coords[i]
+        self._set_coords(self.entity, self._atoms, self.coords)
 
     def orient_coords(self, apply_to_parent = False) -> None:
         """Apply translation and rotation operations to orient the structure 
@@ -185,7 +245,6 @@ class CoordManipulator:
         new_center = new_coords.mean(axis=0)
         new_coords -= new_center
         self.coords = new_coords
-        for i, atom in enumerate(self._atoms):
-            atom.coord = new_coords[i]
+        self._set_coords(self.entity, self._atoms, new_coords)
         if apply_to_parent and self.entity.parent is not None:
             self.apply_entity(self.entity.parent)
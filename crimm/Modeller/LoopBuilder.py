@@ -1,11 +1,18 @@
 import json
 import warnings
 import requests
+import numpy as np
 from Bio.Align import PairwiseAligner
 from crimm.Superimpose.ChainSuperimposer import ChainSuperimposer
-from crimm.Fetchers import fetch_rcsb, fetch_alphafold, uniprot_id_query
+from crimm.Fetchers import (
+    fetch_rcsb_multiple, fetch_alphafold, uniprot_id_query
+)
 from crimm.StructEntities.Chain import PolymerChain
 
+# Number of template chains superimposed at once when the templates are
+# screened by overall RMSD (see ChainLoopBuilder.iter_screened_templates)
+TEMPLATE_SCREEN_BATCH_SIZE = 8
+
 def find_gaps_within_range(gaps, segment):
     in_range = []
     for gap in gaps:
@@ -401,27 +408,74 @@ class ChainLoopBuilder:
     @staticmethod
     def get_templates(query_results: dict, local_entry_point: str):
         """
-        Return a generator of all template chains from the query result dict
+        Return a generator of all template chains from the query result dict.
+        The template entries are downloaded concurrently, and each one is
+        parsed as soon as it arrives.
         """
+        template_chain_ids = {}
         for entity_dict in query_results.values():
             for pdbid, chain_ids in entity_dict.items():
-                first_model = fetch_rcsb(
-                    pdbid, use_bio_assembly = False,
-                    include_solvent = False, 
-                    local_entry=local_entry_point,
-                    first_model_only=True
+                template_chain_ids.setdefault(pdbid, []).extend(chain_ids)
+        all_models = fetch_rcsb_multiple(
+            template_chain_ids, use_bio_assembly = False,
+            include_solvent = False, 
+            local_entry=local_entry_point,
+            first_model_only=True
+        )
+        for pdbid, first_model in all_models:
+            for chain_id in template_chain_ids[pdbid]:
+                template_chain = first_model[chain_id]
+                yield (pdbid, template_chain)
+
+    def screen_templates(self, templates, overall_rmsd_threshold, on_atoms = 'backbone'):
+        """Superimpose all (pdbid, template_chain) pairs onto the model chain at
+        once, and return the pairs with overall RMSD not higher than the 
+        threshold. Templates without a finite RMSD (e.g. no common atoms to
+        align) are rejected. The accepted templates are transformed onto the 
+        model chain.
+        """
+        screened, candidates = [], []
+        for pdbid, template in templates:
+            if template.can_seq is None:
+                # cannot be aligned, set_template_chain will raise on it
+                screened.append((pdbid, template))
+            else:
+                candidates.append((pdbid, template))
+        if not candidates:
+            return screened
+        rot, tran, rms = self.imposer.superimpose_multiple(
+            self.model_chain, [template for _, template in candidates],
+            on_atoms=on_atoms
+        )
+        for i, (pdbid, template) in enumerate(candidates):
+            if not np.isfinite(rms[i]) or rms[i] > overall_rmsd_threshold:
+                continue
+            for atom in template.get_atoms(include_alt=True):
+                atom.transform(rot[i], tran[i])
+            screened.append((pdbid, template))
+        return screened
+
+    def iter_screened_templates(
+            self, templates, overall_rmsd_threshold,
+            batch_size = TEMPLATE_SCREEN_BATCH_SIZE, on_atoms = 'backbone'
+        ):
+        """Screen a stream of (pdbid, template_chain) pairs by overall RMSD 
+        (see screen_templates), and yield the accepted pairs. The templates
+        are superimposed in batches of batch_size as they arrive, so the 
+        stream is not collected at once."""
+        batch = []
+        for template_pair in templates:
+            batch.append(template_pair)
+            if len(batch) >= batch_size:
+                yield from self.screen_templates(
+                    batch, overall_rmsd_threshold, on_atoms=on_atoms
                 )
-                for chain_id in chain_ids:
-                    template_chain = first_model[chain_id]
-                    yield (pdbid, template_chain)
+                batch = []
+        if batch:
+            yield from self.screen_templates(
+                batch, overall_rmsd_threshold, on_atoms=on_atoms
+            )
 
-    def _reject_by_rmsd(self, overall_rmsd_threshold):
-        if overall_rmsd_threshold is not None:
-            rms = self.superimpose_two_chains()
-            if rms > overall_rmsd_threshold:
-                return True
-        return False
-            
     def _update_candidates(self, cur_repairables, candidates, pdbid):
         for gap_key, info_dict in cur_repairables.items():
             if gap_key not in candidates or (
@@ -465,12 +519,16 @@ class ChainLoopBuilder:
             all_templates = self.get_templates(
                 self.query_results, local_entry_point
             )
+        if overall_rmsd_threshold is not None:
+            # reject bad templates in batches before any gap superposition,
+            # while the remaining templates are still downloading
+            all_templates = self.iter_screened_templates(
+                all_templates, overall_rmsd_threshold
+            )
 
         repair_candidates = {}
         for pdbid, template in all_templates:
             self.set_template_chain(template)
-            if self._reject_by_rmsd(overall_rmsd_threshold):
-                continue
             if cur_repairables := self.get_repair_residues_from_template(
                     rmsd_threshold = rmsd_threshold
                 ):
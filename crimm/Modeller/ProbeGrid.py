@@ -0,0 +1,755 @@
+"""Receptor potential grids and FFT correlation scoring of probe molecules
+for fragment mapping and docking preparation.
+
+A ReceptorGrid holds the electrostatic potential grid of a receptor and the
+van der Waals (vdW) potential grids of the probe atom types, computed from
+the CHARMM nonbonded parameters of a ParameterLoader:
+
+    elec(x) = COULOMB_CONSTANT * sum_i q_i / (eps * r)     (eps = dielectric)
+    elec(x) = COULOMB_CONSTANT * sum_i q_i / (eps * r**2)  (rdie, eps(r) = dielectric*r)
+    vdw_t(x) = sum_i eps_it * ((Rmin_it/r)**12 - 2*(Rmin_it/r)**6)
+
+with eps_it = sqrt(eps_i*eps_t) and Rmin_it = Rmin/2_i + Rmin/2_t. The pair
+terms are truncated at the cutoff and capped, so that the grids stay finite
+inside the receptor. NBFIX corrections are not applied.
+
+An FFTProbeScorer places a probe (e.g. a CustomFFTProbe or one of the probes
+of crimm.Data.probes) in a set of rotations, spreads the charges and the atom
+type occupancies of each rotation onto the grid, and scores all translations
+at once by FFT correlation with the receptor grids. The rotations are scored
+in batches sized to the available memory, and only the lowest energy over
+the rotations (and its rotation) is kept for each translation.
+
+The grids are computed and correlated on a CUDA device with CuPy if a device
+is found by crimm.Utils.cuda_info (backend='auto'), and with numpy and
+multithreaded scipy.fft otherwise:
+
+    >>> from crimm.Data.probes import create_new_probe_set
+    >>> grid = ReceptorGrid(model, param_loader, spacing=1.0)
+    >>> scorer = FFTProbeScorer(grid, n_rotations=500)
+    >>> for result in scorer.score_multiple(create_new_probe_set()):
+    ...     print(result.probe_name, result.pose_energies[:3])
+"""
+import os
+import math
+import warnings
+from itertools import product
+from concurrent.futures import ThreadPoolExecutor
+import numpy as np
+import scipy.fft
+from crimm.Utils.cuda_info import is_cuda_available, CUDAInfo
+from crimm.Utils.Instrumentation import instrumented, count
+
+# Coulomb's constant in kcal*A/(mol*e^2), as used by CHARMM
+COULOMB_CONSTANT = 332.0716
+DEFAULT_SPACING = 1.0
+# Margin (A) of the grid around the receptor atoms
+DEFAULT_PADDING = 8.0
+DEFAULT_CUTOFF = 12.0
+# Caps of the pair terms and the grid values of the electrostatic potential
+# (kcal/(mol*e)) and the vdW energy (kcal/mol)
+ELEC_CAP = 40.0
+VDW_CAP = 10.0
+# Pair distances are floored at this value (A) to avoid the singularity
+MIN_PAIR_DISTANCE = 0.1
+DEFAULT_N_ROTATIONS = 500
+DEFAULT_N_POSES = 100
+# Upper bound of the number of (atom, grid point) pairs evaluated per chunk
+# of the grid computation
+GRID_PAIR_CHUNK_SIZE = 1 << 21
+# Approximate bytes of temporary arrays per (atom, grid point) pair of a chunk
+# (grid indices, displacements, distances, masks, flat indices and the pair
+# terms of a channel)
+BYTES_PER_GRID_PAIR = 128
+# Upper bound of the default number of threads of the grid computation, each
+# one sums into its own copy of the grids
+GRID_MAX_WORKERS = 8
+# Approximate bytes of temporary arrays per grid point and rotation during
+# the scoring of a batch of rotations (spread grid, its transform, the
+# accumulated transform and the energies)
+BYTES_PER_GRID_POINT = 32
+# Memory budget of a batch of rotations on the CPU backend
+CPU_BATCH_MEMORY_MB = 1024
+# Fraction of the free device memory used by a batch of rotations
+GPU_MEMORY_FRACTION = 0.5
+# Chain types excluded from the receptor unless include_solvent is set
+SOLVENT_CHAIN_TYPES = ('Solvent', 'Ion', 'CoSolvent')
+BACKENDS = ('auto', 'cuda', 'cpu')
+_FFT_AXES = (-3, -2, -1)
+
+class _CPUBackend:
+    """numpy arrays and scipy.fft transforms with multiple threads."""
+    name = 'cpu'
+
+    def __init__(self, n_workers=None):
+        self.xp = np
+        self.n_workers = n_workers or os.cpu_count() or 1
+        # threads of the grid computation, capped unless n_workers is given
+        self.n_grid_workers = n_workers or min(self.n_workers, GRID_MAX_WORKERS)
+
+    def __repr__(self):
+        return f'<CPU Backend workers={self.n_workers}>'
+
+    def asarray(self, array, dtype=None):
+        return np.asarray(array, dtype=dtype)
+
+    def to_host(self, array):
+        return np.asarray(array)
+
+    def rfftn(self, array):
+        return scipy.fft.rfftn(array, axes=_FFT_AXES, workers=self.n_workers)
+
+    def irfftn(self, array, shape):
+        return scipy.fft.irfftn(
+            array, s=shape, axes=_FFT_AXES, workers=self.n_workers
+        )
+
+    def get_memory_budget(self):
+        return CPU_BATCH_MEMORY_MB * 2**20
+
+class _CUDABackend:
+    """CuPy arrays and cuFFT transforms on a single CUDA device."""
+    name = 'cuda'
+
+    def __init__(self, device_id=None):
+        import cupy
+        if device_id is None:
+            device_id = select_cuda_device()
+        self.xp = cupy
+        self.device_id = device_id
+        self.device = cupy.cuda.Device(device_id)
+        self.device.use()
+        # transforms and spreading run on the device in one thread
+        self.n_workers = 1
+        self.n_grid_workers = 1
+
+    def __repr__(self):
+        return f'<CUDA Backend device={self.device_id}>'
+
+    def asarray(self, array, dtype=None):
+        with self.device:
+            return self.xp.asarray(array, dtype=dtype)
+
+    def to_host(self, array):
+        return self.xp.asnumpy(array)
+
+    def rfftn(self, array):
+        return self.xp.fft.rfftn(array, axes=_FFT_AXES)
+
+    def irfftn(self, array, shape):
+        return self.xp.fft.irfftn(array, s=shape, axes=_FFT_AXES)
+
+    def get_memory_budget(self):
+        with self.device:
+            free_mem, _ = self.xp.cuda.runtime.memGetInfo()
+        return free_mem * GPU_MEMORY_FRACTION
+
+def select_cuda_device():
+    """Return the id of the CUDA device with the most free memory."""
+    with CUDAInfo() as cuda_info:
+        if len(cuda_info) == 0:
+            raise RuntimeError('No CUDA device found!')
+        device = max(cuda_info, key=lambda device: device.free_mem or 0)
+        return device.device_id
+
+def get_backend(backend='auto', device_id=None, n_workers=None):
+    """Return the array backend of the grid computation and the FFT scoring.
+
+    Parameters
+    ----------
+    backend : {'auto', 'cuda', 'cpu'}, default 'auto'
+        'auto' uses CUDA if a device is available and CuPy is installed, and
+        the CPU otherwise.
+    device_id : int, optional
+        The CUDA device to use. By default, the device with the most free
+        memory is used.
+    n_workers : int, optional
+        The number of threads of the CPU backend. Default is the number of
+        CPUs for the transforms, and at most GRID_MAX_WORKERS for the grid
+        computation.
+    """
+    if backend not in BACKENDS:
+        raise ValueError(
+            f'Unknown backend {backend}! Available backends are {BACKENDS}.'
+        )
+    if backend == 'cpu':
+        return _CPUBackend(n_workers)
+    if not is_cuda_available():
+        if backend == 'cuda':
+            raise RuntimeError('CUDA is not available on this system!')
+        return _CPUBackend(n_workers)
+    try:
+        return _CUDABackend(device_id)
+    except ImportError:
+        if backend == 'cuda':
+            raise RuntimeError(
+                'CuPy is required for the CUDA backend of the probe grids!'
+            ) from None
+        warnings.warn(
+            'CUDA is available but CuPy is not installed. The probe grids are '
+            'computed on the CPU.'
+        )
+    return _CPUBackend(n_workers)
+
+def get_rotations(n_rotations=DEFAULT_N_ROTATIONS, seed=None):
+    """Return n_rotations uniformly distributed rotation matrices as an
+    (n_rotations, 3, 3) array. The first rotation is the identity."""
+    rng = np.random.default_rng(seed)
+    # uniform random unit quaternions (Shoemake, Graphics Gems III)
+    u1, u2, u3 = rng.random((3, n_rotations))
+    w = np.sqrt(1 - u1) * np.sin(2 * np.pi * u2)
+    x = np.sqrt(1 - u1) * np.cos(2 * np.pi * u2)
+    y = np.sqrt(u1) * np.sin(2 * np.pi * u3)
+    z = np.sqrt(u1) * np.cos(2 * np.pi * u3)
+    w[0], x[0], y[0], z[0] = 1.0, 0.0, 0.0, 0.0
+    return np.stack([
+        np.stack([1-2*(y*y+z*z), 2*(x*y-z*w), 2*(x*z+y*w)], axis=-1),
+        np.stack([2*(x*y+z*w), 1-2*(x*x+z*z), 2*(y*z-x*w)], axis=-1),
+        np.stack([2*(x*z-y*w), 2*(y*z+x*w), 1-2*(x*x+y*y)], axis=-1),
+    ], axis=1)
+
+def _get_receptor_atoms(entity, include_solvent):
+    if entity.level == 'S':
+        entity = entity.child_list[0]
+    if entity.level == 'M':
+        chains = list(entity)
+    elif entity.level == 'C':
+        chains = [entity]
+    elif entity.level == 'R':
+        return list(entity.get_atoms())
+    else:
+        raise TypeError(
+            'Receptor grids take Structure, Model, Chain or Residue level '
+            f'entities, while {entity.level} is provided!'
+        )
+    atoms = []
+    for chain in chains:
+        if not include_solvent and (
+            chain.chain_type in SOLVENT_CHAIN_TYPES
+            or getattr(chain, 'is_array_backed', False)
+        ):
+            continue
+        atoms.extend(chain.get_atoms())
+    return atoms
+
+def _get_atom_params(atoms, param_loader):
+    """Return the atom types, charges and the nonbonded parameters of the
+    atoms. The epsilons are returned as positive well depths."""
+    atom_types, charges = [], []
+    for atom in atoms:
+        topo_def = atom.topo_definition
+        if topo_def is None:
+            raise ValueError(
+                f'Atom {atom.get_full_id()} has no topology definition! '
+                'Generate the topology of the receptor first.'
+            )
+        atom_types.append(topo_def.atom_type)
+        charges.append(topo_def.charge)
+    nb_params = {}
+    missing = set()
+    for atom_type in set(atom_types):
+        try:
+            nb_params[atom_type] = param_loader.get_nonbonded(atom_type)
+        except KeyError:
+            missing.add(atom_type)
+    if missing:
+        raise ValueError(
+            'No nonbonded parameters for atom types: '
+            f'{", ".join(sorted(missing))}'
+        )
+    eps = np.array([abs(nb_params[t].epsilon) for t in atom_types])
+    rmin_half = np.array([nb_params[t].rmin_half for t in atom_types])
+    return atom_types, np.array(charges, dtype=np.float64), eps, rmin_half
+
+def _get_flat_index(xp, idx, shape):
+    return (idx[..., 0] * shape[1] + idx[..., 1]) * shape[2] + idx[..., 2]
+
+class ReceptorGrid:
+    """Electrostatic and vdW potential grids of a receptor.
+
+    The electrostatic grid is computed on creation. The vdW grids are
+    computed on demand for the requested probe atom types, with all missing
+    types evaluated in one pass over the receptor.
+
+    Parameters
+    ----------
+    entity : Structure, Model, Chain or Residue
+        The receptor with its topology generated (atom types and charges)
+    param_loader : ParameterLoader
+        The nonbonded parameters of the receptor and the probe atom types,
+        e.g. a ParameterLoader with the 'protein' and 'cgenff' parameters
+        loaded
+    spacing : float, default 1.0
+        The grid spacing in A
+    padding : float, default 8.0
+        The margin of the grid around the receptor atoms in A. Ignored if
+        box_size is provided.
+    center : array-like of shape (3,), optional
+        The center of the grid, e.g. of a binding pocket. Default is the
+        center of the receptor atoms.
+    box_size : float or array-like of shape (3,), optional
+        The side lengths of the grid box in A. Receptor atoms outside the box
+        still contribute within the cutoff.
+    cutoff : float, default 12.0
+        The cutoff of the pair terms in A
+    dielectric : float, default 1.0
+        The dielectric constant
+    rdie : bool, default True
+        Use the distance dependent dielectric eps(r) = dielectric*r
+    elec_cap, vdw_cap : float
+        The caps of the electrostatic potential and the vdW energy
+    include_solvent : bool, default False
+        Include the solvent and ion chains in the receptor
+    backend : {'auto', 'cuda', 'cpu'}, default 'auto'
+        See get_backend
+    device_id, n_workers : int, optional
+        See get_backend
+
+    Attributes
+    ----------
+    origin : numpy.ndarray
+        The coordinates of the grid point (0, 0, 0)
+    shape : tuple of int
+        The number of grid points along x, y and z, rounded up to sizes with
+        fast transforms
+    """
+    def __init__(
+            self, entity, param_loader, spacing=DEFAULT_SPACING,
+            padding=DEFAULT_PADDING, center=None, box_size=None,
+            cutoff=DEFAULT_CUTOFF, dielectric=1.0, rdie=True,
+            elec_cap=ELEC_CAP, vdw_cap=VDW_CAP, include_solvent=False,
+            backend='auto', device_id=None, n_workers=None
+        ):
+        if spacing <= 0:
+            raise ValueError(f'Grid spacing has to be positive, got {spacing}')
+        self.param_loader = param_loader
+        self.spacing = float(spacing)
+        self.cutoff = float(cutoff)
+        self.dielectric = float(dielectric)
+        self.rdie = rdie
+        self.elec_cap = float(elec_cap)
+        self.vdw_cap = float(vdw_cap)
+        self.backend = get_backend(backend, device_id, n_workers)
+        atoms = _get_receptor_atoms(entity, include_solvent)
+        if len(atoms) == 0:
+            raise ValueError('No receptor atoms to compute the grids!')
+        (
+            self.atom_types, self._charges, self._eps, self._rmin_half
+        ) = _get_atom_params(atoms, param_loader)
+        self._coords = np.array([atom.coord for atom in atoms], dtype=np.float64)
+        self.origin, self.shape = self._get_grid_geometry(
+            center, box_size, padding
+        )
+        # grids and their transforms on the backend device, by channel key
+        # ('elec' or the atom type of the vdW grid)
+        self._grids = {}
+        self._grid_ffts = {}
+        self._compute_grids(elec=True, vdw_types=())
+
+    def __repr__(self):
+        return (
+            f'<ReceptorGrid shape={self.shape} spacing={self.spacing} '
+            f'atoms={len(self.atom_types)} vdw_types={len(self.vdw_types)} '
+            f'backend={self.backend.name}>'
+        )
+
+    @property
+    def n_points(self):
+        """The total number of grid points."""
+        return math.prod(self.shape)
+
+    @property
+    def vdw_types(self):
+        """The atom types of the computed vdW grids."""
+        return [key for key in self._grids if key != 'elec']
+
+    def _get_grid_geometry(self, center, box_size, padding):
+        if center is None:
+            center = (self._coords.min(0) + self._coords.max(0)) / 2
+        center = np.asarray(center, dtype=np.float64).reshape(3)
+        if box_size is None:
+            extent = np.ptp(self._coords, axis=0) + 2 * padding
+        else:
+            extent = np.broadcast_to(
+                np.asarray(box_size, dtype=np.float64), (3,)
+            )
+        shape = tuple(
+            scipy.fft.next_fast_len(int(math.ceil(d / self.spacing)) + 1, real=True)
+            for d in extent
+        )
+        origin = center - (np.array(shape) - 1) * self.spacing / 2
+        return origin, shape
+
+    def get_grid_coords(self, index):
+        """Return the coordinates of the grid points of an (..., 3) array of
+        grid indices."""
+        return self.origin + np.asarray(index) * self.spacing
+
+    def get_grid(self, key='elec'):
+        """Return the grid of a channel ('elec' or a vdW atom type) as a
+        numpy array of the grid shape."""
+        if key not in self._grids:
+            self.compute_vdw_grids([key])
+        return self.backend.to_host(self._grids[key])
+
+    def get_grid_fft(self, key):
+        """Return the real FFT of the grid of a channel on the backend
+        device (memoized)."""
+        if key not in self._grid_ffts:
+            if key not in self._grids:
+                self.compute_vdw_grids([key])
+            self._grid_ffts[key] = self.backend.rfftn(self._grids[key])
+        return self._grid_ffts[key]
+
+    def compute_vdw_grids(self, atom_types):
+        """Compute the vdW grids of the atom types that are not computed
+        yet."""
+        missing = [t for t in dict.fromkeys(atom_types) if t not in self._grids]
+        if missing:
+            self._compute_grids(elec=False, vdw_types=missing)
+
+    def _get_stencil(self):
+        """Return the grid offsets within the cutoff of a grid point, with
+        a margin of half a cell diagonal for atoms between the points."""
+        k = int(math.ceil(self.cutoff / self.spacing)) + 1
+        axis = np.arange(-k, k + 1)
+        offsets = np.stack(
+            np.meshgrid(axis, axis, axis, indexing='ij'), axis=-1
+        ).reshape(-1, 3)
+        max_dist = self.cutoff / self.spacing + math.sqrt(3) / 2
+        return offsets[(offsets**2).sum(1) <= max_dist**2]
+
+    def _get_contributing_atoms(self):
+        """Return the indices of the atoms within the cutoff of the box."""
+        lower = self.origin - self.cutoff
+        upper = self.origin + (np.array(self.shape) - 1) * self.spacing + self.cutoff
+        in_range = np.all((self._coords >= lower) & (self._coords <= upper), axis=1)
+        return np.flatnonzero(in_range)
+
+    @instrumented('receptor_grid')
+    def _compute_grids(self, elec, vdw_types):
+        backend = self.backend
+        xp = backend.xp
+        vdw_params = []
+        for atom_type in vdw_types:
+            try:
+                nb_param = self.param_loader.get_nonbonded(atom_type)
+            except KeyError:
+                raise ValueError(
+                    f'No nonbonded parameters for atom type {atom_type}'
+                ) from None
+            vdw_params.append((abs(nb_param.epsilon), nb_param.rmin_half))
+        atom_ids = self._get_contributing_atoms()
+        offsets = backend.asarray(self._get_stencil())
+        chunk_size = max(1, GRID_PAIR_CHUNK_SIZE // len(offsets))
+        chunks = [
+            atom_ids[start:start+chunk_size]
+            for start in range(0, len(atom_ids), chunk_size)
+        ]
+        n_channels = int(elec) + len(vdw_params)
+        # each thread sums into its own grids and holds the temporaries of
+        # one chunk (and the bincount of a channel), bounded by the memory
+        # budget
+        worker_bytes = (
+            (max(1, n_channels) + 1) * self.n_points * 8
+            + chunk_size * len(offsets) * BYTES_PER_GRID_PAIR
+        )
+        n_workers = min(
+            backend.n_grid_workers, len(chunks),
+            max(1, int(backend.get_memory_budget() // worker_bytes))
+        )
+
+        def accumulate(worker_chunks):
+            grids = xp.zeros((n_channels, self.n_points), dtype=xp.float64)
+            n_pairs = 0
+            for chunk in worker_chunks:
+                n_pairs += self._accumulate_chunk(
+                    grids, chunk, offsets, elec, vdw_params
+                )
+            return grids, n_pairs
+
+        if n_workers > 1:
+            with ThreadPoolExecutor(n_workers) as executor:
+                results = list(executor.map(
+                    accumulate, [chunks[i::n_workers] for i in range(n_workers)]
+                ))
+            grids = sum((g for g, _ in results[1:]), results[0][0])
+            n_pairs = sum(n for _, n in results)
+        else:
+            grids, n_pairs = accumulate(chunks)
+        # the counters are recorded in the calling thread
+        count('grid_pairs', n_pairs)
+
+        keys = (['elec'] if elec else []) + list(vdw_types)
+        for i, key in enumerate(keys):
+            grid = grids[i].reshape(self.shape)
+            if key == 'elec':
+                grid = xp.clip(grid, -self.elec_cap, self.elec_cap)
+            else:
+                grid = xp.minimum(grid, self.vdw_cap)
+            self._grids[key] = grid.astype(xp.float32)
+            self._grid_ffts.pop(key, None)
+
+    def _accumulate_chunk(self, grids, chunk, offsets, elec, vdw_params):
+        """Add the pair terms of a chunk of receptor atoms to the flat grids
+        of the channels. Return the number of pairs within the cutoff."""
+        backend = self.backend
+        xp = backend.xp
+        shape = backend.asarray(self.shape)
+        origin = backend.asarray(self.origin)
+        coords = backend.asarray(self._coords[chunk])
+        base = xp.rint((coords - origin) / self.spacing).astype(xp.int64)
+        idx = base[:, None, :] + offsets[None, :, :]
+        in_grid = xp.all((idx >= 0) & (idx < shape), axis=2)
+        delta = origin + idx * self.spacing - coords[:, None, :]
+        r = xp.sqrt((delta**2).sum(2))
+        pair_mask = in_grid & (r <= self.cutoff)
+        pair_atoms, _ = xp.nonzero(pair_mask)
+        flat_idx = _get_flat_index(xp, idx[pair_mask], self.shape)
+        r = xp.maximum(r[pair_mask], MIN_PAIR_DISTANCE)
+        n_pairs = int(r.shape[0])
+        channel = 0
+        if elec:
+            charges = backend.asarray(self._charges[chunk])[pair_atoms]
+            denom = self.dielectric * (r * r if self.rdie else r)
+            potential = xp.clip(
+                COULOMB_CONSTANT * charges / denom, -self.elec_cap, self.elec_cap
+            )
+            grids[channel] += xp.bincount(
+                flat_idx, weights=potential, minlength=self.n_points
+            )
+            channel += 1
+        if not vdw_params:
+            return n_pairs
+        eps = backend.asarray(self._eps[chunk])[pair_atoms]
+        rmin_half = backend.asarray(self._rmin_half[chunk])[pair_atoms]
+        for type_eps, type_rmin_half in vdw_params:
+            ratio6 = ((rmin_half + type_rmin_half) / r)**6
+            energy = xp.sqrt(eps * type_eps) * (ratio6 * ratio6 - 2 * ratio6)
+            grids[channel] += xp.bincount(
+                flat_idx, weights=xp.minimum(energy, self.vdw_cap),
+                minlength=self.n_points
+            )
+            channel += 1
+        return n_pairs
+
+class ProbeResult:
+    """The FFT scores of a probe over the translations of a receptor grid.
+
+    Attributes
+    ----------
+    probe : CustomFFTProbe
+        The scored probe
+    energy_grid : numpy.ndarray
+        The lowest energy (kcal/mol) over the rotations of the probe centered
+        at each grid point. Translations where the probe would wrap around
+        the grid boundary are inf.
+    rotation_grid : numpy.ndarray
+        The index of the rotation of the lowest energy at each grid point
+        (-1 for the excluded translations)
+    pose_energies, pose_rotations : numpy.ndarray
+        The energies and rotation indices of the lowest energy poses
+    pose_translations : numpy.ndarray
+        The coordinates of the probe center of the poses
+    """
+    def __init__(
+            self, probe, rotations, probe_coords, grid_origin, grid_spacing,
+            energy_grid, rotation_grid, n_poses
+        ):
+        self.probe = probe
+        self.rotations = rotations
+        self.energy_grid = energy_grid
+        self.rotation_grid = rotation_grid
+        self._center = probe_coords.mean(0)
+        self._offsets = probe_coords - self._center
+        flat_energy = energy_grid.reshape(-1)
+        n_valid = int(np.isfinite(flat_energy).sum())
+        n_poses = min(n_poses, n_valid)
+        if n_poses > 0:
+            pose_ids = np.argpartition(flat_energy, n_poses - 1)[:n_poses]
+            pose_ids = pose_ids[np.argsort(flat_energy[pose_ids])]
+        else:
+            pose_ids = np.empty(0, dtype=np.int64)
+        pose_index = np.stack(np.unravel_index(pose_ids, energy_grid.shape), -1)
+        self.pose_energies = flat_energy[pose_ids]
+        self.pose_rotations = rotation_grid.reshape(-1)[pose_ids]
+        self.pose_translations = grid_origin + pose_index * grid_spacing
+
+    def __repr__(self):
+        best = self.pose_energies[0] if len(self.pose_energies) else None
+        return (
+            f'<ProbeResult probe={self.probe_name} '
+            f'poses={len(self.pose_energies)} best_energy={best}>'
+        )
+
+    @property
+    def probe_name(self):
+        return getattr(self.probe, 'resname', None)
+
+    def get_pose_coords(self, pose_id):
+        """Return the atom coordinates of the probe in a pose."""
+        rotation = self.rotations[self.pose_rotations[pose_id]]
+        return self._offsets @ rotation.T + self.pose_translations[pose_id]
+
+class FFTProbeScorer:
+    """Score the rotations and translations of probes on a receptor grid by
+    FFT correlation.
+
+    Parameters
+    ----------
+    receptor_grid : ReceptorGrid
+        The receptor grids, on whose backend the scoring runs
+    rotations : array-like of shape (N, 3, 3), optional
+        The rotation matrices of the probes. Default is n_rotations random
+        rotations (see get_rotations).
+    n_rotations : int, default 500
+        The number of random rotations if rotations is not provided
+    seed : int, optional
+        The seed of the random rotations
+    n_poses : int, default 100
+        The number of lowest energy poses recorded per probe
+    batch_size : int, optional
+        The number of rotations correlated at once. By default, it is sized
+        to the memory budget of the backend.
+    """
+    def __init__(
+            self, receptor_grid, rotations=None,
+            n_rotations=DEFAULT_N_ROTATIONS, seed=None,
+            n_poses=DEFAULT_N_POSES, batch_size=None
+        ):
+        self.grid = receptor_grid
+        if rotations is None:
+            rotations = get_rotations(n_rotations, seed)
+        rotations = np.asarray(rotations, dtype=np.float64)
+        if rotations.ndim != 3 or rotations.shape[1:] != (3, 3):
+            raise ValueError('Rotations have to be an (N, 3, 3) array!')
+        self.rotations = rotations
+        self.n_poses = n_poses
+        self.batch_size = batch_size
+
+    def __repr__(self):
+        return (
+            f'<FFTProbeScorer rotations={len(self.rotations)} '
+            f'grid={self.grid.shape} backend={self.grid.backend.name}>'
+        )
+
+    def _get_batch_size(self):
+        if self.batch_size is not None:
+            return self.batch_size
+        budget = self.grid.backend.get_memory_budget()
+        batch_size = int(budget // (BYTES_PER_GRID_POINT * self.grid.n_points))
+        return max(1, min(batch_size, len(self.rotations)))
+
+    def _spread(self, positions, weights):
+        """Spread the weights of the atoms at the (B, M, 3) positions (in
+        grid units) onto B grids by trilinear interpolation. Positions beyond
+        the grid wrap around."""
+        xp = self.grid.backend.xp
+        grid_shape = self.grid.shape
+        n_points = self.grid.n_points
+        n_batch = positions.shape[0]
+        shape = self.grid.backend.asarray(grid_shape)
+        base = xp.floor(positions)
+        frac = positions - base
+        base = base.astype(xp.int64)
+        batch_offset = (xp.arange(n_batch, dtype=xp.int64) * n_points)[:, None]
+        corner_ids, corner_weights = [], []
+        for corner in product((0, 1), repeat=3):
+            corner = self.grid.backend.asarray(corner)
+            corner_ids.append(
+                _get_flat_index(xp, (base + corner) % shape, grid_shape)
+                + batch_offset
+            )
+            corner_weights.append(
+                xp.prod(xp.where(corner == 1, frac, 1 - frac), axis=2) * weights
+            )
+        spread = xp.bincount(
+            xp.concatenate(corner_ids).reshape(-1),
+            weights=xp.concatenate(corner_weights).reshape(-1),
+            minlength=n_batch * n_points
+        )
+        return spread.reshape(n_batch, *grid_shape).astype(xp.float32)
+
+    def _get_channels(self, atom_types, charges):
+        """Return the (grid key, atom weights) of the channels of a probe."""
+        channels = [('elec', charges)]
+        for atom_type in dict.fromkeys(atom_types):
+            channels.append(
+                (atom_type, (np.array(atom_types) == atom_type).astype(np.float64))
+            )
+        return channels
+
+    def _get_valid_mask(self, probe_offsets):
+        """Return the mask of the translations where the probe does not wrap
+        around the grid boundary."""
+        radius = np.linalg.norm(probe_offsets, axis=1).max() / self.grid.spacing
+        margin = int(math.ceil(radius)) + 1
+        mask = np.zeros(self.grid.shape, dtype=bool)
+        if all(2 * margin < n for n in self.grid.shape):
+            mask[margin:-margin, margin:-margin, margin:-margin] = True
+        return mask
+
+    @instrumented('probe_fft_scoring')
+    def score(self, probe):
+        """Score all rotations of a probe at all grid translations. Return a
+        ProbeResult."""
+        backend = self.grid.backend
+        xp = backend.xp
+        atoms = list(probe.get_atoms())
+        probe_coords = np.array([atom.coord for atom in atoms], dtype=np.float64)
+        atom_types = [atom.topo_definition.atom_type for atom in atoms]
+        charges = np.array(
+            [atom.topo_definition.charge for atom in atoms], dtype=np.float64
+        )
+        offsets = probe_coords - probe_coords.mean(0)
+        self.grid.compute_vdw_grids(atom_types)
+        channels = [
+            (self.grid.get_grid_fft(key), backend.asarray(weights))
+            for key, weights in self._get_channels(atom_types, charges)
+        ]
+        device_offsets = backend.asarray(offsets / self.grid.spacing)
+        best_energy = xp.full(self.grid.shape, np.inf, dtype=xp.float32)
+        best_rotation = xp.full(self.grid.shape, -1, dtype=xp.int32)
+        batch_size = self._get_batch_size()
+        for start in range(0, len(self.rotations), batch_size):
+            rotations = backend.asarray(self.rotations[start:start+batch_size])
+            # (B, M, 3) atom positions of the rotated probes
+            positions = xp.einsum('mj,bij->bmi', device_offsets, rotations)
+            correlation = None
+            for grid_fft, weights in channels:
+                probe_fft = backend.rfftn(self._spread(positions, weights))
+                term = grid_fft * xp.conj(probe_fft)
+                correlation = term if correlation is None else correlation + term
+            energies = backend.irfftn(correlation, self.grid.shape)
+            batch_energy = energies.min(0)
+            is_lower = batch_energy < best_energy
+            best_energy = xp.where(is_lower, batch_energy, best_energy)
+            best_rotation = xp.where(
+                is_lower, energies.argmin(0).astype(xp.int32) + start,
+                best_rotation
+            )
+            count('rotations', len(rotations))
+        energy_grid = backend.to_host(best_energy)
+        rotation_grid = backend.to_host(best_rotation)
+        valid = self._get_valid_mask(offsets)
+        energy_grid[~valid] = np.inf
+        rotation_grid[~valid] = -1
+        return ProbeResult(
+            probe, self.rotations, probe_coords, self.grid.origin,
+            self.grid.spacing, energy_grid, rotation_grid, self.n_poses
+        )
+
+    def score_multiple(self, probes):
+        """Score a list (or a dict, e.g. from create_new_probe_set) of probes.
+        The vdW grids of all probe atom types are computed in one pass, and
+        the results are yielded as each probe finishes, so only one probe's
+        scores are held at a time."""
+        if isinstance(probes, dict):
+            probes = probes.values()
+        probes = list(probes)
+        self.grid.compute_vdw_grids([
+            atom.topo_definition.atom_type
+            for probe in probes for atom in probe.get_atoms()
+        ])
+        for probe in probes:
+            yield self.score(probe)
@@ -14,12 +14,15 @@ from crimm.Modeller.CoordManipulator import CoordManipulator
 from crimm.StructEntities.Atom import Atom
 from crimm.StructEntities.Residue import Residue
 from crimm.StructEntities.Model import Model
-from crimm.StructEntities.Chain import Solvent, Ion
+from crimm.StructEntities.Chain import Solvent, BulkSolvent, Ion
 from crimm.Modeller.TopoLoader import ResidueTopologySet
 from crimm.Data.components_dict import CHARMM_PDB_ION_NAMES
+from crimm.Utils.Instrumentation import instrumented, count
 
 WATER_COORD_PATH = os.path.join(os.path.dirname(Data.__file__), 'water_coords.npy')
 BOXWIDTH=18.662 # water unit cube width
+# Number of water atoms tested against the solute per tile in the clash filter
+CLASH_TILE_SIZE = 1 << 18
 
 # Physical constants for ion calculations
 WATER_MOLARITY = 55.5  # Molar concentration of pure water at 298K (often approximated as 56)
@@ -88,6 +91,41 @@ H2 = Atom(
     element = 'H'
 )
 
+class _IonExclusionGrid:
+    """Uniform grid (spatial hash) of placed ion coordinates with a cell 
+    width of the minimum ion-ion distance, so that a distance check only 
+    needs to visit the 27 cells around the query point. A non-positive 
+    minimum distance disables the exclusion."""
+    def __init__(self, min_dist):
+        self.min_dist = min_dist
+        self.cells = {}
+
+    def _cell(self, coord):
+        return tuple(np.floor(coord / self.min_dist).astype(int).tolist())
+
+    def add(self, coord):
+        """Add a placed ion coordinate to the grid"""
+        if self.min_dist <= 0:
+            # no exclusion, nothing to look up
+            return
+        self.cells.setdefault(self._cell(coord), []).append(coord)
+
+    def has_neighbor(self, coord):
+        """Return True if any placed ion is closer than min_dist to coord"""
+        if self.min_dist <= 0 or not self.cells:
+            return False
+        cx, cy, cz = self._cell(coord)
+        for dx in (-1, 0, 1):
+            for dy in (-1, 0, 1):
+                for dz in (-1, 0, 1):
+                    cell_coords = self.cells.get((cx+dx, cy+dy, cz+dz))
+                    if cell_coords is None:
+                        continue
+                    dists = np.linalg.norm(np.array(cell_coords) - coord, axis=1)
+                    if dists.min() < self.min_dist:
+                        return True
+        return False
+
 ## TODO: deal with atom serial number > 99999 for larger structures (e.g. 1A8I)
 class Solvator:
     """Solvates a Structure, Model, or Chain level entity with water molecules.
@@ -350,6 +388,9 @@ class Solvator:
         for chain in model.chains:
             if chain.chain_type != 'Solvent':
                 continue
+            if getattr(chain, 'is_array_backed', False):
+                # generated waters are already complete TIP3 molecules
+                continue
             for residue in chain.get_residues():
                 if residue.resname in ('HOH', 'WAT', 'SOL', 'TIP3'):
                     atoms = list(residue.get_atoms())
@@ -412,7 +453,7 @@ class Solvator:
         n_preserved = 0
         for chain in model.chains:
             if chain.chain_type == 'Solvent':
-                n_preserved = len(list(chain.get_residues()))
+                n_preserved = len(chain)
                 break
 
         if n_converted > 0:
@@ -484,6 +525,62 @@ class Solvator:
 
         return n_preserved
 
+    def _create_water_plane(
+            self, n_units, inner_axis=0, outer_axis=1
+        ) -> np.ndarray:
+        """Replicate the pre-equilibrated water unit cube along the inner axis 
+        and then along the outer axis to create a plane of (n_units x n_units)
+        unit cubes. Returns the atom coordinates of the plane in shape 
+        (N_atoms, 3), ordered by outer unit, inner unit and atom."""
+        water_coords_expanded = self.water_unit_coords.reshape(-1, 3)
+        n_atoms = water_coords_expanded.shape[0]
+        water_plane = np.empty((n_units, n_units, n_atoms, 3))
+        water_plane[:] = water_coords_expanded
+        shifts = np.arange(n_units) * BOXWIDTH
+        water_plane[..., outer_axis] += shifts[:, None, None]
+        water_plane[..., inner_axis] += shifts[None, :, None]
+        return water_plane.reshape(-1, 3)
+
+    def _iter_water_slabs(self, n_units, stack_axis, inner_axis, outer_axis):
+        """Yield the (n_units x n_units x n_units) grid of water unit cubes one
+        slab of unit cubes at a time, stacked along stack_axis. The grid is 
+        centered at the origin by the translation of its bounding box, which
+        is computed from the extents of a single plane."""
+        water_plane = self._create_water_plane(n_units, inner_axis, outer_axis)
+        grid_min = water_plane.min(0)
+        grid_max = water_plane.max(0)
+        grid_max[stack_axis] += (n_units - 1) * BOXWIDTH
+        translation_vec = -(grid_max - grid_min) / 2 - grid_min
+        for k in range(n_units):
+            water_slab = water_plane.copy()
+            water_slab[:, stack_axis] += k * BOXWIDTH
+            water_slab += translation_vec
+            yield water_slab
+
+    def _iter_cube_water_slabs(self):
+        """Yield the slabs of the cubic water box (side length = box_dim), in
+        the order of the z planes of unit cubes."""
+        n_water_cubes = int(np.ceil(self.box_dim / BOXWIDTH))
+        yield from self._iter_water_slabs(
+            n_water_cubes, stack_axis=2, inner_axis=0, outer_axis=1
+        )
+
+    def _octa_sdf(self, oxygen_coords) -> np.ndarray:
+        """Signed distance of the points (N, 3) to the surface of the truncated 
+        octahedron centered at the origin (negative inside). The maximum is 
+        taken over the three square faces and four pairs of hexagonal faces."""
+        d = self.box_dim / math.sqrt(3)
+        x, y, z = oxygen_coords.T
+        abs_coords = np.abs(oxygen_coords)
+        # square faces
+        sdf = abs_coords.max(axis=1) - d
+        # hexagonal faces
+        for hex_diag in (x + y + z, x + y - z, x - y + z, x - y - z):
+            np.maximum(
+                sdf, (np.abs(hex_diag) - self.box_dim) / math.sqrt(3), out=sdf
+            )
+        return sdf
+
     def create_water_box_coords(self) -> np.ndarray:
         """
         Creates a water box grid based on the chosen box type.
@@ -491,78 +588,64 @@ class Solvator:
           - For 'octa': builds a grid over a cube of side length = box_dim * sqrt(4/3)
             (the bounding cube of a truncated octahedron) and then selects only those
             water molecules whose oxygen atom is at least 'solvcut' inside the octahedron.
+            The grid is generated and filtered one slab of unit cubes at a time 
+            (in the x, y, z order of the unit cubes), so the peak memory is 
+            bounded by the size of the selected waters.
         """
         if self.box_type == "cube":
-            n_water_cubes = int(np.ceil(self.box_dim / BOXWIDTH))
-            water_coords_expanded = self.water_unit_coords.reshape(-1, 3)
-            n_atoms = water_coords_expanded.shape[0]
-            water_line = np.empty((n_atoms * n_water_cubes, 3))
-            water_plane = np.empty((n_atoms * n_water_cubes ** 2, 3))
-            water_box = np.empty((n_atoms * n_water_cubes ** 3, 3))
-            
-            for i in range(n_water_cubes):
-                st, end = i * n_atoms, (i + 1) * n_atoms
-                water_line[st:end, 0] = water_coords_expanded[:, 0] + i * BOXWIDTH
-                water_line[st:end, 1:] = water_coords_expanded[:, 1:]
-            
-            n_atoms_per_line = water_line.shape[0]
-            for i in range(n_water_cubes):
-                st, end = i * n_atoms_per_line, (i + 1) * n_atoms_per_line
-                water_plane[st:end] = water_line
-                water_plane[st:end, 1] += i * BOXWIDTH
-            
-            n_atoms_per_plane = water_plane.shape[0]
-            for i in range(n_water_cubes):
-                st, end = i * n_atoms_per_plane, (i + 1) * n_atoms_per_plane
-                water_box[st:end] = water_plane
-                water_box[st:end, 2] += i * BOXWIDTH
-            
-            # Recenter the box
-            translation_vec = -np.ptp(water_box, axis=0) / 2 - water_box.min(0)
-            water_box += translation_vec
-            return water_box
+            return np.concatenate(list(self._iter_cube_water_slabs()))
         elif self.box_type == "octa":
             # Bounding cube side length for the octahedron is box_dim * sqrt(4/3)
             grid_length = self.box_dim * math.sqrt(4 / 3)
             n_units = int(math.ceil(grid_length / BOXWIDTH))
-            water_coords_expanded = self.water_unit_coords.reshape(-1, 3)
-            n_atoms = water_coords_expanded.shape[0]
-            water_points = []
-            for i in range(n_units):
-                for j in range(n_units):
-                    for k in range(n_units):
-                        translation = np.array([i * BOXWIDTH, j * BOXWIDTH, k * BOXWIDTH])
-                        for atom in water_coords_expanded:
-                            water_points.append(atom + translation)
-            water_points = np.array(water_points)
-            # Recenter the grid so that its bounding box is centered at the origin
-            translation_vec = -np.ptp(water_points, axis=0) / 2 - water_points.min(0)
-            water_points += translation_vec
-            # Reshape into water molecules (each with 3 atoms)
-            water_box = water_points.reshape(-1, 3, 3)
             # Filter water molecules by testing that the oxygen atom (first atom)
             # is at least 'solvcut' inside the truncated octahedron.
             selected_waters = []
-            for water in water_box:
-                oxygen = water[0]
-                x, y, z = oxygen
-                d = self.box_dim / math.sqrt(3)
-                # Compute differences for the square faces:
-                dist1 = abs(x) - d
-                dist2 = abs(y) - d
-                dist3 = abs(z) - d
-                # Compute differences for the hexagonal faces:
-                dist4 = (abs(x + y + z) - self.box_dim) / math.sqrt(3)
-                dist5 = (abs(x + y - z) - self.box_dim) / math.sqrt(3)
-                dist6 = (abs(x - y + z) - self.box_dim) / math.sqrt(3)
-                dist7 = (abs(x - y - z) - self.box_dim) / math.sqrt(3)
-                sdf_value = max(dist1, dist2, dist3, dist4, dist5, dist6, dist7)
-                if sdf_value <= -self.solvcut:
-                    selected_waters.append(water)
-            return np.array(selected_waters)
+            for water_slab in self._iter_water_slabs(
+                n_units, stack_axis=0, inner_axis=2, outer_axis=1
+            ):
+                water_slab = water_slab.reshape(-1, 3, 3)
+                inside = self._octa_sdf(water_slab[:, 0]) <= -self.solvcut
+                selected_waters.append(water_slab[inside])
+            return np.concatenate(selected_waters)
         else:
             raise ValueError("Unsupported box type")
 
+    def _get_clash_free_mask(
+            self, points, tile_size=CLASH_TILE_SIZE, workers=-1
+        ) -> np.ndarray:
+        """Return a boolean mask of the points (N, 3) that are farther than 
+        solvcut from every solute atom. Only the solute is indexed (KDTree), 
+        and the points are streamed through it in tiles with a nearest-neighbor
+        query bounded by solvcut, so no neighbor lists are materialized and 
+        the memory is O(solute + tile). Tiles that lie entirely outside the 
+        solute bounding box (padded by solvcut) are accepted without a query.
+        The queries of a tile are split across `workers` cores (-1 for all).
+        """
+        n_points = len(points)
+        survivors = np.ones(n_points, dtype=bool)
+        if len(self.coords) == 0 or n_points == 0:
+            return survivors
+        kd_tree = KDTree(self.coords)
+        solute_min = self.coords.min(0) - self.solvcut
+        solute_max = self.coords.max(0) + self.solvcut
+        # make the upper bound inclusive to match query_ball_tree (r <= solvcut)
+        upper_bound = np.nextafter(self.solvcut, np.inf)
+        for st in range(0, n_points, tile_size):
+            tile = points[st:st+tile_size]
+            if (
+                np.any(tile.min(0) > solute_max) or 
+                np.any(tile.max(0) < solute_min)
+            ):
+                continue
+            dists, _ = kd_tree.query(
+                tile, k=1, distance_upper_bound=upper_bound, workers=workers
+            )
+            count('kdtree_queries', len(tile))
+            # distance is inf if no solute atom is found within the bound
+            survivors[st:st+tile_size] = np.isinf(dists)
+        return survivors
+
     def get_expelled_water_box_coords(self) -> np.ndarray:
         """
         Returns water molecules that are outside the solvcut distance from the solute.
@@ -572,77 +655,57 @@ class Solvator:
         solvcut of the solute.
         """
         if self.box_type == "cube":
-            water_box = self.create_water_box_coords()  # shape (N_points, 3)
-            # Select water molecules fully within the cubic boundary.
-            c1 = water_box > self.box_dim / 2
-            c2 = water_box < -self.box_dim / 2
-            boundary_select = np.logical_not(
-                np.any((c1 | c2).reshape(-1, 3, 3), axis=(1, 2))
-            )
-            kd_tree = KDTree(self.coords)
-            water_kd_tree = KDTree(water_box)
-            r = water_kd_tree.query_ball_tree(kd_tree, self.solvcut)
-            within_cutoff = np.empty(len(r), dtype=bool)
-            for i, nei_list in enumerate(r):
-                within_cutoff[i] = bool(len(nei_list))
-            cutoff_select = np.logical_not(
-                np.any(within_cutoff.reshape(-1, 3), axis=1)
+            # Select water molecules fully within the cubic boundary, one slab
+            # of the box at a time.
+            selected_waters = []
+            for water_slab in self._iter_cube_water_slabs():
+                c1 = water_slab > self.box_dim / 2
+                c2 = water_slab < -self.box_dim / 2
+                boundary_select = np.logical_not(
+                    np.any((c1 | c2).reshape(-1, 3, 3), axis=(1, 2))
+                )
+                selected_waters.append(
+                    water_slab.reshape((-1, 3, 3))[boundary_select]
+                )
+            # only test the waters that are inside the boundary
+            water_box = np.concatenate(selected_waters)
+            cutoff_select = np.all(
+                self._get_clash_free_mask(water_box.reshape(-1, 3)).reshape(-1, 3),
+                axis=1
             )
-            water_box = water_box.reshape((-1, 3, 3))[boundary_select & cutoff_select]
-            return water_box
+            return water_box[cutoff_select]
         elif self.box_type == "octa":
             water_box = self.create_water_box_coords()  # Already shape (N_waters, 3, 3)
-            # Use the oxygen atom (first atom) of each water for KDTree filtering.
-            oxy_coords = np.array([water[0] for water in water_box])
-            kd_tree = KDTree(self.coords)
-            water_kd_tree = KDTree(oxy_coords)
-            r = water_kd_tree.query_ball_tree(kd_tree, self.solvcut)
-            cutoff_select = []
-            for nei_list in r:
-                cutoff_select.append(not bool(len(nei_list)))
-            cutoff_select = np.array(cutoff_select)
-            water_box = water_box[cutoff_select]
-            return water_box
+            # Use the oxygen atom (first atom) of each water for clash filtering.
+            cutoff_select = self._get_clash_free_mask(water_box[:, 0])
+            return water_box[cutoff_select]
         else:
             raise ValueError("Unsupported box type")
 
-    def _create_new_water_chain(self, alphabet_index) -> Solvent:
+    def _create_new_water_chain(self, alphabet_index, water_coords) -> BulkSolvent:
         chain_id = 'W'+self.alphabet[alphabet_index]
-        water_chain = Solvent(chain_id)
+        water_template = Residue((' ', 1, ' '), 'TIP3', '')
+        for atom in (OH2, H1, H2):
+            water_template.add(atom.copy())
+        water_chain = BulkSolvent(chain_id, water_template, water_coords)
         water_chain.pdbx_description = 'water'
         water_chain.source = 'generated'
         return water_chain
 
+    @instrumented('solvate')
     def _solvate_model(self):
         self.water_box_coords = self.get_expelled_water_box_coords()
-        alphabet_index = 0
         assert self.water_box_coords.shape[1:] == (3, 3), \
         f'Invalid water box coords shape {self.water_box_coords.shape}'
         water_chains = []
-        for i, res_coords in enumerate(self.water_box_coords):
-            # split water molecules into chains of 9999 residues for PDB format
-            # compliance
-            resseq = i % 9999 + 1
-            if resseq == 1:
-                cur_water_chain = self._create_new_water_chain(alphabet_index)
-                alphabet_index += 1
-                water_chains.append(cur_water_chain)
-
-            water_res = Residue((' ', resseq, ' '), 'TIP3', '')
-
-            cur_oxygen = OH2.copy()
-            cur_h1 = H1.copy()
-            cur_h2 = H2.copy()
-
-            OH2_coord, H1_coord, H2_coord = res_coords
-            cur_oxygen.coord = OH2_coord
-            cur_h1.coord = H1_coord
-            cur_h2.coord = H2_coord
-
-            water_res.add(cur_oxygen)
-            water_res.add(cur_h1)
-            water_res.add(cur_h2)
-            cur_water_chain.add(water_res)
+        # split water molecules into chains of 9999 residues for PDB format
+        # compliance
+        for alphabet_index, start in enumerate(
+            range(0, len(self.water_box_coords), 9999)
+        ):
+            water_chains.append(self._create_new_water_chain(
+                alphabet_index, self.water_box_coords[start:start+9999]
+            ))
 
         for water_chain in water_chains:
             self.model.add(water_chain)
@@ -856,7 +919,7 @@ class Solvator:
         n_water = 0
         for chain in self.model:
             if chain.chain_type == 'Solvent':
-                n_water += len(list(chain.get_residues()))
+                n_water += len(chain)
         return n_water
 
     def _calculate_solvent_volume(self) -> float:
@@ -1096,31 +1159,41 @@ class Solvator:
         min_dist_ion : float
             Minimum distance between placed ions in Å.
         max_attempts : int
-            Maximum attempts to place each ion before giving up.
+            Maximum number of candidate waters tried for each ion before
+            giving up. Waters closer than min_dist_solute to the solute are
+            filtered out beforehand, and a water rejected for one ion is not
+            tried again for the next ions (it can never become valid), so
+            neither counts as an attempt.
 
         Returns
         -------
         list
-            List of (water_residue, ion_name) tuples for successful placements.
+            List of (water_chain, water_key, oxygen_coord, ion_name) tuples for
+            successful placements. water_key is the residue id of the replaced
+            water, or its position in the chain for array-backed solvent.
         """
-        # Get all water residues and their oxygen coordinates
-        water_residues = []
+        # Get all water molecules and their oxygen coordinates
+        water_keys = []
         water_coords = []
         for chain in solvents:
+            if getattr(chain, 'is_array_backed', False):
+                water_keys.extend((chain, i) for i in range(len(chain)))
+                water_coords.extend(chain.get_atom_coords('OH2'))
+                continue
             for res in chain.get_residues():
                 if 'OH2' in res:
-                    water_residues.append(res)
+                    water_keys.append((chain, res.id))
                     water_coords.append(res['OH2'].coord)
                 elif 'O' in res:
-                    water_residues.append(res)
+                    water_keys.append((chain, res.id))
                     water_coords.append(res['O'].coord)
 
-        if len(water_residues) == 0:
+        if len(water_keys) == 0:
             raise ValueError("No water molecules found for ion placement")
 
         water_coords = np.array(water_coords)
 
-        # Build KDTree of solute atoms
+        # Solute distance of all water oxygens in one batched KDTree query
         solute_coords = []
         for chain in self.model:
             if chain.chain_type not in ('Solvent', 'Ion'):
@@ -1128,51 +1201,40 @@ class Solvator:
                     solute_coords.append(atom.coord)
 
         if len(solute_coords) > 0:
-            solute_coords = np.array(solute_coords)
-            solute_tree = KDTree(solute_coords)
+            solute_tree = KDTree(np.array(solute_coords))
+            # the bound is just above min_dist_solute, so that waters exactly
+            # at min_dist_solute are found and accepted (inclusive test)
+            dist_to_solute, _ = solute_tree.query(
+                water_coords, k=1,
+                distance_upper_bound=np.nextafter(min_dist_solute, np.inf),
+                workers=-1
+            )
+            # inf if no solute atom is within the bound
+            eligible = dist_to_solute >= min_dist_solute
         else:
-            solute_tree = None
-
-        # Track placed ion positions and used water indices
-        placed_ion_coords = []
-        used_water_indices = set()
+            eligible = np.ones(len(water_coords), dtype=bool)
+
+        # Shuffled pool of candidates, consumed from the front. A candidate
+        # rejected for being too close to a placed ion can never become valid 
+        # again, so the pool only shrinks and is never rescanned.
+        candidate_pool = np.flatnonzero(eligible).tolist()
+        random.shuffle(candidate_pool)
+        pool_iter = iter(candidate_pool)
+        ion_grid = _IonExclusionGrid(min_dist_ion)
         placements = []
 
         for ion_name in ion_list:
             placed = False
-            attempts = 0
-
-            # Shuffle water indices for random selection
-            available_indices = [
-                i for i in range(len(water_residues))
-                if i not in used_water_indices
-            ]
-            random.shuffle(available_indices)
-
-            for idx in available_indices:
-                if attempts >= max_attempts:
-                    break
-                attempts += 1
-
+            for attempts, idx in enumerate(pool_iter, start=1):
                 coord = water_coords[idx]
-
-                # Check distance from solute
-                if solute_tree is not None:
-                    dist_to_solute = solute_tree.query(coord)[0]
-                    if dist_to_solute < min_dist_solute:
-                        continue
-
-                # Check distance from other placed ions
-                if len(placed_ion_coords) > 0:
-                    ion_coords_array = np.array(placed_ion_coords)
-                    dists = np.linalg.norm(ion_coords_array - coord, axis=1)
-                    if np.min(dists) < min_dist_ion:
-                        continue
-
+                if ion_grid.has_neighbor(coord):
+                    if attempts >= max_attempts:
+                        break
+                    continue
                 # Accept this placement
-                placements.append((water_residues[idx], ion_name))
-                placed_ion_coords.append(coord)
-                used_water_indices.add(idx)
+                water_chain, water_key = water_keys[idx]
+                placements.append((water_chain, water_key, coord, ion_name))
+                ion_grid.add(coord)
                 placed = True
                 break
 
@@ -1310,19 +1372,25 @@ class Solvator:
         ion_names_str = ', '.join(sorted(set(ion_list)))
         new_ion_chain.pdbx_description = f"ions ({ion_names_str}) at {concentration*1000:.0f} mM"
 
-        for i, (water_res, ion_name) in enumerate(placements, start=1):
-            if 'OH2' in water_res:
-                oxy_coord = water_res['OH2'].coord
-            else:
-                oxy_coord = water_res['O'].coord
-
+        replaced_waters = {}
+        for i, (water_chain, water_key, oxy_coord, ion_name) in enumerate(
+            placements, start=1
+        ):
             ion_res = rtf[ion_name].create_residue(resseq=i)
             ion_res.atoms[0].coord = oxy_coord
             new_ion_chain.add(ion_res)
-
-            # Remove water
-            if (water_chain := water_res.parent) is not None:
-                water_chain.detach_child(water_res.id)
+            replaced_waters.setdefault(
+                water_chain.id, (water_chain, [])
+            )[1].append(water_key)
+
+        # Remove replaced waters (positions in array-backed chains are
+        # removed together so they stay valid)
+        for water_chain, water_keys in replaced_waters.values():
+            if getattr(water_chain, 'is_array_backed', False):
+                water_chain.remove_residues(water_keys)
+                continue
+            for water_key in water_keys:
+                water_chain.detach_child(water_key)
 
         self.model.add(new_ion_chain)
         if self._topo_loader is not None:
@@ -2,7 +2,7 @@ import warnings
 from collections import OrderedDict
 import numpy as np
 import numpy.linalg as LA
-from scipy.spatial.transform import Rotation as R
+from crimm.Utils.Instrumentation import instrumented, count
 
 def sep_by_priorities(atom_list):
     # Create a 2-tier priotity list to separate
@@ -41,101 +41,133 @@ def recur_find_build_seq(
         running_dict, missing_atoms, build_seq, exclude_list
     )
 
+def _normalize(vecs):
+    return vecs/LA.norm(vecs, axis=-1, keepdims=True)
+
+def get_coords_from_dihedral_ic(i_coords, j_coords, k_coords, phi, t_jkl, r_kl):
+    """Vectorized NeRF placement of atom l from the dihedral i-j-k-l. The 
+    reference coordinates are (N, 3) arrays and the ic values (in degrees and 
+    angstrom) are scalars or (N,) arrays. Returns the (N, 3) coordinates of l."""
+    phi = np.deg2rad(np.asarray(phi, dtype=float))[..., None]
+    t_jkl = np.deg2rad(np.asarray(t_jkl, dtype=float))[..., None]
+    r_kl = np.asarray(r_kl, dtype=float)[..., None]
+    # unit vector of the j->k bond and the normal of the i-j-k plane
+    bc = _normalize(k_coords - j_coords)
+    n = _normalize(np.cross(i_coords - j_coords, k_coords - j_coords))
+    # direction perpendicular to j->k in the plane rotated by phi about j->k
+    m = np.cross(bc, n)*np.cos(phi) - n*np.sin(phi)
+    return k_coords + r_kl*(m*np.sin(t_jkl) - bc*np.cos(t_jkl))
+
+def get_coords_from_improper_ic(i_coords, j_coords, k_coords, phi, t_jkl, r_kl):
+    """Vectorized placement of atom l from the improper i-j-*k-l, where k is the
+    central atom. Arguments and return values are the same as in 
+    get_coords_from_dihedral_ic."""
+    phi = np.deg2rad(np.asarray(phi, dtype=float))[..., None]
+    t_jkl = np.deg2rad(np.asarray(t_jkl, dtype=float))[..., None]
+    r_kl = np.asarray(r_kl, dtype=float)[..., None]
+    bc = _normalize(k_coords - j_coords)
+    n = _normalize(np.cross(k_coords - j_coords, k_coords - i_coords))
+    m = np.cross(n, bc)*np.cos(phi) + n*np.sin(phi)
+    return k_coords - r_kl*(m*np.sin(t_jkl) + bc*np.cos(t_jkl))
+
 def get_coord_from_dihedral_ic(i_coord, j_coord, k_coord, phi, t_jkl, r_kl):
-    origin = j_coord
-    a1 = i_coord - origin
-    a2 = k_coord - origin
-    r1 = R.from_rotvec(phi * a2/LA.norm(a2), degrees=True)
-    n1 = np.cross(a1, a2)
-    n2 = r1.apply(n1)
-    m = np.cross(a2, n2)
-    r2 = R.from_rotvec((t_jkl-90) * n2/LA.norm(n2), degrees=True)
-    a3 = r2.apply(m)
-    a3 = a3/LA.norm(a3)*r_kl
-
-    l_coord = origin+a2+a3
-    return l_coord
+    coords = get_coords_from_dihedral_ic(
+        np.asarray(i_coord)[None], np.asarray(j_coord)[None],
+        np.asarray(k_coord)[None], phi, t_jkl, r_kl
+    )
+    return coords[0]
     
 def get_coord_from_improper_ic(i_coord, j_coord, k_coord, phi, t_jkl, r_kl):
-    origin = k_coord
-    a1 = origin - i_coord
-    a2 = origin - j_coord
-    r1 = R.from_rotvec(phi * a2/LA.norm(a2), degrees=True)
-    n1 = np.cross(a2, a1)
-    n2 = r1.apply(n1)
-    m = np.cross(n2, a2)
-    r2 = R.from_rotvec((t_jkl+90) * n2/LA.norm(n2), degrees=True)
-    a3 = r2.apply(m)
-    a3 = a3/LA.norm(a3)*r_kl
-    
-    l_coord = origin+a3
-    return l_coord
+    coords = get_coords_from_improper_ic(
+        np.asarray(i_coord)[None], np.asarray(j_coord)[None],
+        np.asarray(k_coord)[None], phi, t_jkl, r_kl
+    )
+    return coords[0]
     
 def find_build_seq(topo_def, missing_atoms, missing_hydrogens):
-    missing_atoms = list(missing_atoms)
-    missing_hydrogens = list(missing_hydrogens)
+    """Return the build sequences of the missing heavy atoms and hydrogens. The
+    sequences only depend on the definition and the missing atom names, and are 
+    cached on the definition for each missing atom pattern."""
+    missing_atoms = tuple(missing_atoms)
+    missing_hydrogens = tuple(missing_hydrogens)
+    cache_key = (missing_atoms, missing_hydrogens)
+    if (build_seqs := topo_def._build_seq_cache.get(cache_key)) is not None:
+        return build_seqs
     all_missing = missing_atoms + missing_hydrogens
     lookup_dict = topo_def.atom_lookup_dict
     running_dict = OrderedDict({k: lookup_dict[k] for k in all_missing})
 
     heavy_build_seq = recur_find_build_seq(
         running_dict,
-        missing_atoms.copy(), # Prevent element removal on the original list
+        list(missing_atoms), # Prevent element removal on the original list
         build_seq = [], 
         exclude_list = missing_hydrogens
     )
 
     hydrogen_build_seq = recur_find_build_seq(
         running_dict,
-        missing_hydrogens.copy(),
+        list(missing_hydrogens),
         build_seq = [],
         exclude_list = []
     )
-
-    return heavy_build_seq, hydrogen_build_seq
-
-def find_coords_by_ic(build_sequence, ic_dicts, coord_dict):
+    build_seqs = (tuple(heavy_build_seq), tuple(hydrogen_build_seq))
+    topo_def._build_seq_cache[cache_key] = build_seqs
+    return build_seqs
+
+def _get_ic_build_step(atom_name, ic_key, ic_param_dict):
+    """Return the names of the three reference atoms, the ic values and the 
+    placement function to build atom_name from an ic entry."""
+    i, j, k, l = ic_key
+    is_improper = ic_param_dict['improper']
+    phi = ic_param_dict['Phi']
+    if atom_name == i:
+        # the atom is i
+        if is_improper:
+            # i, j, *k, l => l, *k, j, i = a1, a2, a3, cur_atom
+            ref_names = (j, l, k)
+            bond_len = ic_param_dict['R(I-K)']
+            bond_angle = ic_param_dict['T(I-K-J)']
+            build_func = get_coords_from_improper_ic
+        else:
+            # i, j, k, l => l, k, j, i = a1, a2, a3, cur_atom
+            ref_names = (l, k, j)
+            bond_len = ic_param_dict['R(I-J)']
+            bond_angle = ic_param_dict['T(I-J-K)']
+            build_func = get_coords_from_dihedral_ic
+    else:
+        # the atom is l
+        ref_names = (i, j, k)
+        bond_len = ic_param_dict['R(K-L)']
+        bond_angle = ic_param_dict['T(J-K-L)']
+        if is_improper:
+            build_func = get_coords_from_improper_ic
+        else:
+            build_func = get_coords_from_dihedral_ic
+    return ref_names, (phi, bond_angle, bond_len), build_func
+
+def find_coords_by_ic_batch(build_sequence, ic_dicts, coord_dicts):
+    """Build the atoms in build_sequence for a list of residues sharing the same
+    ic table. Each build step places the atom on all residues (coord_dicts) at
+    once. The coordinates are stored in the coord_dicts and the list of the
+    computed atom names is returned."""
     computed_coords = []
     for atom_name, ic_key in build_sequence:
-        i, j, k, l = ic_key
-        ic_param_dict = ic_dicts[ic_key]
-        is_improper = ic_param_dict['improper']
-        phi = ic_param_dict['Phi']
-        if atom_name == i:
-            # the atom is i
-            if is_improper:
-                # i, j, *k, l => l, *k, j, i = a1, a2, a3, cur_atom
-                a1, a2, a3 = coord_dict[j], coord_dict[l], coord_dict[k]
-                bond_len = ic_param_dict['R(I-K)']
-                bond_angle = ic_param_dict['T(I-K-J)']
-                coord = get_coord_from_improper_ic(
-                    a1, a2, a3, phi, bond_angle, bond_len
-                )
-            else:
-                # i, j, k, l => l, k, j, i = a1, a2, a3, cur_atom
-                a1, a2, a3 = coord_dict[l], coord_dict[k], coord_dict[j]
-                bond_len = ic_param_dict['R(I-J)']
-                bond_angle = ic_param_dict['T(I-J-K)']
-                coord = get_coord_from_dihedral_ic(
-                    a1, a2, a3, phi, bond_angle, bond_len
-                )
-        else:
-            # the atom is l
-            a1, a2, a3 = coord_dict[i], coord_dict[j], coord_dict[k]
-            bond_len = ic_param_dict['R(K-L)']
-            bond_angle = ic_param_dict['T(J-K-L)']
-            if is_improper:
-                coord = get_coord_from_improper_ic(
-                    a1, a2, a3, phi, bond_angle, bond_len
-                )
-            else:
-                coord = get_coord_from_dihedral_ic(
-                    a1, a2, a3, phi, bond_angle, bond_len
-                )
+        ref_names, ic_values, build_func = _get_ic_build_step(
+            atom_name, ic_key, ic_dicts[ic_key]
+        )
+        a1, a2, a3 = (
+            np.array([coord_dict[name] for coord_dict in coord_dicts], dtype=float)
+            for name in ref_names
+        )
+        coords = build_func(a1, a2, a3, *ic_values)
+        for coord_dict, coord in zip(coord_dicts, coords):
+            coord_dict[atom_name] = coord
         computed_coords.append(atom_name)
-        coord_dict[atom_name] = coord
-        
+
     return computed_coords
+
+def find_coords_by_ic(build_sequence, ic_dicts, coord_dict):
+    return find_coords_by_ic_batch(build_sequence, ic_dicts, [coord_dict])
     
 def ab_initio_ic_build(topo_def):
     ic_dicts = topo_def.ic
@@ -332,6 +364,10 @@ class ResidueFixer:
         computed_atom_names = find_coords_by_ic(
             build_sequence, self.topo_def.ic, self.coord_dict
         )
+        return self._add_built_atoms(computed_atom_names, missing_atoms)
+
+    def _add_built_atoms(self, computed_atom_names, missing_atoms:dict):
+        """Add the atoms with computed coordinates to the residue."""
         built_atoms = []
         for atom_name in computed_atom_names:
             built_atom = missing_atoms.pop(atom_name)
@@ -353,6 +389,7 @@ class ResidueFixer:
             return
         return self._build_atoms(self.heavy_build_sequence, self.missing_atoms)
 
+    @instrumented('build_hydrogens')
     def build_hydrogens(self):
         """Build hydrogens atoms based on residue topology definition on 
         internal coordinates. Any missing heavy atoms will be built before building
@@ -362,6 +399,17 @@ class ResidueFixer:
 
         if len(self.missing_hydrogens) == 0:
             return
+        built_atoms = self._build_heavy_atoms_for_hydrogens()
+        built_atoms.extend(
+            self._build_atoms(
+                self.hydrogen_build_sequence, self.missing_hydrogens
+            )
+        )
+        count('atoms_built', len(built_atoms))
+        return built_atoms
+
+    def _build_heavy_atoms_for_hydrogens(self):
+        """Build the missing heavy atoms that the hydrogens depend on."""
         built_atoms = []
         if len(self.missing_atoms) != 0:
             missing_atom_names = tuple(self.missing_atoms.keys())
@@ -374,11 +422,6 @@ class ResidueFixer:
                     f'before building hydrogens: {missing_atom_names}'
                 )
             built_atoms.extend(self.build_missing_atoms())
-        built_atoms.extend(
-            self._build_atoms(
-                self.hydrogen_build_sequence, self.missing_hydrogens
-            )
-        )
         return built_atoms
 
     def remove_undefined_atoms(self):
@@ -420,6 +463,45 @@ def build_missing_atoms_for_chain(chain):
             built_atoms[(res.id[1], res.resname)] = res_builder.build_missing_atoms()
     return built_atoms
 
+@instrumented('build_hydrogens')
+def build_hydrogens_batched(fixers):
+    """Build hydrogens for a list of loaded ResidueFixers. Equivalent to calling
+    build_hydrogens() on each fixer, but residues sharing the same topology 
+    definition and hydrogen build sequence are built together, with each build 
+    step placing the hydrogen on all of them at once.
+    
+    Args:
+        fixers: list of ResidueFixers with the residues loaded.
+
+    Returns:
+        A list of the built atoms for each fixer (None if the residue has no 
+        missing hydrogens).
+    """
+    built_atoms = [None]*len(fixers)
+    groups = {}
+    for i, fixer in enumerate(fixers):
+        if len(fixer.missing_hydrogens) == 0:
+            continue
+        built_atoms[i] = fixer._build_heavy_atoms_for_hydrogens()
+        group_key = (id(fixer.topo_def), fixer.hydrogen_build_sequence)
+        groups.setdefault(group_key, []).append(i)
+
+    for (_, build_sequence), fixer_ids in groups.items():
+        topo_def = fixers[fixer_ids[0]].topo_def
+        computed_atom_names = find_coords_by_ic_batch(
+            build_sequence, topo_def.ic,
+            [fixers[i].coord_dict for i in fixer_ids]
+        )
+        for i in fixer_ids:
+            fixer = fixers[i]
+            built_atoms[i].extend(
+                fixer._add_built_atoms(
+                    computed_atom_names, fixer.missing_hydrogens
+                )
+            )
+    count('atoms_built', sum(len(atoms) for atoms in built_atoms if atoms))
+    return built_atoms
+
 def build_hydrogens_for_chain(chain, rebuild=False):
     """Build missing hydrogens for a PolymerChain where topology definitions 
     have been loaded for each residue. Missing atom will be built based on the IC
@@ -431,8 +513,7 @@ def build_hydrogens_for_chain(chain, rebuild=False):
         rebuild: If True, remove all hydrogens and rebuild them. If False, only
             build missing hydrogens.
     """
-    built_atoms = {}
-    res_builder = ResidueFixer()
+    res_keys, fixers = [], []
     chain.sort_residues()
     for res in chain:
         if res.topo_definition is None:
@@ -440,11 +521,13 @@ def build_hydrogens_for_chain(chain, rebuild=False):
             continue
         if not res.missing_hydrogens and not rebuild:
             continue
+        res_builder = ResidueFixer()
         res_builder.load_residue(res)
         if rebuild:
             res_builder.remove_hydrogens()
-        built_atoms[(res.id[1], res.resname)] = res_builder.build_hydrogens()
-    return built_atoms
+        res_keys.append((res.id[1], res.resname))
+        fixers.append(res_builder)
+    return dict(zip(res_keys, build_hydrogens_batched(fixers)))
 
 def fix_chain(chain):
     """Fix a PolymerChain by building missing atoms and hydrogens based on 
@@ -458,24 +541,51 @@ def fix_chain(chain):
     Returns:
         A dictionary of built atoms with residue id and residue name as keys.
     """
-    built_atoms = {}
-    res_builder = ResidueFixer()
     chain.sort_residues()
-    for res in chain:
+    return fix_residues(chain.residues)
+
+def fix_residues(residues):
+    """Build the missing atoms and hydrogens of a list of residues (in chain 
+    order) based on their topology definitions, and remove any undefined 
+    atoms. Same as fix_chain, e.g. for the mutated residues of a chain.
+
+    Args:
+        residues: list of Residues with topology definitions loaded.
+
+    Returns:
+        A dictionary of built atoms with residue id and residue name as keys.
+    """
+    built_atoms = {}
+    fixers = []
+    undefined_atom_residues = []
+    for res in residues:
         if res.topo_definition is None:
             warnings.warn(f'No topology definition on {res}! Skipped')
             continue
         if res.missing_atoms or res.missing_hydrogens:
+            # heavy atoms are built in chain order, since the next residue
+            # takes the built backbone atoms as its neighbor atoms
+            res_builder = ResidueFixer()
             res_builder.load_residue(res)
             cur_built_atoms = built_atoms[(res.id[1], res.resname)] = []
             if built_heavy_atoms := res_builder.build_missing_atoms():
                 cur_built_atoms.extend(built_heavy_atoms)
             # we force rebuild hydrogens if there are missing heavy atoms
-            built_hydrogens = res_builder.rebuild_hydrogens()
-            cur_built_atoms.extend(built_hydrogens)
+            res_builder.remove_hydrogens()
+            fixers.append((cur_built_atoms, res_builder))
         if res.undefined_atoms:
-            res_builder.load_residue(res)
-            res_builder.remove_undefined_atoms()
+            undefined_atom_residues.append(res)
+
+    # hydrogens only depend on the heavy atoms, and are built in batches
+    built_hydrogens = build_hydrogens_batched([fixer for _, fixer in fixers])
+    for (cur_built_atoms, _), cur_built_hydrogens in zip(fixers, built_hydrogens):
+        if cur_built_hydrogens:
+            cur_built_atoms.extend(cur_built_hydrogens)
+
+    res_builder = ResidueFixer()
+    for res in undefined_atom_residues:
+        res_builder.load_residue(res)
+        res_builder.remove_undefined_atoms()
     return built_atoms
 
 def build_water_hs(water):
@@ -1,25 +1,38 @@
 import os
 import warnings
 import subprocess
+from concurrent.futures import ThreadPoolExecutor
 from typing import List, Tuple
 from copy import deepcopy, copy
+from functools import partial
+import numpy as np
 from Bio.Data.PDBData import protein_letters_3to1_extended
 from Bio.Data.PDBData import protein_letters_1to3
 
 from crimm.StructEntities.Model import Model
-from crimm.StructEntities.Chain import PolymerChain, Chain
+from crimm.StructEntities.Chain import PolymerChain, Chain, Solvent, BulkSolvent
 from crimm.StructEntities.Residue import Residue, Heterogen, DisorderedResidue
 from crimm.StructEntities.Atom import Atom
-from crimm.StructEntities.TopoElements import Bond, Angle, Dihedral, Improper
+from crimm.StructEntities.TopoElements import Bond, Angle, Dihedral, Improper, CMap
 from crimm.StructEntities.TopoDefinitions import PatchDefinition,  ResidueDefinition
 from crimm.StructEntities.OrganizedModel import OrganizedModel
-from crimm.IO.PRMParser import categorize_lines, parse_line_dict
 from crimm.IO.RTFParser import RTFParser
+from crimm.IO.PRMParser import parse_prm_block
+from crimm.IO.TopparCache import (
+    load_rtf, load_prm, file_digest, load_ligand_toppar, save_ligand_toppar
+)
 from crimm.Modeller import ResidueFixer
-from crimm.Modeller.TopoFixer import fix_chain
+from crimm.Modeller.TopoFixer import fix_chain, fix_residues
 from crimm.Data.cgenff_mass_dict import CGENFF_MASS_TABLE
+from crimm.Utils.Instrumentation import instrumented, count
+
+from crimm.Adaptors.RDKitConverter import (
+    RDKitHetConverter, MolToMol2Block, get_mol_content_key
+)
 
-from crimm.Adaptors.RDKitConverter import RDKitHetConverter, MolToMol2Block
+# Maximum number of concurrent CGenFF subprocesses for the ligands that are
+# not in the parameter cache
+CGENFF_MAX_WORKERS = min(8, os.cpu_count() or 1)
 
 toppar_dir = os.path.abspath(
     os.path.join(os.path.dirname(__file__), '../Data/toppar')
@@ -84,6 +97,19 @@ def _find_atom_from_neighbor(
         return _find_atom_in_residue(neighbor_residue, atom_name)
     return None
 
+def resolve_template_atoms(residue: Residue, template, n_names=None)->List[Atom]:
+    """Resolve the first n_names atom names of a residue topology template
+    (all names if n_names is None) to the atoms of the residue. Names of 
+    neighbor residue atoms ('-C', '+N') are looked up on the adjacent residues 
+    of the chain, and are None if the neighbor residue does not exist."""
+    atoms = []
+    for atom_name in template.atom_names[:n_names]:
+        if atom_name.startswith('-') or atom_name.startswith('+'):
+            atoms.append(_find_atom_from_neighbor(residue, atom_name))
+        else:
+            atoms.append(_find_atom_in_residue(residue, atom_name))
+    return atoms
+
 def get_bonds_within_residue(residue: Residue)->List[Bond]:
     """Return a list of bonds within the residue (peptide bonds linking neighbor 
     residues are excluded). Raise ValueError if the topology definition is 
@@ -92,18 +118,16 @@ def get_bonds_within_residue(residue: Residue)->List[Bond]:
         raise ValueError(
             'Topology definition is not loaded for this residue!'
         )
+    template = residue.topo_definition.get_topology_template()
+    atoms = resolve_template_atoms(residue, template, template.n_bond_names)
     bonds = []
-    bond_dict = residue.topo_definition.bonds
-    for bond_type, bond_list in bond_dict.items():
-        for atom_name1, atom_name2 in bond_list:
-            atom1 = _find_atom_in_residue(residue, atom_name1)
-            atom2 = _find_atom_in_residue(residue, atom_name2)
-            if atom1 is None or atom2 is None:
-                # one of the atoms has to be in the neighbor residue
-                continue
-            bonds.append(
-                Bond(atom1, atom2, bond_type)
-            )
+    for (i, j), bond_type in zip(template.bonds.tolist(), template.bond_types):
+        atom1, atom2 = atoms[i], atoms[j]
+        if atom1 is None or atom2 is None:
+            continue
+        bonds.append(
+            Bond(atom1, atom2, bond_type)
+        )
     return bonds
 
 def atom_add_neighbors(atom1: Atom, atom2: Atom):
@@ -162,47 +186,77 @@ def chain_trace_atom_neighbors(
     all_bonds.extend(bonds)
     return all_bonds
 
-def _add_dihedral(cur_atom, nei_atom, second_nei_atom, dihedral_set):
-    """Add dihedral angle to the dihedral set. (Private function)"""
-    for third_nei_atom in second_nei_atom.neighbors:
-        if third_nei_atom == nei_atom:
-            continue
-        dihe = Dihedral(cur_atom, nei_atom, second_nei_atom, third_nei_atom)
-        dihedral_set.add(dihe)
-
-def _add_angle_and_dihedral(cur_atom, nei_atom, angle_set, dihedral_set):
-    """Add angle and dihedral angle to the angle and dihedral sets. (Private function)"""
-    for second_nei_atom in nei_atom.neighbors:
-        if second_nei_atom == cur_atom:
-            continue
-        angle = Angle(cur_atom, nei_atom, second_nei_atom)
-        angle_set.add(angle)
-        _add_dihedral(cur_atom, nei_atom, second_nei_atom, dihedral_set)
-
-def traverse_graph(cur_atom, angle_set, dihedral_set, visited_set):
-    """Traverse the graph of atoms and add all angles and dihedral angles to the
-    angle and dihedral sets."""
-    visited_set.add(cur_atom)
-
-    for nei_atom in cur_atom.neighbors:
-        _add_angle_and_dihedral(cur_atom, nei_atom, angle_set, dihedral_set)
-        if nei_atom in visited_set:
-            continue
-        traverse_graph(nei_atom, angle_set, dihedral_set, visited_set)
-
-def _get_improper_from_atom_names(
-        residue: Residue, atom_names: Tuple[str]
-    )->Improper:
-    """Get improper from atom names. (Private function)"""
-    atoms = []
-    for atom_name in atom_names:
-        if atom_name.startswith('-') or atom_name.startswith('+'):
-            atom = _find_atom_from_neighbor(residue, atom_name)
-        else:
-            atom = _find_atom_in_residue(residue, atom_name)
-        if atom is None:
-            return None
-        atoms.append(atom)
+def bonds_to_index_array(bonds)->Tuple[List[Atom], np.ndarray]:
+    """Convert a list of bonds into a list of unique atoms (in order of first
+    appearance) and an (N, 2) array of bond atom indices into that list."""
+    atom_index = {}
+    bond_array = np.array(
+        [[atom_index.setdefault(a, len(atom_index)) for a in bond] for bond in bonds],
+        dtype=np.int64
+    ).reshape(-1, 2)
+    return list(atom_index), bond_array
+
+def bond_graph_csr(bond_array: np.ndarray, n_atoms: int)->Tuple[np.ndarray, np.ndarray]:
+    """Return the CSR adjacency (indptr, indices) of the undirected bond graph.
+    Duplicated bonds and self-bonds are dropped, and the neighbors of each atom
+    are sorted in ascending order."""
+    pairs = np.sort(np.asarray(bond_array, dtype=np.int64).reshape(-1, 2), axis=1)
+    pairs = pairs[pairs[:, 0] != pairs[:, 1]]
+    if len(pairs) > 0:
+        pairs = np.unique(pairs, axis=0)
+    src = np.concatenate((pairs[:, 0], pairs[:, 1]))
+    dst = np.concatenate((pairs[:, 1], pairs[:, 0]))
+    order = np.lexsort((dst, src))
+    indptr = np.zeros(n_atoms+1, dtype=np.int64)
+    np.cumsum(np.bincount(src, minlength=n_atoms), out=indptr[1:])
+    return indptr, dst[order]
+
+def _ragged_arange(counts: np.ndarray)->np.ndarray:
+    """Concatenated aranges of the given lengths, e.g. [2, 3] -> [0, 1, 0, 1, 2].
+    (Private function)"""
+    total = counts.sum()
+    starts = np.cumsum(counts) - counts
+    return np.arange(total) - np.repeat(starts, counts)
+
+def enumerate_angles(indptr: np.ndarray, indices: np.ndarray)->np.ndarray:
+    """Enumerate all angles (i, j, k) of a CSR bond graph as an (N, 3) int array.
+    Each angle is listed once with i < k, so no deduplication is needed."""
+    degree = np.diff(indptr)
+    centers = np.repeat(np.arange(len(degree)), degree)
+    # position of each directed edge in its center's neighbor list
+    positions = np.arange(len(indices)) - indptr[centers]
+    # pair every edge with the edges that come after it for the same center
+    n_partners = degree[centers] - 1 - positions
+    first = np.repeat(np.arange(len(indices)), n_partners)
+    second = first + 1 + _ragged_arange(n_partners)
+    return np.stack(
+        (indices[first], centers[first], indices[second]), axis=1
+    ).reshape(-1, 3)
+
+def enumerate_dihedrals(indptr: np.ndarray, indices: np.ndarray)->np.ndarray:
+    """Enumerate all dihedrals (i, j, k, l) of a CSR bond graph as an (N, 4) int
+    array. Each dihedral is listed once with j < k, so no deduplication is 
+    needed."""
+    degree = np.diff(indptr)
+    centers = np.repeat(np.arange(len(degree)), degree)
+    # every bond j-k once, as the directed edge with j < k
+    is_forward = centers < indices
+    j, k = centers[is_forward], indices[is_forward]
+    n_combos = degree[j] * degree[k]
+    bond_id = np.repeat(np.arange(len(j)), n_combos)
+    local = _ragged_arange(n_combos)
+    deg_k = degree[k][bond_id]
+    j, k = j[bond_id], k[bond_id]
+    i = indices[indptr[j] + local // deg_k]
+    l = indices[indptr[k] + local % deg_k]
+    keep = (i != k) & (l != j)
+    return np.stack((i, j, k, l), axis=1)[keep].reshape(-1, 4)
+
+def _get_improper_from_atoms(atoms: Tuple[Atom])->Improper:
+    """Create the improper from resolved atoms, or return None if any atom is 
+    missing. (Private function)"""
+    if any(atom is None for atom in atoms):
+        return None
     a1, a2, a3, a4 = atoms
     for atom in (a2, a3, a4):
         if atom not in a1.neighbors:
@@ -228,9 +282,13 @@ def residue_get_impropers(residue: Residue)->List[Improper]:
         raise ValueError(
             'Topology definition is not loaded for this residue!'
         )
+    template = residue.topo_definition.get_topology_template()
+    atoms = resolve_template_atoms(residue, template, template.n_improper_names)
     impropers = []
-    for impr_atom_names in residue.topo_definition.impropers:
-        improper = _get_improper_from_atom_names(residue, impr_atom_names)
+    for indices, impr_atom_names in zip(
+        template.impropers.tolist(), template.improper_names
+    ):
+        improper = _get_improper_from_atoms(tuple(atoms[i] for i in indices))
         if improper is None:
             if not _is_terminal_or_orphan_residue(residue):
                 warnings.warn(
@@ -248,30 +306,57 @@ def get_impropers(chain: PolymerChain)->List[Improper]:
         impropers.extend(residue_get_impropers(res))
     return impropers
 
-def _get_cmap_from_atom_names(res, cmap_atom_names):
-    """Get cmap from atom names. (Private function)"""
-    raise NotImplementedError
+def residue_get_cmap(residue: Residue)->List[CMap]:
+    """Return a list of CMap terms within the residue. Raise ValueError if the 
+    topology definition is not loaded."""
+    if residue.topo_definition is None:
+        raise ValueError(
+            'Topology definition is not loaded for this residue!'
+        )
+    template = residue.topo_definition.get_topology_template()
+    if len(template.cmap) == 0:
+        return []
+    atoms = resolve_template_atoms(residue, template)
+    cmaps = []
+    for indices, cmap_atom_names in zip(
+        template.cmap.tolist(), template.cmap_names
+    ):
+        cmap_atoms = [atoms[i] for i in indices]
+        if any(atom is None for atom in cmap_atoms):
+            if not _is_terminal_or_orphan_residue(residue):
+                warnings.warn(
+                    f'Cannot find cmap {cmap_atom_names} in residue {residue}'
+                )
+            continue
+        cmaps.append(
+            CMap(Dihedral(*cmap_atoms[:4]), Dihedral(*cmap_atoms[4:]))
+        )
+    return cmaps
 
 def get_cmap(chain: PolymerChain):
     """Return a list of CMap terms within the chain. Raise ValueError if the 
     topology definition is not loaded."""
     cmaps = []
     for res in chain.residues:
-        if res.topo_definition is None:
-            raise ValueError(
-                'Topology definition is not loaded for this residue!'
-            )
-        for cmap_atom_names in res.topo_definition.cmaps:
-            cmap = _get_cmap_from_atom_names(res, cmap_atom_names)
-            if cmap is None:
-                if not _is_terminal_or_orphan_residue(res):
-                    warnings.warn(
-                        f'Cannot find cmap {cmap_atom_names} in residue {res}'
-                    )
-                continue
-            cmaps.append(cmap)
+        cmaps.extend(residue_get_cmap(res))
     return cmaps
 
+def get_inter_res_bonding_atoms(chain: PolymerChain)->Tuple[str]:
+    """Return the names of the (end, start) atoms of the bond between 
+    consecutive residues of the chain, e.g. ('C', 'N') for the peptide bond."""
+    if chain.chain_type == 'Polypeptide(L)':
+        return ('C','N') # peptide bond
+    elif chain.chain_type == 'Polyribonucleotide':
+        return ("O3'",'P') # phosphodiester bond
+    raise NotImplementedError("Chain type not supported!")
+
+def _get_element_atoms(element)->tuple:
+    """Return the atoms of a topology element. (Private function)"""
+    if isinstance(element, CMap):
+        dihe1, dihe2 = element
+        return (*dihe1, *dihe2)
+    return tuple(element)
+
 def excute_cgenff(cgenff_path, input_mol2_block):
     """Excute cgenff to generate topology and parameter files for a given molecule.
     Takes mol2 block as input and return the output as string."""
@@ -294,17 +379,107 @@ class BaseTopology:
     topo_types = [
         'bonds', 'angles', 'dihedrals', 'impropers'
     ]
+    # element types enumerated from the bond graph as atom index arrays,
+    # element objects are only created when the attribute is accessed
+    graph_topo_types = {'angles': Angle, 'dihedrals': Dihedral}
     def __init__(self):
+        self._graph_indices = {}
+        # parameters of the rows of the index arrays (see set_graph_params)
+        self._graph_params = {}
+        self._graph_elements = {}
+        self._atom_lookup = None
         self.bonds = None
         self.angles = None
         self.dihedrals = None
         self.impropers = None
-        self.atom_lookup = None
         self.missing_param_dict = None
         self.containing_entity = None
         self._visited_atoms = None
         self.containing_entity = None
 
+    def _get_graph_elements(self, topo_type):
+        if topo_type in self._graph_indices:
+            atoms = self._visited_atoms
+            element_cls = self.graph_topo_types[topo_type]
+            indices = self._graph_indices.pop(topo_type).tolist()
+            params = self._graph_params.pop(topo_type, None)
+            if params is None:
+                params = [None] * len(indices)
+            elements = []
+            for element, param in zip(indices, params):
+                element = element_cls(*(atoms[i] for i in element))
+                if param is not None:
+                    element.param = param
+                elements.append(element)
+            self._graph_elements[topo_type] = elements
+        return self._graph_elements.get(topo_type)
+
+    def _set_graph_elements(self, topo_type, elements):
+        self._graph_indices.pop(topo_type, None)
+        self._graph_params.pop(topo_type, None)
+        self._graph_elements[topo_type] = elements
+
+    @property
+    def angles(self):
+        return self._get_graph_elements('angles')
+    @angles.setter
+    def angles(self, value):
+        self._set_graph_elements('angles', value)
+    @property
+    def dihedrals(self):
+        return self._get_graph_elements('dihedrals')
+    @dihedrals.setter
+    def dihedrals(self, value):
+        self._set_graph_elements('dihedrals', value)
+
+    @property
+    def atom_lookup(self):
+        """Lookup table of the topology elements of each atom, created on 
+        first access"""
+        if self._atom_lookup is None and self._visited_atoms is not None:
+            self.create_atom_lookup_table()
+        return self._atom_lookup
+    @atom_lookup.setter
+    def atom_lookup(self, value):
+        self._atom_lookup = value
+
+    def load_bond_graph(self, bonds):
+        """Enumerate angles and dihedrals from the bond graph. The elements are
+        kept as index arrays into the graph atoms until they are accessed."""
+        atoms, bond_array = bonds_to_index_array(bonds)
+        indptr, indices = bond_graph_csr(bond_array, len(atoms))
+        self._visited_atoms = atoms
+        self._graph_elements = {}
+        self._graph_params = {}
+        self._graph_indices = {
+            'angles': enumerate_angles(indptr, indices),
+            'dihedrals': enumerate_dihedrals(indptr, indices)
+        }
+        self.atom_lookup = None
+
+    def get_local_index_array(self, topo_type):
+        """Return the graph atoms and the (n_elements, n_atoms) index array of
+        a topology element type that has not been turned into element objects
+        yet. Return None otherwise."""
+        if topo_type not in self._graph_indices:
+            return None
+        return self._visited_atoms, self._graph_indices[topo_type]
+
+    def set_graph_params(self, topo_type, params):
+        """Set the parameters of the rows of a topology element index array
+        (see get_local_index_array). The parameters are assigned to the
+        element objects when they are created."""
+        if topo_type not in self._graph_indices:
+            raise ValueError(
+                f'{topo_type} are not stored as an index array!'
+            )
+        if len(params) != len(self._graph_indices[topo_type]):
+            raise ValueError(
+                f'Expected {len(self._graph_indices[topo_type])} parameters '
+                f'for {topo_type}, got {len(params)}.'
+            )
+        self._graph_params[topo_type] = list(params)
+
     def __iter__(self):
         for topo_type_name in self.topo_types:
             yield topo_type_name, getattr(self, topo_type_name)
@@ -313,8 +488,10 @@ class BaseTopology:
         if self.containing_entity is None:
             return "<EmptyTopology>"
         s = f"<Topology of {self.containing_entity} with "
-        for attr, value in self:
-            if value is None:
+        for attr in self.topo_types:
+            if attr in self._graph_indices:
+                n = len(self._graph_indices[attr])
+            elif (value := getattr(self, attr)) is None:
                 n = 0
             else:
                 n = len(value)
@@ -337,7 +514,7 @@ class BaseTopology:
     def update(self):
         """Update the topology elements"""
         self.find_topo_elements(self.containing_entity)
-        self.create_atom_lookup_table()
+        self.atom_lookup = None
 
     def create_atom_lookup_table(self) -> dict:
         """Create a lookup table for all topology elements for a given atom in the chain"""
@@ -368,11 +545,27 @@ class BaseTopology:
                 atom_lookup[atom]['impropers'].append(improper)
 
         self.atom_lookup = atom_lookup
+        return atom_lookup
 
     def find_topo_elements(self, entity):
         """Find all topology elements in the entity"""
         raise NotImplementedError
 
+def _count_topo_elements(topology, topo_type):
+    """Return the number of elements of a topology element type without
+    creating element objects that are still stored as index arrays."""
+    if topology is None:
+        return 0
+    if isinstance(topology, BulkSolventTopology):
+        if topo_type not in topology.local_indices:
+            return 0
+        return topology.get_n_elements(topo_type)
+    local = getattr(topology, 'get_local_index_array', None)
+    if local is not None and (local_array := local(topo_type)) is not None:
+        return len(local_array[1])
+    elements = getattr(topology, topo_type, None)
+    return 0 if elements is None else len(elements)
+
 class ModelTopology:
     """A class object that stores topology elements (bond, angles, dihe, etc) 
     for a model."""
@@ -395,6 +588,9 @@ class ModelTopology:
             yield topo_type_name, getattr(self, topo_type_name)
 
     def _gather_topo(self, element_name):
+        """Gather the element objects of all chains. This creates the element
+        objects of array-backed solvent chains (once), PSFWriter and the
+        OpenMM adaptor read their index arrays instead."""
         elements = []
         for chain in self.containing_entity:
             if chain.topology is None:
@@ -423,17 +619,52 @@ class ModelTopology:
     # @property
     # def nonbonded(self):
     #     return self._gather_topo('nonbonded')
+
+    def update_residues(self, residues, param_loader=None):
+        """Update the topology elements of the chains for modified residues 
+        (see ChainTopology.update_residues), and drop the disulfide bonds 
+        that lost their atoms. param_loader is either the ParameterLoader of
+        all chains or a dict of ParameterLoaders by chain id (e.g. for protein
+        and nucleic acid chains). Return the dict of new elements by chain id."""
+        chain_residues = {}
+        for residue in residues:
+            chain_residues.setdefault(id(residue.parent), []).append(residue)
+        new_elements = {}
+        for chain in self.containing_entity:
+            if id(chain) not in chain_residues:
+                continue
+            if not isinstance(chain.topology, ChainTopology):
+                raise ValueError(
+                    f'Incremental topology update is not supported for {chain}!'
+                )
+            if isinstance(param_loader, dict):
+                chain_param_loader = param_loader.get(chain.id)
+            else:
+                chain_param_loader = param_loader
+            new_elements[chain.id] = chain.topology.update_residues(
+                chain_residues[id(chain)], chain_param_loader
+            )
+        updated_atom_ids = {
+            id(atom) for residue in residues for atom in residue.get_atoms()
+        }
+        self.disu_bonds = [
+            bond for bond in self.disu_bonds
+            if all(
+                atom.parent is not None and id(atom) not in updated_atom_ids
+                for atom in bond
+            )
+        ]
+        return new_elements
     
     def __repr__(self):
         repr_str = ''
         if self.containing_entity is None:
             return "<EmptyTopology>"
         s = f"<Topology of {self.containing_entity} with "
-        for attr, value in self:    
-            if value is None:
-                n = 0
-            else:
-                n = len(value)
+        for attr in self.topo_types:
+            n = len(self.disu_bonds) if attr == 'bonds' else 0
+            for chain in self.containing_entity:
+                n += _count_topo_elements(chain.topology, attr)
             s += f"{attr}={n}, "
         if self.disu_bonds:
             s += f'(disulfide bonds={len(self.disu_bonds)}), '
@@ -514,42 +745,137 @@ class HeterogenTopology(BaseTopology):
         """Find all topology elements from the heterogen chain"""
         self.containing_entity = heterogen_chain
         self.find_topo_elements(heterogen_chain)
-        self.create_atom_lookup_table()
+        self.atom_lookup = None
         return self
                         
+    @instrumented('find_topo_elements')
     def find_topo_elements(self, heterogen_chain: Chain):
         """Find all topology elements in the chain"""
         self.bonds = []
-        self.angles = []
-        self.dihedrals = []
         self.impropers = []
-        self._visited_atoms = []
         for residue in heterogen_chain:
             cur_bonds = residue_trace_atom_neigbors(residue)
             if len(cur_bonds) == 0:
                 continue
             self.bonds.extend(cur_bonds)
-            visited_atoms = set()
-            angles = set()
-            dihedrals = set()
-            seed_atom = self._find_seeding_atom(residue)
-            traverse_graph(seed_atom, angles, dihedrals, visited_atoms)
-            self._visited_atoms.extend(list(visited_atoms))
-            self.angles.extend(list(angles))
-            self.dihedrals.extend(list(dihedrals))
             self.impropers.extend(residue_get_impropers(residue))
+        # residues are not bonded to each other, so one graph covers them all
+        self.load_bond_graph(self.bonds)
+
+class BulkSolventTopology:
+    """A class object that stores topology elements (bond, angles, dihe, etc)
+    for a BulkSolvent chain. The elements are generated once on the template
+    residue and kept as local atom indices, which are repeated over all
+    molecules of the chain (see get_index_array, used by PSFWriter and the
+    OpenMM adaptor). Topology element objects are only created when the
+    element lists are accessed, which materializes the chain. They are created
+    once and kept, until the number of molecules in the chain changes."""
+    topo_types = [
+        'bonds', 'angles', 'dihedrals', 'impropers'
+    ]
+    n_element_atoms = {
+        'bonds': 2, 'angles': 3, 'dihedrals': 4, 'impropers': 4
+    }
+    def __init__(self, template_topology: HeterogenTopology):
+        self.template_topology = template_topology
+        self.missing_param_dict = template_topology.missing_param_dict
+        self.containing_entity = None
+        self.local_indices = {}
+        # element objects by topology type, and the number of molecules they
+        # were created for
+        self._elements = {}
+        self._n_element_residues = None
+
+    def load_chain(self, bulk_chain):
+        """Index the template topology elements by the template atom order"""
+        self.containing_entity = bulk_chain
+        self._elements = {}
+        self._n_element_residues = None
+        atom_index = {
+            atom: i for i, atom in enumerate(bulk_chain.template.get_atoms())
+        }
+        for topo_type in self.topo_types:
+            elements = getattr(self.template_topology, topo_type) or []
+            self.local_indices[topo_type] = np.array(
+                [[atom_index[atom] for atom in element] for element in elements],
+                dtype=np.int64
+            ).reshape(-1, self.n_element_atoms[topo_type])
+        return self
 
-    def _find_seeding_atom(self, residue):
-        """Find the first atom to start the search"""
-        for atom in residue.get_atoms():
-            if len(atom.neighbors) > 0:
-                return atom
-        raise ValueError(
-            f'No seeding atom found in residue {residue}!'
-            'This is possibly due to the heterogen residue '
-            'not being defined in the topology file.'
+    def __iter__(self):
+        for topo_type_name in self.topo_types:
+            yield topo_type_name, getattr(self, topo_type_name)
+
+    def __repr__(self) -> str:
+        if self.containing_entity is None:
+            return "<EmptyTopology>"
+        n_res = len(self.containing_entity)
+        s = f"<Topology of {self.containing_entity} with "
+        for topo_type in self.topo_types:
+            s += f"{topo_type}={self.get_n_elements(topo_type)}, "
+        s = s[:-2] + ">"
+        return s
+
+    def get_n_elements(self, topo_type):
+        """Return the number of elements of a topology element type without
+        creating the element objects."""
+        return len(self.local_indices[topo_type]) * len(self.containing_entity)
+
+    def get_index_array(self, topo_type, offset=0):
+        """Return the (n_elements, n_atoms) array of chain atom indices of
+        a topology element type, shifted by offset."""
+        return self.containing_entity.tile_local_indices(
+            self.local_indices[topo_type], offset
         )
 
+    def _get_elements(self, topo_type):
+        """Return the topology element objects, created on first access"""
+        n_residues = len(self.containing_entity)
+        if self._n_element_residues != n_residues:
+            self._elements = {}
+            self._n_element_residues = n_residues
+        if topo_type not in self._elements:
+            self._elements[topo_type] = self._create_elements(topo_type)
+        return self._elements[topo_type]
+
+    def _create_elements(self, topo_type):
+        """Create topology element objects on the (materialized) residues"""
+        template_elements = getattr(self.template_topology, topo_type) or []
+        template_names = [
+            tuple(atom.name for atom in element) for element in template_elements
+        ]
+        elements = []
+        for residue in self.containing_entity:
+            for template_element, atom_names in zip(
+                template_elements, template_names
+            ):
+                if not all(name in residue for name in atom_names):
+                    continue
+                atoms = (residue[name] for name in atom_names)
+                if topo_type == 'bonds':
+                    element = Bond(
+                        *atoms, template_element.type, template_element.param
+                    )
+                else:
+                    element = type(template_element)(
+                        *atoms, param=template_element.param
+                    )
+                elements.append(element)
+        return elements
+
+    @property
+    def bonds(self):
+        return self._get_elements('bonds')
+    @property
+    def angles(self):
+        return self._get_elements('angles')
+    @property
+    def dihedrals(self):
+        return self._get_elements('dihedrals')
+    @property
+    def impropers(self):
+        return self._get_elements('impropers')
+
 class ChainTopology(BaseTopology):
     """A class object that stores topology elements (bond, angles, dihe, etc) 
     of bio-polymer chains, e.g. Protein, RNA, DNA."""
@@ -564,16 +890,11 @@ class ChainTopology(BaseTopology):
         """Find all topology elements from the chain"""
         self.containing_entity = chain
         self.find_topo_elements(chain)
-        self.create_atom_lookup_table()
+        self.atom_lookup = None
         return self
 
-    def _find_seeding_atom(self):
-        """Find the first atom to start the search"""
-        for atom in self.containing_entity.get_atoms():
-            if len(atom.neighbors) > 0:
-                return atom
-
     ## TODO: get Cmap from the topology rtf file
+    @instrumented('find_topo_elements')
     def find_topo_elements(self, chain: Chain):
         """Find all topology elements in the chain"""
         if chain.undefined_res:
@@ -592,24 +913,354 @@ class ChainTopology(BaseTopology):
                 "loop modeling tool to construct the missing residues first."
             )
 
-        if chain.chain_type == 'Polypeptide(L)':
-            inter_res_bond = ('C','N') # peptide bond
-        elif chain.chain_type == 'Polyribonucleotide':
-            inter_res_bond = ("O3'",'P') # phosphodiester bond
-        else:
-            raise NotImplementedError("Chain type not supported!")
-
+        inter_res_bond = get_inter_res_bonding_atoms(chain)
         self.bonds = chain_trace_atom_neighbors(chain, inter_res_bond)
-        visited_atoms = set()
-        angles = set()
-        dihedrals = set()
-        seed_atom = self._find_seeding_atom()
-        traverse_graph(seed_atom, angles, dihedrals, visited_atoms)
-        self._visited_atoms = list(visited_atoms)
-        self.angles = list(angles)
-        self.dihedrals = list(dihedrals)
+        self.load_bond_graph(self.bonds)
         self.impropers = get_impropers(chain) 
+        count('bonds', len(self.bonds))
+        count('impropers', len(self.impropers))
+
+    def _get_stale_atom_check(self, updated_residues):
+        """Return a function that checks if an atom is stale, i.e. belongs to
+        an updated residue or is no longer in the chain. (Private method)"""
+        chain_res_ids = set()
+        for residue in self.containing_entity:
+            chain_res_ids.add(id(residue))
+            if isinstance(residue, DisorderedResidue):
+                chain_res_ids.update(
+                    id(child) for child in residue.disordered_get_list()
+                )
+        updated_atom_ids = {
+            id(atom) for residue in updated_residues
+            for atom in residue.get_atoms()
+        }
+        def is_stale(atom):
+            parent = atom.parent
+            return (
+                id(atom) in updated_atom_ids or parent is None or 
+                id(parent) not in chain_res_ids
+            )
+        return is_stale, updated_atom_ids
+
+    def _trace_updated_bonds(self, res_positions, stale_bonds):
+        """Remove the stale bonds from the neighbors of their atoms and trace 
+        the bonds of the residues at res_positions, including the bonds to 
+        their sequence neighbors. (Private method)"""
+        residues = self.containing_entity.residues
+        for a1, a2 in stale_bonds:
+            a1.neighbors.discard(a2)
+            a2.neighbors.discard(a1)
+        new_bonds = []
+        for i in res_positions:
+            new_bonds.extend(residue_trace_atom_neigbors(residues[i]))
+        end_atom, start_atom = get_inter_res_bonding_atoms(
+            self.containing_entity
+        )
+        link_positions = sorted({
+            j for i in res_positions for j in (i-1, i)
+            if 0 <= j < len(residues)-1
+        })
+        for j in link_positions:
+            a1 = _find_atom_in_residue(residues[j], end_atom)
+            a2 = _find_atom_in_residue(residues[j+1], start_atom)
+            atom_add_neighbors(a1, a2)
+            new_bonds.append(Bond(a1, a2, 'single'))
+        return new_bonds
+
+    @staticmethod
+    def _find_local_graph_elements(seed_atoms, updated_atom_ids):
+        """Enumerate the angles and dihedrals that contain any updated atom from
+        the bond graph within three bonds of the seed atoms. Return the graph 
+        atoms and the angle and dihedral index arrays. (Private method)"""
+        ball = set(seed_atoms)
+        frontier = list(seed_atoms)
+        for _ in range(3):
+            next_frontier = []
+            for atom in frontier:
+                for nei_atom in atom.neighbors:
+                    if nei_atom not in ball:
+                        ball.add(nei_atom)
+                        next_frontier.append(nei_atom)
+            frontier = next_frontier
+        local_bonds = [
+            (atom, nei_atom) for atom in ball for nei_atom in atom.neighbors
+            if nei_atom in ball
+        ]
+        atoms, bond_array = bonds_to_index_array(local_bonds)
+        indptr, indices = bond_graph_csr(bond_array, len(atoms))
+        is_updated = np.array(
+            [id(atom) in updated_atom_ids for atom in atoms], dtype=bool
+        )
+        graph_elements = []
+        for element_indices in (
+            enumerate_angles(indptr, indices),
+            enumerate_dihedrals(indptr, indices)
+        ):
+            graph_elements.append(
+                element_indices[is_updated[element_indices].any(axis=1)]
+            )
+        return atoms, graph_elements[0], graph_elements[1]
+
+    def _merge_graph_elements(self, is_stale, atoms, new_indices):
+        """Drop the stale angles and dihedrals and add the new ones, in either
+        storage form (index arrays into the graph atoms, or element objects).
+        Return the dict of the new element objects, and the dict of the 
+        number of new rows appended to the index arrays. (Private method)"""
+        visited_atoms = self._visited_atoms or []
+        stale_mask = np.array(
+            [is_stale(atom) for atom in visited_atoms], dtype=bool
+        )
+        # new positions of the kept graph atoms
+        remap = np.cumsum(~stale_mask) - 1
+        kept_atoms = [
+            atom for atom, stale in zip(visited_atoms, stale_mask.tolist())
+            if not stale
+        ]
+        atom_pos = {id(atom): i for i, atom in enumerate(kept_atoms)}
+        for atom in atoms:
+            if id(atom) not in atom_pos:
+                atom_pos[id(atom)] = len(kept_atoms)
+                kept_atoms.append(atom)
+        local_to_graph = np.array(
+            [atom_pos[id(atom)] for atom in atoms], dtype=np.int64
+        )
+        new_elements, new_rows = {}, {}
+        for topo_type, indices in new_indices.items():
+            if topo_type in self._graph_indices:
+                old_indices = self._graph_indices[topo_type]
+                is_kept = ~stale_mask[old_indices].any(axis=1)
+                self._graph_indices[topo_type] = np.concatenate(
+                    (remap[old_indices[is_kept]], local_to_graph[indices])
+                )
+                if topo_type in self._graph_params:
+                    self._graph_params[topo_type] = [
+                        param for param, kept in zip(
+                            self._graph_params[topo_type], is_kept.tolist()
+                        ) if kept
+                    ] + [None] * len(indices)
+                new_rows[topo_type] = len(indices)
+                continue
+            element_cls = self.graph_topo_types[topo_type]
+            created = [
+                element_cls(*(atoms[i] for i in element))
+                for element in indices.tolist()
+            ]
+            elements = [
+                element for element in (self._graph_elements.get(topo_type) or [])
+                if not any(is_stale(atom) for atom in element)
+            ]
+            self._graph_elements[topo_type] = elements + created
+            new_elements[topo_type] = created
+        self._visited_atoms = kept_atoms
+        return new_elements, new_rows
 
+    def _find_updated_residue_elements(
+            self, res_positions, updated_atom_ids, find_func
+        ):
+        """Find the elements (impropers or cmap) of the residues at 
+        res_positions and their sequence neighbors that contain any updated
+        atom. (Private method)"""
+        residues = self.containing_entity.residues
+        affected_positions = sorted({
+            j for i in res_positions for j in (i-1, i, i+1)
+            if 0 <= j < len(residues)
+        })
+        return [
+            element for j in affected_positions
+            for element in find_func(residues[j])
+            if any(
+                id(atom) in updated_atom_ids 
+                for atom in _get_element_atoms(element)
+            )
+        ]
+
+    @instrumented('update_topo_elements')
+    def update_residues(self, residues, param_loader=None):
+        """Update the topology elements for modified residues of the chain 
+        (e.g. point mutations or patches) without retracing the whole chain.
+        The elements that contain any atom of the residues (or any atom 
+        removed from the chain) are deleted, and the bonds, angles, 
+        dihedrals, impropers and cmap (if present) involving the residues are
+        found again from the bond graph around them. The residues need to 
+        have their topology definitions and atoms loaded. If param_loader is 
+        provided, the parameters are applied to the new elements, and the 
+        missing_param_dict is updated. Return the dict of new elements by
+        topology type."""
+        chain = self.containing_entity
+        if self.bonds is None:
+            raise ValueError(
+                'Topology elements are not generated for the chain! Use '
+                'load_chain() first.'
+            )
+        chain.sort_residues()
+        res_positions = {id(res): i for i, res in enumerate(chain.residues)}
+        positions = set()
+        for residue in residues:
+            if id(residue) not in res_positions:
+                raise ValueError(f'Residue {residue} is not in chain {chain}!')
+            positions.add(res_positions[id(residue)])
+        positions = sorted(positions)
+        updated_residues = [chain.residues[i] for i in positions]
+        is_stale, updated_atom_ids = self._get_stale_atom_check(
+            updated_residues
+        )
+
+        kept_bonds, stale_bonds = [], []
+        for bond in self.bonds:
+            if is_stale(bond[0]) or is_stale(bond[1]):
+                stale_bonds.append(bond)
+            else:
+                kept_bonds.append(bond)
+        new_bonds = self._trace_updated_bonds(positions, stale_bonds)
+        self.bonds = kept_bonds + new_bonds
+
+        seed_atoms = [
+            atom for residue in updated_residues for atom in residue.get_atoms()
+        ]
+        atoms, angle_indices, dihedral_indices = self._find_local_graph_elements(
+            seed_atoms, updated_atom_ids
+        )
+        new_elements = {'bonds': new_bonds}
+        new_graph_elements, new_rows = self._merge_graph_elements(
+            is_stale, atoms, 
+            {'angles': angle_indices, 'dihedrals': dihedral_indices}
+        )
+        new_elements.update(new_graph_elements)
+
+        for topo_type, find_func in (
+            ('impropers', residue_get_impropers), ('cmap', residue_get_cmap)
+        ):
+            elements = getattr(self, topo_type)
+            if elements is None:
+                continue
+            created = self._find_updated_residue_elements(
+                positions, updated_atom_ids, find_func
+            )
+            setattr(self, topo_type, [
+                element for element in elements
+                if not any(is_stale(atom) for atom in _get_element_atoms(element))
+            ] + created)
+            new_elements[topo_type] = created
+
+        for topo_type, elements in new_elements.items():
+            count(topo_type, len(elements))
+        for topo_type, n_rows in new_rows.items():
+            count(topo_type, n_rows)
+        if param_loader is not None:
+            self._apply_updated_params(
+                param_loader, is_stale, new_elements, new_rows
+            )
+        self.atom_lookup = None
+        return new_elements
+
+    def _apply_updated_params(
+            self, param_loader, is_stale, new_elements, new_rows
+        ):
+        """Apply the parameters to the new elements and to the new rows of the
+        index arrays, and update the missing_param_dict. (Private method)"""
+        missing_param_dict = {}
+        for topo_type, elements in (self.missing_param_dict or {}).items():
+            elements = [
+                element for element in elements
+                if not any(is_stale(atom) for atom in _get_element_atoms(element))
+            ]
+            if elements:
+                missing_param_dict[topo_type] = elements
+        for topo_type, elements in new_elements.items():
+            if topo_type not in ParameterIndex.topo_getters or not elements:
+                continue
+            no_param_list = param_loader._apply_to_element_list(
+                topo_type, elements
+            )
+            if no_param_list:
+                warnings.warn(
+                    f'{len(no_param_list)} {topo_type} failed to find '
+                    'parameters.'
+                )
+                missing_param_dict.setdefault(topo_type, []).extend(
+                    no_param_list
+                )
+        for topo_type, n_rows in new_rows.items():
+            atoms, indices = self.get_local_index_array(topo_type)
+            n_kept = len(indices) - n_rows
+            new_params, no_param_list = param_loader._apply_to_index_array(
+                topo_type, atoms, indices[n_kept:]
+            )
+            params = self._graph_params.get(topo_type, [None] * n_kept)
+            self.set_graph_params(topo_type, params[:n_kept] + new_params)
+            if no_param_list:
+                warnings.warn(
+                    f'{len(no_param_list)} {topo_type} failed to find '
+                    'parameters.'
+                )
+                missing_param_dict.setdefault(topo_type, []).extend(
+                    no_param_list
+                )
+        self.missing_param_dict = missing_param_dict
+
+
+class ParameterIndex:
+    """Memoized parameter lookup for a ParameterLoader.
+
+    Atom types are interned as small integers, so the atom types of a list of
+    topology elements become an (N, k) int array, which can be reduced to its
+    unique rows. The wildcard and reversed matching of the ParameterLoader is
+    then run once per unique row, and the result is stored in a hash table per
+    term type keyed by the tuple of type ids. The tables stay valid until the
+    parameters of the loader change (see ParameterLoader.reset_index).
+    """
+    topo_getters = {
+        'bonds': 'get_bond',
+        'angles': 'get_angle',
+        'dihedrals': 'get_dihedral',
+        'impropers': 'get_improper',
+    }
+    def __init__(self, param_loader):
+        self.param_loader = param_loader
+        self.type_ids = {}
+        self.atom_types = []
+        self._tables = {topo_type: {} for topo_type in self.topo_getters}
+
+    def __repr__(self):
+        n_entries = ', '.join(
+            f'{topo_type}={len(table)}' for topo_type, table in self._tables.items()
+        )
+        return f'<ParameterIndex types={len(self.atom_types)} {n_entries}>'
+
+    def _intern(self, atom_type):
+        if atom_type not in self.type_ids:
+            self.type_ids[atom_type] = len(self.atom_types)
+            self.atom_types.append(atom_type)
+        return self.type_ids[atom_type]
+
+    def intern_types(self, atom_type_rows) -> np.ndarray:
+        """Return the (N, k) array of type ids for N rows of k atom type 
+        names."""
+        rows = [[self._intern(t) for t in row] for row in atom_type_rows]
+        n_atoms = len(rows[0]) if rows else 0
+        return np.array(rows, dtype=np.int64).reshape(len(rows), n_atoms)
+
+    def lookup(self, topo_type, type_ids) -> Tuple[list, np.ndarray]:
+        """Look up the parameters for an (N, k) array of type ids. Return the 
+        list of N parameters (None if not found) and the boolean mask of the 
+        rows that have parameters."""
+        if topo_type not in self.topo_getters:
+            raise ValueError('Invalid topology element type')
+        type_ids = np.asarray(type_ids, dtype=np.int64)
+        if len(type_ids) == 0:
+            return [], np.zeros(0, dtype=bool)
+        unique_rows, inverse = np.unique(type_ids, axis=0, return_inverse=True)
+        inverse = inverse.reshape(-1)
+        table = self._tables[topo_type]
+        get_param = getattr(self.param_loader, self.topo_getters[topo_type])
+        unique_params = []
+        for row in map(tuple, unique_rows.tolist()):
+            if row not in table:
+                table[row] = get_param(tuple(self.atom_types[i] for i in row))
+            unique_params.append(table[row])
+        has_param = np.array([p is not None for p in unique_params], dtype=bool)
+        params = [unique_params[i] for i in inverse.tolist()]
+        return params, has_param[inverse]
 
 class ParameterLoader:
     ic_position_dict = {
@@ -624,6 +1275,7 @@ class ParameterLoader:
     def __init__(self, entity_type=None):
         self.param_dict = {}
         self._raw_data_strings = []
+        self._index = None
         if entity_type is not None:
             self.load_type(entity_type=entity_type)
 
@@ -633,13 +1285,22 @@ class ParameterLoader:
         if entity_type not in prm_path_dict:
             raise ValueError(f'No parameter file for {entity_type}')
         filename = prm_path_dict[entity_type]
-        with open(filename, 'r', encoding='utf-8') as f:
+        # parsed data is cached in binary form (see crimm.IO.TopparCache)
+        self._raw_data_strings, param_dict = load_prm(filename)
+        self.param_dict.update(param_dict)
+        self.reset_index()
 
-            self._raw_data_strings = [
-                l.rstrip() for l in f.readlines() #if not skip_line(l)
-            ]
-            param_line_dict = categorize_lines(self._raw_data_strings)
-        self.param_dict.update(parse_line_dict(param_line_dict))
+    @property
+    def index(self) -> ParameterIndex:
+        """The memoized parameter lookup index, created on first use."""
+        if self._index is None:
+            self._index = ParameterIndex(self)
+        return self._index
+
+    def reset_index(self):
+        """Discard the memoized lookups. Needs to be called if param_dict is
+        modified directly."""
+        self._index = None
 
     def __repr__(self):
         n_bonds = len(self.param_dict['bonds'])
@@ -726,29 +1387,83 @@ class ParameterLoader:
         else:
             raise ValueError('Invalid topology element type')
 
+    def lookup_type_ids(self, topo_type, type_ids) -> Tuple[list, np.ndarray]:
+        """Batched parameter lookup for an (N, k) array of atom type ids (see
+        ParameterIndex.intern_types). Return the list of N parameters and the 
+        boolean mask of the rows that have parameters."""
+        return self.index.lookup(topo_type, type_ids)
+
     def _apply_to_element_list(self, topo_type, topo_element_list):
         """Apply the parameter for a list of topology element"""
-        if topo_type == 'bonds':
-            param_get_func = self.get_bond
-        elif topo_type == 'angles':
-            param_get_func = self.get_angle
-        elif topo_type == 'dihedrals':
-            param_get_func = self.get_dihedral
-        elif topo_type == 'impropers':
-            param_get_func = self.get_improper
-        else:
+        if topo_type not in ParameterIndex.topo_getters:
             raise ValueError('Invalid topology element type')
-        no_param_list = []
-        for topo_element in topo_element_list:
-            param = param_get_func(topo_element.atom_types)
-            if param is None:
-                no_param_list.append(topo_element)
-            else:
+        # the elements with an atom without topology definition are not 
+        # looked up, they have no parameters
+        defined_elements = [
+            topo_element for topo_element in topo_element_list
+            if None not in topo_element.atom_types
+        ]
+        no_param_list = [
+            topo_element for topo_element in topo_element_list
+            if None in topo_element.atom_types
+        ]
+        topo_element_list = defined_elements
+        type_ids = self.index.intern_types(
+            [topo_element.atom_types for topo_element in topo_element_list]
+        )
+        params, has_param = self.lookup_type_ids(topo_type, type_ids)
+        for topo_element, param, found in zip(
+            topo_element_list, params, has_param.tolist()
+        ):
+            if found:
                 topo_element.param = param
+            else:
+                no_param_list.append(topo_element)
         return no_param_list
+
+    def _apply_to_index_array(self, topo_type, atoms, indices):
+        """Look up the parameters of the topology elements given as an 
+        (N, k) index array into the atom list, without creating the element
+        objects. Return the list of N parameters (None if not found) and the
+        list of element objects created for the elements without parameters.
+        The elements with an atom without topology definition have no 
+        parameters."""
+        if topo_type not in BaseTopology.graph_topo_types:
+            raise ValueError('Invalid topology element type')
+        is_defined = np.array(
+            [atom.topo_definition is not None for atom in atoms], dtype=bool
+        )
+        # intern the atom types once per atom, not once per element
+        atom_type_ids = np.full(len(atoms), -1, dtype=np.int64)
+        if is_defined.any():
+            atom_type_ids[is_defined] = self.index.intern_types(
+                [
+                    [atom.topo_definition.atom_type] for atom in atoms
+                    if atom.topo_definition is not None
+                ]
+            ).reshape(-1)
+        indices = np.asarray(indices, dtype=np.int64)
+        is_complete = is_defined[indices].all(axis=1)
+        found_params, found = self.lookup_type_ids(
+            topo_type, atom_type_ids[indices[is_complete]]
+        )
+        params = [None] * len(indices)
+        for i, param in zip(np.flatnonzero(is_complete).tolist(), found_params):
+            params[i] = param
+        has_param = np.zeros(len(indices), dtype=bool)
+        has_param[is_complete] = found
+        element_cls = BaseTopology.graph_topo_types[topo_type]
+        no_param_list = [
+            element_cls(*(atoms[i] for i in element))
+            for element in indices[~has_param].tolist()
+        ]
+        return params, no_param_list
     
+    @instrumented('apply_parameters')
     def apply(self, topo_element_container: ChainTopology):
-        """Apply the parameter for a list of topology element"""
+        """Apply the parameter for a list of topology element. The angles and
+        dihedrals that are still stored as index arrays are parameterized 
+        from the arrays, and their element objects are not created."""
         if not isinstance(topo_element_container, (ChainTopology, HeterogenTopology)):
             raise TypeError(
                 'Invalid argument type provided! Topology'
@@ -756,7 +1471,25 @@ class ParameterLoader:
             )
         missing_param_dict = {}
         
-        for topo_type, topo_element_list in topo_element_container:
+        for topo_type in topo_element_container.topo_types:
+            local_indices = topo_element_container.get_local_index_array(
+                topo_type
+            )
+            if local_indices is not None:
+                atoms, indices = local_indices
+                params, no_param_list = self._apply_to_index_array(
+                    topo_type, atoms, indices
+                )
+                topo_element_container.set_graph_params(topo_type, params)
+                count('elements', len(indices))
+                if no_param_list:
+                    warnings.warn(
+                        f'{len(no_param_list)} {topo_type} failed to find '
+                        'parameters.'
+                    )
+                    missing_param_dict[topo_type] = no_param_list
+                continue
+            topo_element_list = getattr(topo_element_container, topo_type)
             if topo_element_list is None:
                 warnings.warn(
                     f'No {topo_type} found in '
@@ -765,6 +1498,7 @@ class ParameterLoader:
             no_param_list = self._apply_to_element_list(
                 topo_type, topo_element_list
             )
+            count('elements', len(topo_element_list))
             if no_param_list:
                 warnings.warn(
                     f'{len(no_param_list)} {topo_type} failed to find '
@@ -833,6 +1567,50 @@ class ParameterLoader:
         for residue_definition in topology_loader.patched_defs.values():
             self.res_def_fill_ic(residue_definition, preserve)
 
+def get_model_param_loaders(model, param_loaders=None):
+    """Return the list of ParameterLoaders to look up the parameters of the
+    model: param_loaders if provided, otherwise the loaders of the
+    TopologyGenerator that generated the topology of the model."""
+    if param_loaders is not None:
+        return list(param_loaders)
+    topo_loader = getattr(model, 'topology_loader', None)
+    if topo_loader is None:
+        raise ValueError(
+            f'No parameters for {model}! Generate the topology with '
+            'TopologyGenerator.generate_model() or provide param_loaders.'
+        )
+    return list(topo_loader.param_dict.values())
+
+def lookup_params(param_loaders, getter_name, type_rows):
+    """Look up the parameters for an (N, k) array of atom types with the 
+    ParameterLoaders in order. getter_name is either a getter of the 
+    ParameterLoader (e.g. 'get_bond'), or the name of a parameter dict without
+    a getter (e.g. 'urey_bradley' and 'cmap'), whose entries are matched as is
+    or reversed. Each distinct row is only looked up once. Return the list of 
+    unique parameters (None if not found) and the (N,) array of the unique 
+    parameter index of each row."""
+    if len(type_rows) == 0:
+        return [], np.zeros(0, dtype=np.int64)
+    getters = []
+    for param_loader in param_loaders:
+        if getter_name in param_loader.param_dict:
+            getters.append(partial(
+                param_loader._get_param, param_loader.param_dict[getter_name]
+            ))
+        else:
+            getters.append(getattr(param_loader, getter_name))
+    unique_rows, inverse = np.unique(
+        np.asarray(type_rows, dtype=str), axis=0, return_inverse=True
+    )
+    unique_params = []
+    for row in map(tuple, unique_rows.tolist()):
+        param = None
+        for getter in getters:
+            if (param := getter(row)) is not None:
+                break
+        unique_params.append(param)
+    return unique_params, inverse.reshape(-1)
+
 class ResidueTopologySet:
     """Class for loading topology definition to the residue and find any missing atoms.
     Any HIS will be renamed as HSD for protein."""
@@ -852,7 +1630,7 @@ class ResidueTopologySet:
             raise ValueError(f'Unknown entity type: {entity_type}')
         self.is_hetero = self.entity_type not in ('protein', 'nucleic')
 
-        rtf = RTFParser(file_path=rtf_path_dict[self.entity_type])
+        rtf = load_rtf(rtf_path_dict[self.entity_type])
         self._raw_data_strings = rtf.lines
         self.load_data_dict(rtf.topo_dict, rtf.rtf_version)
 
@@ -914,10 +1692,12 @@ class CGENFFTopologySet:
         self._raw_data_strings = [] 
         self.entity_type = 'cgenff'
 
-    def load_rtf_block(self, rtf_block: str):
+    def load_rtf_block(self, rtf_block: str, rtf: RTFParser = None):
         """Load topology data from a dictionary. The dictionary should be parsed
-        from a RTF file."""
-        rtf = RTFParser(rtf_block=rtf_block)
+        from a RTF file. If the RTFParser of the block is provided (e.g. from 
+        the parameter cache), the block is not parsed again."""
+        if rtf is None:
+            rtf = RTFParser(rtf_block=rtf_block)
         self._raw_data_strings.extend(rtf.lines)
         if len(rtf.topo_dict) == 0:
             return False
@@ -951,9 +1731,13 @@ class CGENFFTopologySet:
 
 class CGENFFTopologyLoader:
     """Class for loading topology definition to the heterogen residues where 
-    the topology and parameters are generated by cgenff."""
-    def __init__(self, cgenff_path=None, save_path=None):
+    the topology and parameters are generated by cgenff. The parameters of
+    the ligands are merged into the 'cgenff' ParameterLoader of param_dict 
+    (the param_dict of the TopologyGenerator if provided), which is created 
+    with the CGenFF parameters on the first ligand."""
+    def __init__(self, cgenff_path=None, save_path=None, param_dict=None):
         self.cgenff_path = cgenff_path
+        self.param_dict = {} if param_dict is None else param_dict
         self.rdconvert = RDKitHetConverter()
         self.cgenff_topo_set = CGENFFTopologySet()
         self.toppar_blocks = {}
@@ -965,29 +1749,119 @@ class CGENFFTopologyLoader:
         self.rdkit_mols = {}
         if self.save_path is None:
             self.save_path = os.getcwd()
+        # CGenFF outputs {'toppar_block', 'rtf', 'params'} keyed by the ligand content
+        # key (see get_mol_content_key)
+        self._toppar_by_key = {}
+        # content key of the definition loaded for each ligand name
+        self._loaded_keys = {}
+        self._cgenff_id = None
+
+    def _get_cgenff_id(self):
+        """Return the identity of the CGenFF executable, which is part of the
+        cache keys, so that the output of another CGenFF version is never 
+        reused."""
+        if self._cgenff_id is None:
+            path = self.cgenff_path
+            if path is not None and os.path.isfile(path):
+                self._cgenff_id = f'{os.path.basename(path)}:{file_digest(path)}'
+            else:
+                self._cgenff_id = str(path)
+        return self._cgenff_id
 
-    ## TODO: parse parameters from the toppar block as well
-    def _get_cgenff_topology(self, input_mol2_block, resname, ligand_toppar_file=None):
-        """Load mol2 block and generate topology definition. """
+    def get_cache_key(self, rdkit_mol, resname):
+        """Return the parameter cache key of a ligand."""
+        return get_mol_content_key(rdkit_mol, resname, self._get_cgenff_id())
+
+    @staticmethod
+    def _split_toppar_block(toppar_block):
+        """Split the CGenFF output into the RTF and the PRM blocks."""
+        toppar_lines=toppar_block.split('\n')
+        rtf_end = toppar_lines.index('END')+1
+        rtf_block = '\n'.join(toppar_lines[:rtf_end])
+        prm_block = '\n'.join(toppar_lines[rtf_end:])
+        return rtf_block, prm_block
+
+    def _get_cached_toppar(self, key):
+        """Return the CGenFF output of a ligand key from memory or from the
+        shared cache, or None if the ligand has not been parameterized."""
+        if key in self._toppar_by_key:
+            return self._toppar_by_key[key]
+        data = load_ligand_toppar(key)
+        if data is not None:
+            self._toppar_by_key[key] = data
+        return data
+
+    def _store_toppar(self, key, toppar_block):
+        """Parse the RTF and PRM blocks of the CGenFF output and store them
+        in memory and (if the topology is valid) in the shared cache."""
+        rtf_block, prm_block = self._split_toppar_block(toppar_block)
+        rtf = RTFParser(rtf_block=rtf_block)
+        data = {
+            'toppar_block': toppar_block, 'rtf': rtf,
+            'params': parse_prm_block(prm_block)
+        }
+        self._toppar_by_key[key] = data
+        if len(rtf.topo_dict) > 0:
+            save_ligand_toppar(key, data)
+        return data
 
+    @property
+    def param_loader(self):
+        """The ParameterLoader with the CGenFF parameters and the parameters
+        of the loaded ligands, created on first use."""
+        if 'cgenff' not in self.param_dict:
+            self.param_dict['cgenff'] = ParameterLoader('cgenff')
+        return self.param_dict['cgenff']
+
+    def _merge_params(self, ligand_params):
+        """Merge the parsed PRM block of a ligand into the ParameterLoader.
+        The ligand parameters take precedence over the CGenFF parameters of
+        the same atom types."""
+        param_loader = self.param_loader
+        for param_type, params in ligand_params.items():
+            param_loader.param_dict.setdefault(param_type, {}).update(params)
+        param_loader.reset_index()
+
+    def _get_cgenff_topology(
+            self, input_mol2_block, resname, ligand_toppar_file=None, key=None
+        ):
+        """Load mol2 block and generate topology definition and parameters.
+        If the content key of the ligand is provided, the CGenFF output is 
+        taken from the parameter cache if available, and stored in it 
+        otherwise."""
+        rtf, ligand_params = None, None
         if ligand_toppar_file is not None:
             with open(ligand_toppar_file, 'r', encoding='utf-8') as f:
                 toppar_block = f.read()
+        elif key is not None:
+            data = self._get_cached_toppar(key)
+            if data is None:
+                data = self._store_toppar(
+                    key, excute_cgenff(self.cgenff_path, input_mol2_block)
+                )
+            toppar_block, rtf = data['toppar_block'], data['rtf']
+            ligand_params = data['params']
+            if self._loaded_keys.get(resname) == key:
+                # the same ligand is already defined
+                return toppar_block
         else:
             toppar_block = excute_cgenff(self.cgenff_path, input_mol2_block)
-        toppar_lines=toppar_block.split('\n')
-        rtf_end = toppar_lines.index('END')+1
 
-        rtf_block = '\n'.join(toppar_lines[:rtf_end])
-        prm_block = '\n'.join(toppar_lines[rtf_end:])
-        success = self.cgenff_topo_set.load_rtf_block(rtf_block)
+        rtf_block, prm_block = self._split_toppar_block(toppar_block)
+        success = self.cgenff_topo_set.load_rtf_block(rtf_block, rtf)
         if not success:
             raise ValueError(
                 f'Failed to generate parameters for ligand {resname}! '
                 'Either CGENFF fail to generate the topology (check the CGENFF log) ' 
                 'or the user supplied RTF file does not match the ligand supplied.'
             )
-        
+        if ligand_params is None:
+            ligand_params = parse_prm_block(prm_block)
+        self._merge_params(ligand_params)
+        if key is None:
+            self._loaded_keys.pop(resname, None)
+        else:
+            self._loaded_keys[resname] = key
         return toppar_block
 
     ## TODO: need to find topology element from rtf. Currently only add 
@@ -1003,22 +1877,74 @@ class CGENFFTopologyLoader:
         
         ligand_toppar_file: str, optional
             The path to the ligand topology file. If not provided, the topology
-            will be generated by cgenff.
+            will be taken from the ligand parameter cache, or generated by 
+            cgenff and stored in the cache.
+        """
+        rdk_mol, mol2_block = self._prepare_ligand(lig_res)
+        key = None
+        if ligand_toppar_file is None:
+            key = self.get_cache_key(rdk_mol, lig_res.resname)
+        toppar_block = self._get_cgenff_topology(
+            mol2_block, lig_res.resname, ligand_toppar_file, key
+        )
+        self.toppar_blocks[lig_res.resname] = toppar_block
+        self._load_ligand_definition(lig_res)
+
+    def generate_multiple(self, lig_residues, n_workers=CGENFF_MAX_WORKERS):
+        """Generate topology definitions for a list of ligand residues. The 
+        ligands are looked up in the parameter cache by their content, each 
+        distinct ligand missing from the cache is parameterized once, and the 
+        CGenFF runs are done concurrently by up to n_workers subprocesses.
+        
+        Parameters
+        ----------
+        
+        lig_residues: list of Heterogen
+            The ligand residue objects.
+        
+        n_workers: int, optional
+            The maximum number of concurrent CGenFF subprocesses.
         """
+        jobs = []
+        missing = {}
+        for lig_res in lig_residues:
+            rdk_mol, mol2_block = self._prepare_ligand(lig_res)
+            key = self.get_cache_key(rdk_mol, lig_res.resname)
+            jobs.append((lig_res, mol2_block, key))
+            if key not in missing and self._get_cached_toppar(key) is None:
+                missing[key] = mol2_block
+        if missing:
+            n_workers = max(1, min(n_workers, len(missing)))
+            with ThreadPoolExecutor(max_workers=n_workers) as executor:
+                futures = {
+                    key: executor.submit(
+                        excute_cgenff, self.cgenff_path, mol2_block
+                    )
+                    for key, mol2_block in missing.items()
+                }
+                for key, future in futures.items():
+                    self._store_toppar(key, future.result())
+        for lig_res, mol2_block, key in jobs:
+            self.toppar_blocks[lig_res.resname] = self._get_cgenff_topology(
+                mol2_block, lig_res.resname, key=key
+            )
+            self._load_ligand_definition(lig_res)
+
+    def _prepare_ligand(self, lig_res: Heterogen):
+        """Convert the ligand residue to an RDKit mol and a mol2 block."""
         rdk_mol = lig_res.rdkit_mol
         if rdk_mol is None:
             self.rdconvert.load_heterogen(lig_res)
             rdk_mol = self.rdconvert.get_mol()
             lig_res._rdkit_mol = rdk_mol
-            mol2_block = self.rdconvert.get_mol2_block()
 
         self.rdkit_mols[lig_res.resname] = rdk_mol
         mol2_block = MolToMol2Block(rdk_mol, ligname = lig_res.resname)
         self.mol2_blocks[lig_res.resname] = mol2_block
-        toppar_block = self._get_cgenff_topology(
-            mol2_block, lig_res.resname, ligand_toppar_file
-        )
-        self.toppar_blocks[lig_res.resname] = toppar_block
+        return rdk_mol, mol2_block
+
+    def _load_ligand_definition(self, lig_res: Heterogen):
+        """Load the generated residue definition into the ligand residue."""
         residue_definition = self.cgenff_topo_set.res_defs[lig_res.resname]
         for atom_def in residue_definition:
             atom_def_name = atom_def.name
@@ -1045,8 +1971,11 @@ class CGENFFTopologyLoader:
         ligand = self.rdconvert.get_ligand()
         mol2_block = self.rdconvert.get_mol2_block()
         self.mol2_blocks[resname] = mol2_block
+        key = None
+        if ligand_toppar_file is None:
+            key = self.get_cache_key(rdkit_mol, resname)
         toppar_block = self._get_cgenff_topology(
-            mol2_block, resname, ligand_toppar_file
+            mol2_block, resname, ligand_toppar_file, key
         )
         self.toppar_blocks[resname] = toppar_block
         residue_definition = self.cgenff_topo_set.res_defs[resname]
@@ -1121,8 +2050,11 @@ class TopologyGenerator:
         self.cur_param: ParameterLoader = None
         if cgenff_excutable_path is not None:
             self.save_cgenff_output = (cgenff_output_path is not None)
+            # the ligand parameters are merged into param_dict['cgenff']
             self.cgenff_loader = CGENFFTopologyLoader(
-                cgenff_excutable_path, cgenff_output_path)
+                cgenff_excutable_path, cgenff_output_path,
+                param_dict=self.param_dict
+            )
             self.res_def_dict['cgenff'] = self.cgenff_loader.cgenff_topo_set
         else:
             self.save_cgenff_output = False
@@ -1297,6 +2229,8 @@ class TopologyGenerator:
 
     def generate_solvent(self, solvent, solvent_model, QUIET=False):
         """Generate topology elements for solvent molecules"""
+        if isinstance(solvent, BulkSolvent) and solvent.is_array_backed:
+            return self._generate_bulk_solvent(solvent, solvent_model, QUIET)
         solvent.undefined_res = []
         self._load_residue_definitions('Solvent', preserve=False)
         if solvent_model not in self.cur_defs:
@@ -1321,6 +2255,27 @@ class TopologyGenerator:
         self.cur_param.apply(solvent.topology)
         return topology
 
+    def _generate_bulk_solvent(self, solvent: BulkSolvent, solvent_model, QUIET=False):
+        """Generate topology for the template residue of a BulkSolvent chain
+        and repeat it implicitly over all molecules in the chain. The template
+        is generated in a throwaway Solvent chain, and its parent is restored
+        afterwards."""
+        template = solvent.template
+        template_parent = template.parent
+        template_chain = Solvent(solvent.id)
+        template_chain.add(template)
+        try:
+            template_topology = self.generate_solvent(
+                template_chain, solvent_model, QUIET=QUIET
+            )
+        finally:
+            template.set_parent(template_parent)
+        # the template is either defined or all molecules are undefined
+        solvent.undefined_res = template_chain.undefined_res
+        topology = BulkSolventTopology(template_topology)
+        solvent.topology = topology.load_chain(solvent)
+        return topology
+
     def generate(
             self, chain: Chain, coerce: bool = False,
             first_patch: str = None, last_patch: str = None,
@@ -1401,7 +2356,15 @@ class TopologyGenerator:
             self.patch_residue(
                 chain.child_list[-1], last, patch_loc="CTER", QUIET=QUIET
             )
-        if chain.topology is not None:
+        if isinstance(chain.topology, ChainTopology):
+            # Update the topology elements of the patched residues only
+            patched_residues = []
+            if first is not None:
+                patched_residues.append(chain.child_list[0])
+            if last is not None:
+                patched_residues.append(chain.child_list[-1])
+            chain.topology.update_residues(patched_residues, self.cur_param)
+        elif chain.topology is not None:
             # Update topology elements if they are already defined
             chain.topology.update()
 
@@ -1448,6 +2411,73 @@ class TopologyGenerator:
         fixer.load_residue(residue)
         fixer.remove_undefined_atoms()
     
+    def update_residues(
+            self, residues, coerce: bool = False, build_coords = True,
+            preserve_ic = True, QUIET = False
+        ):
+        """Update the topology of modified residues (e.g. point mutations, 
+        where the residue name is changed and the side chain atoms are 
+        removed) in chains with generated topology, without regenerating the
+        whole chain. The residue definitions are loaded again, the missing 
+        atoms are built, and the topology elements and parameters are only 
+        updated for the residues and their sequence neighbors. The 
+        ModelTopology is updated as well if the chains are in a model with 
+        topology. Patches (e.g. terminal patches) on the residues are not 
+        kept, and need to be applied again with patch_residue.
+        Argument:
+            residues: the modified residues
+            coerce: if True, try to coerce the modified residue name to the canonical name
+            build_coords: if True, build the coordinates of the missing atoms
+            preserve_ic: if True, preserve the internal coordinates of the residue
+            QUIET: if True, suppress all warnings
+        Return:
+            the dict of new topology elements by topology type for each chain id
+        """
+        chain_residues = {}
+        for residue in residues:
+            chain = residue.parent
+            if chain is None or not isinstance(chain.topology, ChainTopology):
+                raise ValueError(
+                    f'Residue {residue} is not in a chain with generated topology!'
+                    ' Use generate() or generate_model() first.'
+                )
+            chain_residues.setdefault(id(chain), (chain, []))[1].append(residue)
+
+        # the parameters of each chain type (e.g. protein and nucleic acid)
+        chain_param_loaders = {}
+        for chain, chain_res_list in chain_residues.values():
+            self._load_residue_definitions(chain.chain_type, preserve_ic)
+            chain_param_loaders[id(chain)] = self.cur_param
+            for residue in chain_res_list:
+                if not self._generate_residue_topology(
+                    residue, coerce=coerce, QUIET=True
+                ):
+                    raise ValueError(
+                        f'Residue {residue} is not defined in the topology file!'
+                    )
+                if residue in chain.undefined_res:
+                    chain.undefined_res.remove(residue)
+            self.cur_param.fill_ic(self.cur_defs, preserve_ic)
+            if build_coords:
+                # heavy atoms are built in chain order
+                fix_residues(sorted(chain_res_list, key=lambda res: res.id[1:]))
+
+        model = next(iter(chain_residues.values()))[0].parent
+        model_topology = getattr(model, 'topology', None)
+        if isinstance(model_topology, ModelTopology) and all(
+            chain.parent is model for chain, _ in chain_residues.values()
+        ):
+            return model_topology.update_residues(residues, {
+                chain.id: chain_param_loaders[id(chain)]
+                for chain, _ in chain_residues.values()
+            })
+        new_elements = {}
+        for chain, chain_res_list in chain_residues.values():
+            new_elements[chain.id] = chain.topology.update_residues(
+                chain_res_list, chain_param_loaders[id(chain)]
+            )
+        return new_elements
+
     def generate_model(
             self, model: OrganizedModel, coerce: bool = False,
             prot_first_patch: str = 'ACE', prot_last_patch: str = 'CT3',
@@ -1513,9 +2543,13 @@ class TopologyGenerator:
             self.generate_solvent(chain, solvent_model, QUIET=QUIET)
 
         if self.cgenff_loader is not None:
-            for chain in model.ligand+model.co_solvent+model.phos_ligand:
-                for lig_residue in chain:
-                    self.cgenff_loader.generate(lig_residue)
+            # ligands are looked up in the parameter cache, and the missing
+            # ones are parameterized concurrently
+            self.cgenff_loader.generate_multiple([
+                lig_residue
+                for chain in model.ligand+model.co_solvent+model.phos_ligand
+                for lig_residue in chain
+            ])
             if self.save_cgenff_output:
                 self.cgenff_loader.write_all()
         model.topology_loader = self
@@ -1669,6 +2703,7 @@ class ResiduePatcher:
         self.res.assign_donor_acceptor()
         self.res.create_atom_lookup_dict()
         self.res.patch_with = self.patch.resname
+        self.res.create_topology_template()
         return self.res
     
     def patch_disulfide(
@@ -1700,6 +2735,7 @@ class ResiduePatcher:
         self._remove_atom_from_cmap(self.res.cmap, remove_name)
         self.res.assign_donor_acceptor()
         self.res.create_atom_lookup_dict()
+        self.res.create_topology_template()
         self.res.patch_with = 'DISU'
         sulfur_def = self.res['SG']
         sulfur_def.atom_type = 'SM'
@@ -0,0 +1,367 @@
+"""Batch preparation pipeline for simulation systems from PDB entries.
+
+Every entry goes through the steps of the single structure workflow
+(fetch_rcsb -> TopologyGenerator -> PropKaProtonator -> Solvator -> PSF/CRD
+writers). The stages run concurrently and are connected by bounded queues:
+entries are fetched by a pool of I/O threads while the previous entries are
+prepared, and the prepared models are written by a separate writer thread.
+The topology definitions and parameters are loaded once per pipeline and
+shared by all entries. They are only used by the preparing thread, which also
+collects the parameters of the snapshot output before handing the model to
+the writer. With `run_parallel`, the entries are split into
+chunks over long-lived worker processes, each with its own pipeline.
+
+The outcome of each entry is checkpointed in `<output_dir>/<pdb_id>/` once
+its files are written, so an interrupted run resumes with the entries that
+are not done yet.
+"""
+import os
+import json
+import time
+import queue
+import tempfile
+import threading
+import traceback
+import warnings
+from concurrent.futures import ProcessPoolExecutor
+from crimm.Fetchers import fetch_rcsb
+
+CHECKPOINT_FILE = 'checkpoint.json'
+# Number of entries held between two stages
+PIPELINE_QUEUE_SIZE = 4
+# Number of threads downloading and parsing entries
+PIPELINE_FETCH_THREADS = 4
+# Number of entries sent to a worker process at a time by run_parallel
+PIPELINE_CHUNK_SIZE = 16
+OUTPUT_FORMATS = ('psf', 'crd', 'snapshot')
+OUTPUT_EXTENSIONS = {'psf': 'psf', 'crd': 'crd', 'snapshot': 'snap'}
+# end of stage marker in the queues
+_STOP = object()
+
+class BatchPreparationPipeline:
+    """Prepare simulation systems for a batch of PDB entries.
+
+    Parameters
+    ----------
+    output_dir : str
+        Directory of the output files. Each entry gets a subdirectory named
+        by its PDB ID with the output files and the checkpoint.
+    local_entry, mirror_dir : str, optional
+        Local mmCIF archive and download mirror (see fetch_rcsb)
+    fetch_kwargs : dict, optional
+        Additional arguments of fetch_rcsb. The entries are always fetched as
+        organized models.
+    topology_kwargs : dict, optional
+        Additional arguments of TopologyGenerator.generate_model
+    pH : float or None, default 7.0
+        The pH for the protonation states by PropKa. None to skip protonation.
+    solvate : bool, default True
+        Solvate the model with Solvator.solvate
+    solvate_kwargs : dict, optional
+        Arguments of Solvator.solvate
+    add_ions : bool, default True
+        Add ions with Solvator.add_ions. Only used if the model is solvated.
+    ion_kwargs : dict, optional
+        Arguments of Solvator.add_ions
+    output_formats : tuple of str, default ('psf', 'crd')
+        Output files to write, any of 'psf', 'crd' and 'snapshot'
+    cgenff_path : str, optional
+        Path of the cgenff executable for the ligand topology
+    n_fetch_threads : int, default PIPELINE_FETCH_THREADS
+        Number of threads fetching the entries
+    queue_size : int, default PIPELINE_QUEUE_SIZE
+        Maximum number of entries waiting between two stages
+    """
+    def __init__(
+            self, output_dir, local_entry=None, mirror_dir=None,
+            fetch_kwargs=None, topology_kwargs=None, pH=7.0,
+            solvate=True, solvate_kwargs=None, add_ions=True, ion_kwargs=None,
+            output_formats=('psf', 'crd'), cgenff_path=None,
+            n_fetch_threads=PIPELINE_FETCH_THREADS,
+            queue_size=PIPELINE_QUEUE_SIZE
+        ):
+        for output_format in output_formats:
+            if output_format not in OUTPUT_FORMATS:
+                raise ValueError(
+                    f'Unsupported output format {output_format}! Expected any '
+                    f'of {OUTPUT_FORMATS}'
+                )
+        # the arguments recreate the pipeline in a worker process
+        self._config = {
+            'output_dir': output_dir, 'local_entry': local_entry,
+            'mirror_dir': mirror_dir, 'fetch_kwargs': fetch_kwargs,
+            'topology_kwargs': topology_kwargs, 'pH': pH,
+            'solvate': solvate, 'solvate_kwargs': solvate_kwargs,
+            'add_ions': add_ions, 'ion_kwargs': ion_kwargs,
+            'output_formats': output_formats, 'cgenff_path': cgenff_path,
+            'n_fetch_threads': n_fetch_threads, 'queue_size': queue_size,
+        }
+        self.output_dir = output_dir
+        self.local_entry = local_entry
+        self.mirror_dir = mirror_dir
+        self.fetch_kwargs = dict(fetch_kwargs or {})
+        self.fetch_kwargs['organize'] = True
+        self.topology_kwargs = dict(topology_kwargs or {})
+        self.pH = pH
+        self.solvate = solvate
+        self.solvate_kwargs = dict(solvate_kwargs or {})
+        self.add_ions = add_ions
+        self.ion_kwargs = dict(ion_kwargs or {})
+        self.output_formats = tuple(output_formats)
+        self.cgenff_path = cgenff_path
+        self.n_fetch_threads = max(1, n_fetch_threads)
+        self.queue_size = max(1, queue_size)
+        self._topo = None
+
+    def __repr__(self):
+        return (
+            f'<BatchPreparationPipeline output_dir={self.output_dir} '
+            f'outputs={self.output_formats}>'
+        )
+
+    @property
+    def topology_generator(self):
+        """The TopologyGenerator shared by all entries, created on first use."""
+        if self._topo is None:
+            from crimm.Modeller.TopoLoader import TopologyGenerator
+            self._topo = TopologyGenerator(cgenff_excutable_path=self.cgenff_path)
+        return self._topo
+
+    def get_entry_dir(self, pdb_id):
+        """Return the output directory of an entry."""
+        return os.path.join(self.output_dir, pdb_id.upper())
+
+    def get_checkpoint(self, pdb_id):
+        """Return the checkpoint record of an entry, or None if the entry has
+        not been processed."""
+        checkpoint_path = os.path.join(self.get_entry_dir(pdb_id), CHECKPOINT_FILE)
+        try:
+            with open(checkpoint_path, 'r', encoding='utf-8') as f:
+                return json.load(f)
+        except FileNotFoundError:
+            return None
+        except (OSError, ValueError) as e:
+            warnings.warn(f'Failed to read checkpoint {checkpoint_path}: {e}')
+            return None
+
+    def is_done(self, pdb_id):
+        """Return if the entry has been prepared and all outputs exist."""
+        record = self.get_checkpoint(pdb_id)
+        if record is None or record['status'] != 'done':
+            return False
+        return all(os.path.exists(path) for path in record['outputs'])
+
+    def _write_checkpoint(self, record):
+        entry_dir = self.get_entry_dir(record['pdb_id'])
+        os.makedirs(entry_dir, exist_ok=True)
+        fd, tmp_path = tempfile.mkstemp(dir=entry_dir, suffix='.tmp')
+        try:
+            with os.fdopen(fd, 'w', encoding='utf-8') as f:
+                json.dump(record, f, indent=2)
+            os.replace(tmp_path, os.path.join(entry_dir, CHECKPOINT_FILE))
+        except BaseException:
+            os.unlink(tmp_path)
+            raise
+
+    def fetch(self, pdb_id):
+        """Fetch an entry as an organized model."""
+        return fetch_rcsb(
+            pdb_id, local_entry=self.local_entry, mirror_dir=self.mirror_dir,
+            **self.fetch_kwargs
+        )
+
+    def prepare(self, model):
+        """Generate the topology, protonate, solvate and add ions to the
+        model in place, as configured."""
+        topo = self.topology_generator
+        topo.generate_model(model, **self.topology_kwargs)
+        if self.pH is not None:
+            from crimm.Adaptors.PropKaAdaptors import PropKaProtonator
+            protonator = PropKaProtonator(topo, pH=self.pH)
+            protonator.load_model(model)
+            protonator.apply_patches()
+        if self.solvate:
+            from crimm.Modeller.Solvator import Solvator
+            solvator = Solvator(model)
+            solvator.solvate(**self.solvate_kwargs)
+            if self.add_ions:
+                solvator.add_ions(**self.ion_kwargs)
+        return model
+
+    def collect(self, model):
+        """Collect the contents of the outputs that read the shared
+        topology generator (the parameters of the snapshot), so that the
+        writer does not read it while the next entry is prepared. Return the
+        dict of collected contents by output format."""
+        contents = {}
+        if 'snapshot' in self.output_formats:
+            from crimm.IO.Snapshot import collect_snapshot
+            contents['snapshot'] = collect_snapshot(model)
+        return contents
+
+    def write(self, pdb_id, model, contents=None):
+        """Write the output files of a prepared model, with the contents
+        collected by `collect` if provided. Return the list of file paths."""
+        entry_dir = self.get_entry_dir(pdb_id)
+        os.makedirs(entry_dir, exist_ok=True)
+        outputs = []
+        for output_format in self.output_formats:
+            path = os.path.join(
+                entry_dir, f'{pdb_id.upper()}.{OUTPUT_EXTENSIONS[output_format]}'
+            )
+            if output_format == 'psf':
+                from crimm.IO.PSFWriter import write_psf
+                write_psf(model, path)
+            elif output_format == 'crd':
+                from crimm.IO.CRDWriter import write_crd
+                write_crd(model, path)
+            elif contents is not None and 'snapshot' in contents:
+                contents['snapshot'].write(path)
+            else:
+                from crimm.IO.Snapshot import write_snapshot
+                write_snapshot(model, path)
+            outputs.append(path)
+        return outputs
+
+    @staticmethod
+    def _failure(pdb_id, stage, error, timings):
+        return {
+            'pdb_id': pdb_id, 'status': 'failed', 'stage': stage,
+            'error': f'{type(error).__name__}: {error}',
+            'traceback': traceback.format_exception(
+                type(error), error, error.__traceback__
+            ),
+            'outputs': [], 'timings': timings,
+        }
+
+    def _fetch_stage(self, id_queue, fetched_queue):
+        while True:
+            try:
+                pdb_id = id_queue.get_nowait()
+            except queue.Empty:
+                break
+            start = time.perf_counter()
+            try:
+                item = (pdb_id, self.fetch(pdb_id), None)
+            except Exception as e:
+                item = (pdb_id, None, e)
+            fetched_queue.put(item + ({'fetch': time.perf_counter()-start},))
+        fetched_queue.put(_STOP)
+
+    def _write_stage(self, prepared_queue, records):
+        while (item := prepared_queue.get()) is not _STOP:
+            pdb_id, model, contents, record, timings = item
+            if record is None:
+                start = time.perf_counter()
+                try:
+                    outputs = self.write(pdb_id, model, contents)
+                    timings['write'] = time.perf_counter()-start
+                    record = {
+                        'pdb_id': pdb_id, 'status': 'done', 'stage': 'write',
+                        'error': None, 'outputs': outputs, 'timings': timings,
+                    }
+                except Exception as e:
+                    record = self._failure(pdb_id, 'write', e, timings)
+            try:
+                self._write_checkpoint(record)
+            except OSError as e:
+                warnings.warn(f'Failed to write checkpoint of {pdb_id}: {e}')
+            records.append(record)
+
+    def run(self, pdb_ids, resume=True):
+        """Prepare the entries in the pipeline of this process. The entries
+        are fetched by the fetch threads, prepared in the calling thread and
+        written by the writer thread. If resume, entries that are done are
+        skipped. Return the list of checkpoint records of the processed
+        entries in the order of completion."""
+        id_queue = queue.Queue()
+        for pdb_id in dict.fromkeys(pdb_ids):
+            if not (resume and self.is_done(pdb_id)):
+                id_queue.put(pdb_id)
+        if id_queue.empty():
+            return []
+        fetched_queue = queue.Queue(maxsize=self.queue_size)
+        prepared_queue = queue.Queue(maxsize=self.queue_size)
+        records = []
+        n_fetch_threads = min(self.n_fetch_threads, id_queue.qsize())
+        fetch_threads = [
+            threading.Thread(
+                target=self._fetch_stage, args=(id_queue, fetched_queue),
+                daemon=True
+            ) for _ in range(n_fetch_threads)
+        ]
+        writer_thread = threading.Thread(
+            target=self._write_stage, args=(prepared_queue, records),
+            daemon=True
+        )
+        for thread in fetch_threads:
+            thread.start()
+        writer_thread.start()
+
+        n_stopped = 0
+        while n_stopped < n_fetch_threads:
+            item = fetched_queue.get()
+            if item is _STOP:
+                n_stopped += 1
+                continue
+            pdb_id, model, error, timings = item
+            record, contents = None, None
+            if error is not None:
+                record = self._failure(pdb_id, 'fetch', error, timings)
+            else:
+                start = time.perf_counter()
+                try:
+                    self.prepare(model)
+                    timings['prepare'] = time.perf_counter()-start
+                except Exception as e:
+                    record = self._failure(pdb_id, 'prepare', e, timings)
+            if record is None:
+                # the shared topology generator is only read in this thread
+                start = time.perf_counter()
+                try:
+                    contents = self.collect(model)
+                    timings['collect'] = time.perf_counter()-start
+                except Exception as e:
+                    record = self._failure(pdb_id, 'collect', e, timings)
+            prepared_queue.put((pdb_id, model, contents, record, timings))
+        prepared_queue.put(_STOP)
+        writer_thread.join()
+        return records
+
+    def run_parallel(
+            self, pdb_ids, n_processes=None, resume=True,
+            chunk_size=PIPELINE_CHUNK_SIZE
+        ):
+        """Prepare the entries over n_processes long-lived worker processes
+        (default os.cpu_count()). Each worker loads the topology definitions
+        and parameters once and runs the pipeline on chunks of chunk_size
+        entries. Return the list of checkpoint records."""
+        pdb_ids = [
+            pdb_id for pdb_id in dict.fromkeys(pdb_ids)
+            if not (resume and self.is_done(pdb_id))
+        ]
+        chunks = [
+            pdb_ids[st:st+chunk_size] for st in range(0, len(pdb_ids), chunk_size)
+        ]
+        records = []
+        if not chunks:
+            return records
+        with ProcessPoolExecutor(
+            max_workers=n_processes, initializer=_init_worker,
+            initargs=(self._config,)
+        ) as executor:
+            for chunk_records in executor.map(
+                _run_worker_chunk, chunks, [resume]*len(chunks)
+            ):
+                records.extend(chunk_records)
+        return records
+
+# pipeline of the worker process, kept between chunks
+_worker_pipeline = None
+
+def _init_worker(config):
+    global _worker_pipeline
+    _worker_pipeline = BatchPreparationPipeline(**config)
+
+def _run_worker_chunk(pdb_ids, resume):
+    return _worker_pipeline.run(pdb_ids, resume=resume)
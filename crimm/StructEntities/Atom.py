@@ -31,7 +31,15 @@ class Atom(_Atom):
         Atom radius.
     topo_definition: TopoAtom, optional
         Topology definition for the atom.
+
+    If the atom is in a CoordinateStore (Model.attach_coord_store), coord is
+    a view into the row of the store, and assigning to coord writes into the
+    store in place.
     """
+    # CoordinateStore holding the atom coordinates and the row of the atom
+    _coord_store = None
+    _coord_index = None
+
     def __init__(
         self,
         name,
@@ -98,14 +106,52 @@ class Atom(_Atom):
             return f"<MissingAtom {self.get_id()}>"
         return f"<Atom {self.get_id()}>"
 
+    @property
+    def coord(self):
+        """Atom coordinates as numpy array [x, y, z]"""
+        return self._coord
+
+    @coord.setter
+    def coord(self, value):
+        if self._coord_store is None:
+            self._coord = value
+        elif value is None:
+            # an atom without coordinates can not stay in the store
+            self._coord_store = None
+            self._coord_index = None
+            self._coord = None
+        else:
+            self._coord[:] = value
+
+    def _bind_coord_store(self, store, index):
+        """Make the coordinates a view into the row of the CoordinateStore."""
+        self._coord_store = store
+        self._coord_index = index
+        self._coord = store.coords[index]
+
+    def _unbind_coord_store(self):
+        """Release the atom from the CoordinateStore with a copy of the
+        current coordinates."""
+        self._coord_store = None
+        self._coord_index = None
+        self._coord = self._coord.copy()
+
     def __getstate__(self):
         """Return state of the atom object for pickling, excluding neighbors 
-        to avoid infinite recursion errors"""
+        to avoid infinite recursion errors. Atoms in a CoordinateStore are 
+        pickled (and deep-copied) with their own copy of the coordinates."""
         state = {k: v for k, v in self.__dict__.items() if k != "neighbors"}
+        if state.get('_coord_store') is not None:
+            state['_coord_store'] = None
+            state['_coord_index'] = None
+            state['_coord'] = self._coord.copy()
         return state
 
     def __setstate__(self, state):
         """Set state of the atom object for pickling"""
+        if 'coord' in state:
+            # pickled before coord became a property
+            state['_coord'] = state.pop('coord')
         self.__dict__.update(state)
 
     def reset_atom_serial_numbers(self):
@@ -135,6 +181,9 @@ class Atom(_Atom):
         # Do a shallow copy then explicitly copy what needs to be deeper.
         shallow = copy(self)
         shallow.detach_parent()
+        # the copy does not share the coordinate store row
+        shallow._coord_store = None
+        shallow._coord_index = None
         shallow.set_coord(copy(self.get_coord()))
         shallow.xtra = self.xtra.copy()
         shallow.neighbors = set()
@@ -1,12 +1,13 @@
 import warnings
 from typing import List, Tuple, Dict
+import numpy as np
 from Bio.Seq import Seq
 from Bio.PDB import PPBuilder
 from Bio.Data.PDBData import protein_letters_3to1_extended
 from Bio.Data.PDBData import nucleic_letters_3to1_extended
 from Bio.PDB.Chain import Chain as _Chain
 from Bio.PDB.PDBExceptions import PDBConstructionException
-from crimm.StructEntities.Residue import DisorderedResidue
+from crimm.StructEntities.Residue import Residue, DisorderedResidue
 
 class BaseChain(_Chain):
     """Base class derived from and Biopython chain object and compatible with
@@ -26,6 +27,24 @@ class BaseChain(_Chain):
         """Alias for child_list. Returns the list of residues in this chain."""
         return self.child_list
 
+    def _release_coord_store(self):
+        """Detach the coordinate store of the model containing the chain (if
+        attached), since it no longer matches the atoms. (Private method)"""
+        if getattr(self.parent, '_coord_store', None) is not None:
+            self.parent.detach_coord_store()
+
+    def add(self, residue):
+        """Add a residue to the chain. The coordinate store of the model (if
+        attached) is detached, since it no longer covers all atoms."""
+        self._release_coord_store()
+        super().add(residue)
+
+    def detach_child(self, id):
+        """Remove a residue from the chain. The coordinate store of the model
+        (if attached) is detached, since it no longer matches the atoms."""
+        self._release_coord_store()
+        super().detach_child(id)
+
     @property
     def total_charge(self):
         """Return the total charge of the chain."""
@@ -192,6 +211,7 @@ class Chain(BaseChain):
 
     def add(self, residue):
         """Add a child to the Entity. Overwrite the Biopython Chain.add method"""
+        self._release_coord_store()
         entity_id = residue.get_id()
         hetflag, resseq, icode = entity_id
         if self.has_id(entity_id):
@@ -482,7 +502,232 @@ class Oligosaccharide(BaseChain):
 class Solvent(BaseChain):
     chain_type = 'Solvent'
     # The source of the solvent, e.g. PDB (crystallographic) or generated (modeled).
-    source = None 
+    source = None
+
+class BulkSolvent(Solvent):
+    """A solvent chain of identical molecules (e.g. a generated TIP3 water box)
+    stored as contiguous arrays instead of per-molecule Residue and Atom objects.
+
+    Every molecule is a copy of the template residue: the coordinates are kept
+    as one (n_residues, n_atoms_per_residue, 3) array and the residue sequence
+    numbers as an integer array. Residue and Atom objects are only created when
+    the chain is iterated or indexed like a regular chain (materialization);
+    the PSF, CRD and PDB writers read unmaterialized chains directly from the
+    arrays. Once materialized, the Residue objects are authoritative and the
+    chain behaves like a regular Solvent chain.
+
+    init args:
+    chain_id: str
+        Chain identifier.
+    template: Residue
+        The residue every molecule is a copy of. Its atom order defines the
+        per-molecule atom order of the coordinate array.
+    coords: numpy.ndarray
+        (n_residues, n_atoms_per_residue, 3) array of coordinates.
+    resseqs: numpy.ndarray, optional
+        Residue sequence numbers. Default to 1..n_residues.
+    """
+    def __init__(self, chain_id, template, coords, resseqs=None):
+        self._is_materialized = False
+        super().__init__(chain_id)
+        self.template = template
+        self.atom_names = tuple(atom.name for atom in template.get_atoms())
+        coords = np.asarray(coords)
+        if coords.ndim != 3 or coords.shape[1:] != (len(self.atom_names), 3):
+            raise ValueError(
+                f'Invalid coords shape {coords.shape} for template residue '
+                f'{template.resname} with {len(self.atom_names)} atoms! '
+                f'Expected (n_residues, {len(self.atom_names)}, 3).'
+            )
+        if resseqs is None:
+            resseqs = np.arange(1, len(coords)+1)
+        resseqs = np.asarray(resseqs, dtype=int)
+        if resseqs.shape != (len(coords),):
+            raise ValueError(
+                f'Number of resseqs {resseqs.shape} does not match the number '
+                f'of residues {len(coords)}!'
+            )
+        self._coords = coords
+        self._resseqs = resseqs
+        self.segid = template.segid
+        # serial number of the first atom, set by reset_atom_serial_numbers
+        self.serial_start = None
+
+    @property
+    def child_list(self):
+        """List of residues. Accessing it materializes the chain."""
+        self.materialize()
+        return self._child_list
+
+    @child_list.setter
+    def child_list(self, value):
+        self._child_list = value
+
+    @property
+    def child_dict(self):
+        """Dict of residues by id. Accessing it materializes the chain."""
+        self.materialize()
+        return self._child_dict
+
+    @child_dict.setter
+    def child_dict(self, value):
+        self._child_dict = value
+
+    @property
+    def is_materialized(self):
+        """True if Residue and Atom objects have been created for the chain."""
+        return self._is_materialized
+
+    @property
+    def is_array_backed(self):
+        """True if the arrays are still the authoritative data of the chain."""
+        return not self._is_materialized
+
+    @property
+    def n_atoms_per_residue(self):
+        """Number of atoms in each solvent molecule."""
+        return len(self.atom_names)
+
+    @property
+    def n_atoms(self):
+        """Total number of atoms in the chain."""
+        return len(self) * self.n_atoms_per_residue
+
+    @property
+    def coords(self):
+        """(n_residues, n_atoms_per_residue, 3) array of coordinates."""
+        if not self._is_materialized:
+            return self._coords
+        return np.array(
+            [[atom.coord for atom in res] for res in self._child_list]
+        ).reshape(-1, self.n_atoms_per_residue, 3)
+
+    @property
+    def resseqs(self):
+        """Array of residue sequence numbers."""
+        if not self._is_materialized:
+            return self._resseqs
+        return np.array([res.id[1] for res in self._child_list], dtype=int)
+
+    @property
+    def total_charge(self):
+        """Return the total charge of the chain."""
+        if self._is_materialized:
+            return super().total_charge
+        if (res_charge := self.template.total_charge) is None:
+            return None
+        return round(res_charge * len(self), 2)
+
+    def __len__(self):
+        if self._is_materialized:
+            return len(self._child_list)
+        return len(self._resseqs)
+
+    def get_atom_coords(self, atom_name):
+        """Return the (n_residues, 3) coordinates of one template atom in
+        every molecule."""
+        if atom_name not in self.atom_names:
+            raise KeyError(
+                f'Atom {atom_name} is not in the template residue '
+                f'{self.template.resname}!'
+            )
+        return self.coords[:, self.atom_names.index(atom_name)]
+
+    def tile_local_indices(self, local_indices, offset=0):
+        """Repeat per-molecule atom indices over all molecules in the chain.
+
+        local_indices is an (m, k) integer array of indices into the template
+        atoms (e.g. the bonds of one molecule). Returns an (n_residues*m, k)
+        array of chain atom indices, shifted by offset, in residue order."""
+        local_indices = np.asarray(local_indices, dtype=np.int64)
+        starts = np.arange(len(self)) * self.n_atoms_per_residue + offset
+        tiled = starts[:, None, None] + local_indices[None]
+        return tiled.reshape(-1, local_indices.shape[-1])
+
+    def remove_residues(self, indices):
+        """Remove the molecules at the given positions (0-indexed) in the chain."""
+        indices = np.asarray(indices, dtype=int)
+        if self._is_materialized:
+            for res in [self._child_list[i] for i in indices]:
+                self.detach_child(res.id)
+            return
+        self._release_coord_store()
+        self._coords = np.delete(self._coords, indices, axis=0)
+        self._resseqs = np.delete(self._resseqs, indices)
+
+    def _create_residue(self, i):
+        """Create the Residue object of the i-th molecule. The atom coordinates
+        are views into the coordinate array."""
+        template = self.template
+        residue = Residue(
+            (template.id[0], int(self._resseqs[i]), template.id[2]),
+            template.resname, self.segid
+        )
+        for j, template_atom in enumerate(template.get_atoms()):
+            atom = template_atom.copy()
+            atom.coord = self._coords[i, j]
+            if self.serial_start is not None:
+                atom.set_serial_number(
+                    self.serial_start + i*self.n_atoms_per_residue + j
+                )
+            residue.add(atom)
+        if template.topo_definition is not None:
+            for attr in (
+                'topo_definition', 'impropers', 'cmap', 'H_donors',
+                'H_acceptors', 'param_desc'
+            ):
+                setattr(residue, attr, getattr(template, attr))
+            residue.atom_groups = [
+                tuple(residue[atom.name] for atom in group)
+                for group in template.atom_groups
+            ]
+            residue.missing_atoms, residue.missing_hydrogens = {}, {}
+            residue.undefined_atoms = []
+        return residue
+
+    def materialize(self):
+        """Create the Residue and Atom objects for all molecules in the chain."""
+        if self._is_materialized:
+            return
+        self._is_materialized = True
+        for i in range(len(self._resseqs)):
+            residue = self._create_residue(i)
+            residue.set_parent(self)
+            self._child_list.append(residue)
+            self._child_dict[residue.id] = residue
+
+    def reset_atom_serial_numbers(
+            self, include_alt = True, reset_current_only = False
+        ):
+        """Reset all atom serial numbers in the encompassing entity starting
+        from 1. For an unmaterialized chain, only the serial number of the
+        first atom is stored."""
+        top_parent = self.get_top_parent()
+        if top_parent is not self and not reset_current_only:
+            top_parent.reset_atom_serial_numbers(include_alt=include_alt)
+            return
+        if self._is_materialized:
+            super().reset_atom_serial_numbers(
+                include_alt=include_alt, reset_current_only=True
+            )
+            return
+        self.serial_start = 1
+
+    def copy(self):
+        """Return a copy of the chain. An unmaterialized chain is copied
+        without creating any Residue or Atom objects."""
+        if self._is_materialized:
+            return super().copy()
+        shallow = BulkSolvent(
+            self.id, self.template.copy(), self._coords.copy(),
+            self._resseqs.copy()
+        )
+        shallow.segid = self.segid
+        shallow.pdbx_description = self.pdbx_description
+        shallow.source = self.source
+        shallow.serial_start = self.serial_start
+        shallow.xtra = self.xtra.copy()
+        return shallow
 
 class CoSolvent(Heterogens):
     chain_type = 'CoSolvent'
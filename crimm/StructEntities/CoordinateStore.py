@@ -0,0 +1,167 @@
+"""Contiguous coordinate store for the atoms of a model."""
+import numpy as np
+
+class CoordinateStore:
+    """Structure-of-arrays coordinate store of a model.
+
+    All atom coordinates of the model (including the alternate locations of
+    disordered atoms) are held in a single (N, 3) array `coords`, and the
+    `coord` attribute of every atom becomes a view into its row. Whole-model
+    operations (e.g. transformations or synchronization with CHARMM/OpenMM)
+    are then single array operations instead of per-atom attribute access.
+    The coordinates of unmaterialized array-backed solvent chains are moved
+    into the store as well, and the chain coordinate array becomes a view of
+    its rows.
+
+    The store is a snapshot of the model hierarchy. Adding or removing
+    chains, residues or atoms of the model detaches the store, and it needs to
+    be attached again (Model.attach_coord_store). Changes that bypass the
+    entity methods (e.g. editing child_list directly) are caught by is_stale,
+    which the model checks before handing out the store.
+
+    Parameters
+    ----------
+    model : Model
+        The model whose atom coordinates are moved into the store
+    """
+    def __init__(self, model):
+        self.model = model
+        self.atoms = []
+        # (start, stop) rows of each chain
+        self.chain_slices = {}
+        # row indices of the atoms from get_atoms(include_alt=False), i.e.
+        # the selected child of disordered atoms, in iteration order
+        primary_rows = []
+        # (start, stop) positions in primary_rows of each chain
+        self.primary_slices = {}
+        self.bulk_chains = []
+        atom_segments = []
+        coords = []
+        n_rows = 0
+        for chain in model:
+            start, primary_start = n_rows, len(primary_rows)
+            if getattr(chain, 'is_array_backed', False):
+                n_atoms = chain.n_atoms
+                self.bulk_chains.append((chain, n_rows))
+                coords.append(chain.coords.reshape(-1, 3))
+                primary_rows.extend(range(n_rows, n_rows+n_atoms))
+                n_rows += n_atoms
+            else:
+                # atoms without coordinates (missing atoms) are not stored
+                chain_atoms = [
+                    atom for atom in chain.get_atoms(include_alt=True)
+                    if atom.coord is not None
+                    and hasattr(atom, '_bind_coord_store')
+                ]
+                rows = {
+                    id(atom): n_rows+i for i, atom in enumerate(chain_atoms)
+                }
+                for atom in chain.get_atoms(include_alt=False):
+                    # disordered atom wrappers point to the selected altloc
+                    atom = getattr(atom, 'selected_child', atom)
+                    if (row := rows.get(id(atom))) is not None:
+                        primary_rows.append(row)
+                if chain_atoms:
+                    coords.append(
+                        np.array([atom.coord for atom in chain_atoms], dtype=float)
+                    )
+                self.atoms.extend(chain_atoms)
+                atom_segments.append((chain_atoms, n_rows))
+                n_rows += len(chain_atoms)
+            self.chain_slices[chain.id] = (start, n_rows)
+            self.primary_slices[chain.id] = (primary_start, len(primary_rows))
+
+        if coords:
+            self.coords = np.concatenate(coords).reshape(-1, 3)
+        else:
+            self.coords = np.zeros((0, 3))
+        self.primary_rows = np.asarray(primary_rows, dtype=np.int64)
+        self._atom_rows = None
+
+        for chain_atoms, start in atom_segments:
+            for i, atom in enumerate(chain_atoms):
+                atom._bind_coord_store(self, start+i)
+        for chain, start in self.bulk_chains:
+            chain._coords = self.coords[start:start+chain.n_atoms].reshape(
+                chain._coords.shape
+            )
+
+    def __len__(self):
+        return len(self.coords)
+
+    def __repr__(self):
+        return (
+            f'<CoordinateStore model={self.model} atoms={len(self.atoms)} '
+            f'rows={len(self)}>'
+        )
+
+    def is_stale(self):
+        """Return if the chains of the model no longer match the store, i.e.
+        chains were added, removed or renamed, or the number of molecules of 
+        an array-backed solvent chain changed. The check is O(n_chains)."""
+        chains = self.model.child_list
+        if len(chains) != len(self.chain_slices):
+            return True
+        if any(chain.id not in self.chain_slices for chain in chains):
+            return True
+        for chain, start in self.bulk_chains:
+            if not chain.is_array_backed:
+                continue
+            stop = self.chain_slices[chain.id][1]
+            if chain.n_atoms != stop - start or (
+                not np.shares_memory(chain._coords, self.coords)
+            ):
+                return True
+        return False
+
+    def _get_rows(self, include_alt, chain_id):
+        if chain_id is None:
+            if include_alt:
+                return slice(None)
+            return self.primary_rows
+        if include_alt:
+            start, stop = self.chain_slices[chain_id]
+            return slice(start, stop)
+        start, stop = self.primary_slices[chain_id]
+        return self.primary_rows[start:stop]
+
+    def get_coords(self, include_alt=False, chain_id=None):
+        """Return a copy of the coordinates in the same order as
+        get_coords(entity, include_alt) on the model (or the chain with
+        chain_id)."""
+        return self.coords[self._get_rows(include_alt, chain_id)].copy()
+
+    def set_coords(self, coords, include_alt=False, chain_id=None):
+        """Set the coordinates in the same order as get_coords."""
+        rows = self._get_rows(include_alt, chain_id)
+        self.coords[rows] = np.asarray(coords, dtype=float).reshape(-1, 3)
+
+    def transform(self, rot, tran):
+        """Apply rotation and translation to all the coordinates in the store,
+        as `coords @ rot + tran` (same convention as Atom.transform)."""
+        self.coords[:] = self.coords @ rot + tran
+
+    def get_rows(self, atoms):
+        """Return the row indices of the atoms in the store. Atoms not in the
+        store have the index -1."""
+        if self._atom_rows is None:
+            self._atom_rows = {
+                id(atom): atom._coord_index for atom in self.atoms
+            }
+        return np.fromiter(
+            (self._atom_rows.get(id(atom), -1) for atom in atoms),
+            dtype=np.int64, count=len(atoms)
+        )
+
+    def detach(self):
+        """Release the atoms and chains from the store. Each atom gets its own
+        copy of the current coordinates."""
+        for atom in self.atoms:
+            if atom._coord_store is self:
+                atom._unbind_coord_store()
+        for chain, _ in self.bulk_chains:
+            if chain.is_array_backed:
+                chain._coords = chain._coords.copy()
+        self.atoms = []
+        self.bulk_chains = []
+        self._atom_rows = None
@@ -1,7 +1,10 @@
 """Model class, used in Structure objects."""
 import warnings
+from copy import deepcopy
+import numpy as np
 from Bio.PDB.Model import Model as _Model
-from crimm.Utils.StructureUtils import index_to_letters
+from crimm.Utils.StructureUtils import index_to_letters, letters_to_index
+from crimm.StructEntities.CoordinateStore import CoordinateStore
 
 class Model(_Model):
     """The extended Model class representing a model in a structure.
@@ -17,6 +20,160 @@ class Model(_Model):
         self.pdbx_description = None
         self.connect_dict = {}
         self.connect_atoms = {}
+        self._coord_store = None
+        # (type, matrix, vector) dicts of the biological assembly operations
+        # that are not yet applied (see expand_assembly)
+        self.assembly_operations = None
+
+    def __getstate__(self):
+        """Return state of the model for pickling. The coordinate store is not
+        pickled (or deep-copied), the atoms carry their own coordinates."""
+        state = self.__dict__.copy()
+        state['_coord_store'] = None
+        return state
+
+    @property
+    def coord_store(self):
+        """The CoordinateStore of the model, or None if not attached. A store
+        that no longer matches the chains of the model is detached (with a
+        warning), and None is returned."""
+        store = getattr(self, '_coord_store', None)
+        if store is not None and store.is_stale():
+            warnings.warn(
+                f'The CoordinateStore of {self} no longer matches its chains '
+                'and is detached. Use attach_coord_store() to attach it again.'
+            )
+            self.detach_coord_store()
+            return None
+        return store
+
+    def attach_coord_store(self):
+        """Move all atom coordinates of the model into a contiguous
+        CoordinateStore, and make the coordinates of each atom a view into it.
+        Whole-model coordinate operations (get_coords, CoordManipulator, 
+        CHARMM and OpenMM coordinate sync) then work on the single array.
+        The store needs to be attached again after atoms are added to or 
+        removed from the model. Returns the store."""
+        self.detach_coord_store()
+        self._coord_store = CoordinateStore(self)
+        return self._coord_store
+
+    def detach_coord_store(self):
+        """Release the atoms from the CoordinateStore. Each atom keeps a copy 
+        of its current coordinates."""
+        if getattr(self, '_coord_store', None) is not None:
+            self._coord_store.detach()
+        self._coord_store = None
+
+    def add(self, entity):
+        """Add a chain to the model. The coordinate store (if attached) is
+        detached, since it no longer covers all atoms."""
+        self.detach_coord_store()
+        super().add(entity)
+
+    def detach_child(self, id):
+        """Remove a chain from the model. The coordinate store (if attached)
+        is detached, since it no longer matches the atoms."""
+        self.detach_coord_store()
+        super().detach_child(id)
+
+    @property
+    def has_pending_assembly(self):
+        """If the model holds the asymmetric unit and the assembly operations
+        that are not yet applied."""
+        return bool(getattr(self, 'assembly_operations', None))
+
+    @staticmethod
+    def _get_shared_templates(chain):
+        """Return the objects of a chain that are never modified in place
+        (sequences, reported residues, topology definitions), so that the
+        assembly copies can share them instead of deep-copying them."""
+        shared = []
+        for attr in (
+            '_ppb', 'known_seq', 'can_seq', 'reported_res',
+            'reported_missing_res', 'topo_definitions'
+        ):
+            if (value := getattr(chain, attr, None)) is not None:
+                shared.append(value)
+        for residue in chain:
+            if residue.topo_definition is not None:
+                shared.append(residue.topo_definition)
+            if (rdkit_mol := getattr(residue, '_rdkit_mol', None)) is not None:
+                shared.append(rdkit_mol)
+            for atom in residue.get_atoms():
+                if (atom_def := getattr(atom, '_topo_def', None)) is not None:
+                    shared.append(atom_def)
+        return shared
+
+    def expand_assembly(self):
+        """Apply the pending biological assembly operations. All chains in the
+        model are the asymmetric unit, and one copy of them is added per 
+        (non-identity) operation, with new chain ids following the last chain
+        id. The chains are copied once per operation, sharing the sequences and
+        topology definitions, and the coordinates of all copies are 
+        transformed in a single batched operation and written through a 
+        temporary CoordinateStore of the model, which is detached afterwards
+        (each atom keeps its own coordinates). The chain, residue and atom
+        objects are still deep-copied per chain and operation (only the
+        templates above are shared), so the object tree grows with the number
+        of operations as before; only the coordinate transform is batched. To
+        avoid the copies, keep the asymmetric unit with the pending operations
+        (expand_bio_assembly=False) until they are needed. Returns the list of
+        added chains."""
+        operations = [
+            op for op in (getattr(self, 'assembly_operations', None) or [])
+            if op['type'] != 'identity operation'
+        ]
+        self.assembly_operations = None
+        if not operations:
+            return []
+        if getattr(self, 'topology', None) is not None:
+            warnings.warn(
+                'Assembly is expanded after the topology is generated. The '
+                'topology of the model needs to be generated again.'
+            )
+        for operation in operations:
+            warnings.warn(
+                f"{operation['type'].upper()} performed as specified in mmCIF file."
+            )
+        reference_chains = list(self)
+        ref_store = self.attach_coord_store()
+        ref_coords = ref_store.get_coords(include_alt=True)
+        ref_slices = dict(ref_store.chain_slices)
+        # the model is the parent of the chains, and it should not be copied
+        memo = {id(self): None}
+        for chain in reference_chains:
+            for obj in self._get_shared_templates(chain):
+                memo[id(obj)] = obj
+
+        last_idx = max(letters_to_index(chain.id) for chain in reference_chains)
+        added_chains = []
+        for _ in operations:
+            for chain in reference_chains:
+                # only the shared objects are common to the copies
+                copy_chain = deepcopy(chain, dict(memo))
+                copy_chain.parent = None
+                last_idx += 1
+                copy_chain.id = index_to_letters(last_idx)
+                added_chains.append((chain.id, copy_chain))
+
+        matrices = np.array([op['matrix'] for op in operations])
+        vectors = np.array([op['vector'] for op in operations])
+        # (n_ops, n_atoms, 3) in one batched matmul
+        all_coords = ref_coords @ matrices + vectors[:, None, :]
+        for _, copy_chain in added_chains:
+            self.add(copy_chain)
+        store = self.attach_coord_store()
+        n_ref_chains = len(reference_chains)
+        for i, (ref_chain_id, copy_chain) in enumerate(added_chains):
+            ref_start, ref_stop = ref_slices[ref_chain_id]
+            start, stop = store.chain_slices[copy_chain.id]
+            store.coords[start:stop] = all_coords[
+                i // n_ref_chains, ref_start:ref_stop
+            ]
+        self.detach_coord_store()
+        self.reset_atom_serial_numbers()
+        return [copy_chain for _, copy_chain in added_chains]
 
     def set_pdb_id(self, pdb_id):
         """Set the PDB ID of this model."""
@@ -61,9 +218,15 @@ class Model(_Model):
         """Reset all atom serial numbers in the encompassing entity (the parent 
         structure, if it exists) starting from 1."""
         i = 1
-        for atom in self.get_atoms(include_alt=include_alt):
-            atom.set_serial_number(i)
-            i+=1
+        for chain in self:
+            if getattr(chain, 'is_array_backed', False):
+                # array-backed solvent only stores the first serial number
+                chain.serial_start = i
+                i += chain.n_atoms
+                continue
+            for atom in chain.get_atoms(include_alt=include_alt):
+                atom.set_serial_number(i)
+                i+=1
     
     def get_atoms(self, include_alt=False):
         """Return a generator of all atoms from this model. If include_alt is True, the 
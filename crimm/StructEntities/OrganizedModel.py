@@ -96,6 +96,8 @@ class OrganizedModel(Model):
         ## keep original model's connect atoms for looking up covalent bonds
         ## for glycosylation
         self._ref_connect_atoms = model.connect_atoms
+        # pending assembly operations apply to the organized chains as well
+        self.assembly_operations = getattr(model, 'assembly_operations', None)
         self.identify_ligands = identify_ligands
         self.rcsb_web_data = None
         # Binding Affinity Information
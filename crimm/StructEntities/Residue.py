@@ -59,6 +59,26 @@ class Residue(_Residue):
     def atoms(self):
         """Alias for child_list. Return the list of atoms in the residue."""
         return self.child_list
+
+    def _release_coord_store(self):
+        """Detach the coordinate store of the model containing the residue (if
+        attached), since it no longer matches the atoms. (Private method)"""
+        chain = self.parent
+        model = chain.parent if chain is not None else None
+        if getattr(model, '_coord_store', None) is not None:
+            model.detach_coord_store()
+
+    def add(self, atom):
+        """Add an atom to the residue. The coordinate store of the model (if
+        attached) is detached, since it no longer covers all atoms."""
+        self._release_coord_store()
+        super().add(atom)
+
+    def detach_child(self, id):
+        """Remove an atom from the residue. The coordinate store of the model
+        (if attached) is detached, since it no longer matches the atoms."""
+        self._release_coord_store()
+        super().detach_child(id)
     
     def get_atoms(self, include_alt=False):
         """Return the list of all atoms. If include_alt is True, all altloc of 
@@ -211,6 +231,7 @@ class Heterogen(Residue):
 
         Checks for adding duplicate atoms, and raises a warning if so.
         """
+        self._release_coord_store()
         atom_id = atom.get_id()
         if self.has_id(atom_id):
             # some ligands in PDB could have duplicated atom names, we will
@@ -48,6 +48,96 @@ class AtomDefinition:
             topo_definition=self
         )
 
+def _is_neighbor_atom_name(atom_name):
+    """Check if the atom name refers to an atom of the previous ('-') or the 
+    next ('+') residue."""
+    return atom_name.startswith('-') or atom_name.startswith('+')
+
+class ResidueTopologyTemplate:
+    """Precompiled topology of a residue definition. The atom names referenced
+    by bonds, impropers and cmap terms are collected once in atom_names, and 
+    every element is stored as a row of indices into that table. Residues
+    sharing a definition then only need to resolve each atom name once.
+
+    The names used by bonds come first in atom_names, followed by the extra
+    names of impropers and then of cmap terms, so that atom_names[:n] with 
+    n = n_bond_names or n_improper_names is enough to build those elements.
+    Bonds to neighbor residues ('-C', '+N') are not part of the template.
+    """
+    def __init__(self, residue_definition):
+        self.resname = residue_definition.resname
+        self.atom_names = []
+        self._name_index = {}
+
+        bond_rows = []
+        self.bond_types = []
+        for bond_type, bond_list in (residue_definition.bonds or {}).items():
+            for atom_names in bond_list:
+                if any(_is_neighbor_atom_name(name) for name in atom_names):
+                    continue
+                bond_rows.append(self._index_names(atom_names))
+                self.bond_types.append(bond_type)
+        self.bonds = self._to_index_array(bond_rows, 2)
+        self.n_bond_names = len(self.atom_names)
+
+        self.improper_names = [
+            tuple(atom_names) for atom_names in residue_definition.impropers or []
+        ]
+        self.impropers = self._to_index_array(
+            [self._index_names(atom_names) for atom_names in self.improper_names], 4
+        )
+        self.n_improper_names = len(self.atom_names)
+
+        self.cmap_names = [
+            (tuple(dihe1), tuple(dihe2))
+            for dihe1, dihe2 in residue_definition.cmap or []
+        ]
+        self.cmap = self._to_index_array(
+            [self._index_names(dihe1+dihe2) for dihe1, dihe2 in self.cmap_names], 8
+        )
+
+        # IC entries reference their own name table, 'BLNK' is indexed as -1
+        self.ic_keys = list(residue_definition.ic)
+        self.ic_atom_names = []
+        ic_name_index = {}
+        ic_rows = []
+        for ic_key in self.ic_keys:
+            row = []
+            for name in ic_key:
+                if name == 'BLNK':
+                    row.append(-1)
+                    continue
+                if name not in ic_name_index:
+                    ic_name_index[name] = len(self.ic_atom_names)
+                    self.ic_atom_names.append(name)
+                row.append(ic_name_index[name])
+            ic_rows.append(row)
+        self.ic = self._to_index_array(ic_rows, 4)
+        self.ic_improper = np.array(
+            [bool(residue_definition.ic[key]['improper']) for key in self.ic_keys],
+            dtype=bool
+        )
+
+    def __repr__(self):
+        return (
+            f"<Residue Topology Template name={self.resname} "
+            f"atoms={len(self.atom_names)} bonds={len(self.bonds)} "
+            f"impropers={len(self.impropers)} cmap={len(self.cmap)}>"
+        )
+
+    def _index_names(self, atom_names):
+        row = []
+        for name in atom_names:
+            if name not in self._name_index:
+                self._name_index[name] = len(self.atom_names)
+                self.atom_names.append(name)
+            row.append(self._name_index[name])
+        return row
+
+    @staticmethod
+    def _to_index_array(rows, n_atoms):
+        return np.array(rows, dtype=np.int64).reshape(-1, n_atoms)
+
 class ResidueDefinition:
     aa_3to1 = protein_letters_3to1_extended.copy()
     aa_3to1.update({'HSE':'H', 'HSD':'H', 'HSP':'H'})
@@ -83,6 +173,7 @@ class ResidueDefinition:
         self.atom_lookup_dict : Dict = None
         self.standard_coord_dict = None
         self._standard_res = None
+        self._topo_template = None
         self.load_topo_dict(res_topo_dict)
         self.assign_donor_acceptor()
         self.create_atom_lookup_dict()
@@ -164,6 +255,8 @@ class ResidueDefinition:
         """Create a dictionary that maps atom names to the corresponding
         internal coordinates, by which the atom can be built."""
         self.atom_lookup_dict = {}
+        # build sequences depend on the lookup dict, reset their cache
+        self._build_seq_cache = {}
         atom_lookup_entries = []
         for (i, j, k, l), ic in self.ic.items():
             is_improper = int(ic['improper'])
@@ -177,6 +270,20 @@ class ResidueDefinition:
                 self.atom_lookup_dict[(atom_name)] = []
             self.atom_lookup_dict[atom_name].append(ic_key)
 
+    def create_topology_template(self):
+        """(Re)build the precompiled topology template of the residue. Needs to
+        be called after the bonds, impropers, cmap or ic of the definition are 
+        modified."""
+        self._topo_template = ResidueTopologyTemplate(self)
+        return self._topo_template
+
+    def get_topology_template(self):
+        """Return the precompiled topology template of the residue. The 
+        template is built on first use."""
+        if self._topo_template is None:
+            self.create_topology_template()
+        return self._topo_template
+
     def _is_ic_defined(self):
         """Check if the parameters for internal coordinates table are defined 
         for the residue."""
@@ -41,8 +41,12 @@ class TopoEntity:
         return type(self)(*self, **self.__dict__)
 
     def get_atom_types(self):
-        """Return the atom types of the atoms in this entity"""
-        return tuple(a.topo_definition.atom_type for a in self)
+        """Return the atom types of the atoms in this entity (None for the 
+        atoms without topology definition)"""
+        return tuple(
+            None if a.topo_definition is None else a.topo_definition.atom_type
+            for a in self
+        )
 
     def color_missing(self, atom):
         """Return a string representation of an atom with missing coordinates colored red"""
@@ -1,11 +1,67 @@
 
 import warnings
 import numpy as np
+import numpy.linalg as LA
 from Bio.Align import PairwiseAligner
 from Bio.PDB import Superimposer
 from crimm.StructEntities.Chain import PolymerChain
 from crimm.Visualization.NGLVisualization import show_nglview_multiple
 
+def kabsch_batch(ref_coords, mov_coords, mask=None):
+    """Vectorized Kabsch superposition of T pairs of coordinate sets, padded to
+    the same number of atoms N.
+
+    Args:
+        ref_coords: (T, N, 3) array of the reference coordinates
+        mov_coords: (T, N, 3) array of the coordinates to be superimposed
+        mask: (T, N) boolean array of the valid (non-padding) atoms. All atoms
+            are valid if not provided.
+
+    Returns:
+        rot: (T, 3, 3) rotation matrices
+        tran: (T, 3) translation vectors
+        rms: (T,) RMSD after superposition (nan for empty sets)
+        The convention is the same as in Biopython's SVDSuperimposer, i.e.
+        mov_coords @ rot + tran is superimposed onto ref_coords.
+    """
+    ref_coords = np.asarray(ref_coords, dtype=float)
+    mov_coords = np.asarray(mov_coords, dtype=float)
+    if mask is None:
+        mask = np.ones(ref_coords.shape[:2], dtype=bool)
+    weights = mask[..., None].astype(float)
+    n_atoms = weights.sum(axis=1)
+    n_valid = np.maximum(n_atoms, 1)
+    av_ref = (ref_coords*weights).sum(axis=1)/n_valid
+    av_mov = (mov_coords*weights).sum(axis=1)/n_valid
+    ref_centered = (ref_coords - av_ref[:, None])*weights
+    mov_centered = (mov_coords - av_mov[:, None])*weights
+    correlation = np.einsum('tni,tnj->tij', mov_centered, ref_centered)
+    u, _, vt = LA.svd(correlation)
+    rot = u @ vt
+    # correct for reflections
+    is_reflection = LA.det(rot) < 0
+    vt[is_reflection, 2] *= -1
+    rot[is_reflection] = u[is_reflection] @ vt[is_reflection]
+    tran = av_ref - np.einsum('ti,tij->tj', av_mov, rot)
+    diff = (np.einsum('tni,tij->tnj', mov_coords, rot) + tran[:, None] - ref_coords)
+    sq_dev = ((diff*weights)**2).sum(axis=(1, 2))
+    rms = np.sqrt(sq_dev/n_valid[:, 0])
+    rms[n_atoms[:, 0] == 0] = np.nan
+    return rot, tran, rms
+
+def pad_coord_blocks(coord_blocks):
+    """Stack a list of (n_i, 3) coordinate arrays into a zero-padded 
+    (T, max(n_i), 3) array and the (T, max(n_i)) mask of the valid atoms."""
+    n_max = max((len(block) for block in coord_blocks), default=0)
+    padded = np.zeros((len(coord_blocks), n_max, 3))
+    mask = np.zeros((len(coord_blocks), n_max), dtype=bool)
+    for i, block in enumerate(coord_blocks):
+        if len(block) == 0:
+            continue
+        padded[i, :len(block)] = block
+        mask[i, :len(block)] = True
+    return padded, mask
+
 ##TODO: Refactor this!! Add examples to docstrings
 class ChainSuperimposer(Superimposer):
     """Superimpose two chains using their canonical sequences if available
@@ -99,7 +155,14 @@ class ChainSuperimposer(Superimposer):
     def set_chains(self, ref_chain, mov_chain, on_atoms = 'CA'):
         """Set the chains to be superimposed. mov_chain will be moved to
         ref_chain."""
+        ref_align_atoms, mov_align_atoms = self.find_aligned_atoms(
+            ref_chain, mov_chain, on_atoms=on_atoms
+        )
+        self.set_atoms(ref_align_atoms, mov_align_atoms)
 
+    def find_aligned_atoms(self, ref_chain, mov_chain, on_atoms = 'CA'):
+        """Find the lists of aligned atoms of the two chains for superposition.
+        """
         self._check_chain_type(ref_chain)
         self._check_chain_type(mov_chain)
 
@@ -124,7 +187,29 @@ class ChainSuperimposer(Superimposer):
         else:
             raise ValueError('on_atoms has to be selected from '
                 '{"backbone", "all", "CA"}') 
-        self.set_atoms(ref_align_atoms, mov_align_atoms)
+        return ref_align_atoms, mov_align_atoms
+
+    def superimpose_multiple(self, ref_chain, mov_chains, on_atoms = 'CA'):
+        """Superimpose a list of chains onto ref_chain at once. The aligned 
+        coordinates of all chains are padded into one array, and the 
+        superpositions are solved together (see kabsch_batch). The chains are
+        not moved.
+
+        Returns:
+            rot: (T, 3, 3) rotation matrices
+            tran: (T, 3) translation vectors
+            rms: (T,) RMSD values of the superpositions
+        """
+        ref_blocks, mov_blocks = [], []
+        for mov_chain in mov_chains:
+            ref_atoms, mov_atoms = self.find_aligned_atoms(
+                ref_chain, mov_chain, on_atoms=on_atoms
+            )
+            ref_blocks.append([atom.coord for atom in ref_atoms])
+            mov_blocks.append([atom.coord for atom in mov_atoms])
+        ref_coords, mask = pad_coord_blocks(ref_blocks)
+        mov_coords, _ = pad_coord_blocks(mov_blocks)
+        return kabsch_batch(ref_coords, mov_coords, mask)
 
     def _find_all_common_atoms(self, ref_res_list, mov_res_list):
         """Find all common atoms from two lists of residues that are aligned"""
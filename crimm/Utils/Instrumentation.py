@@ -0,0 +1,183 @@
+"""Opt-in timing and allocation instrumentation of the preparation stages.
+
+The hot paths of crimm (structure parsing, hydrogen building, topology
+element search, parameter assignment, solvation and PSF writing) are wrapped
+in named stages, and count the work they do (atoms, topology elements,
+KDTree queries, bytes written). Instrumentation is off by default, in which
+case a stage costs a single flag check. Enable it with `enable()` (or the
+environment variable CRIMM_INSTRUMENT=1), run the job, and read the
+structured report with `get_report()`:
+
+    >>> from crimm.Utils import Instrumentation
+    >>> Instrumentation.enable(trace_memory=True)
+    >>> model = fetch_rcsb('1lsa', organize=True)
+    >>> topo.generate_model(model)
+    >>> report = Instrumentation.get_report()
+    >>> report['stages']['mmcif_parse']['counters']['atoms']
+
+Stages can be nested. Counters are attributed to the innermost running stage
+of the thread. The peak memory (tracemalloc, only if trace_memory) of a
+stage is the maximum traced memory during any of its calls, relative to the
+traced memory at its start.
+"""
+import os
+import json
+import time
+import threading
+import tracemalloc
+from functools import wraps
+
+_enabled = os.environ.get('CRIMM_INSTRUMENT', '0') == '1'
+_trace_memory = False
+_lock = threading.Lock()
+_local = threading.local()
+_stages = {}
+# counters recorded outside of any stage
+_global_counters = {}
+
+def is_enabled():
+    """Return if instrumentation is enabled."""
+    return _enabled
+
+def enable(trace_memory=False):
+    """Enable instrumentation. If trace_memory, the peak memory of the stages
+    is traced with tracemalloc, which slows the stages down."""
+    global _enabled, _trace_memory
+    _enabled = True
+    _trace_memory = trace_memory
+    if trace_memory and not tracemalloc.is_tracing():
+        tracemalloc.start()
+
+def disable():
+    """Disable instrumentation. The recorded data is kept until reset()."""
+    global _enabled, _trace_memory
+    _enabled = False
+    if _trace_memory and tracemalloc.is_tracing():
+        tracemalloc.stop()
+    _trace_memory = False
+
+def reset():
+    """Discard all recorded data."""
+    with _lock:
+        _stages.clear()
+        _global_counters.clear()
+
+def _get_stack():
+    if not hasattr(_local, 'stack'):
+        _local.stack = []
+    return _local.stack
+
+def _get_stage_record(name):
+    if name not in _stages:
+        _stages[name] = {
+            'calls': 0, 'wall_time_s': 0.0, 'peak_memory_mb': None,
+            'counters': {}
+        }
+    return _stages[name]
+
+class _Stage:
+    """Context manager of a running stage."""
+    __slots__ = ('name', '_start', '_mem_start', '_peak')
+
+    def __init__(self, name):
+        self.name = name
+
+    def __enter__(self):
+        if not _enabled:
+            return self
+        _get_stack().append(self)
+        if _trace_memory:
+            self._mem_start = tracemalloc.get_traced_memory()[0]
+            tracemalloc.reset_peak()
+            # peak of the nested stages, whose start resets the peak
+            self._peak = self._mem_start
+        self._start = time.perf_counter()
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        if not _enabled or not hasattr(self, '_start'):
+            return False
+        elapsed = time.perf_counter() - self._start
+        peak_mb = None
+        stack = _get_stack()
+        if stack and stack[-1] is self:
+            stack.pop()
+        if _trace_memory and tracemalloc.is_tracing() and hasattr(self, '_peak'):
+            peak = max(tracemalloc.get_traced_memory()[1], self._peak)
+            peak_mb = max(peak - self._mem_start, 0) / 2**20
+            if stack and hasattr(stack[-1], '_peak'):
+                stack[-1]._peak = max(stack[-1]._peak, peak)
+            del self._peak
+        with _lock:
+            record = _get_stage_record(self.name)
+            record['calls'] += 1
+            record['wall_time_s'] += elapsed
+            if peak_mb is not None:
+                prev_peak = record['peak_memory_mb'] or 0.0
+                record['peak_memory_mb'] = max(prev_peak, peak_mb)
+        del self._start
+        return False
+
+def stage(name):
+    """Return a context manager that records a stage:
+
+        with stage('solvate'):
+            ...
+    """
+    return _Stage(name)
+
+def instrumented(name):
+    """Decorator that records every call of the function as a stage."""
+    def decorator(func):
+        @wraps(func)
+        def wrapper(*args, **kwargs):
+            if not _enabled:
+                return func(*args, **kwargs)
+            with _Stage(name):
+                return func(*args, **kwargs)
+        return wrapper
+    return decorator
+
+def count(counter_name, n=1):
+    """Add n to a counter of the innermost running stage of the thread."""
+    if not _enabled:
+        return
+    stack = _get_stack()
+    with _lock:
+        if stack:
+            counters = _get_stage_record(stack[-1].name)['counters']
+        else:
+            counters = _global_counters
+        counters[counter_name] = counters.get(counter_name, 0) + n
+
+def get_report():
+    """Return the recorded stages and counters as a dict of plain values."""
+    with _lock:
+        return {
+            'stages': {
+                name: {**record, 'counters': dict(record['counters'])}
+                for name, record in _stages.items()
+            },
+            'counters': dict(_global_counters),
+            'trace_memory': _trace_memory,
+        }
+
+def write_report(file_path):
+    """Write the report as JSON, e.g. for aggregating batch runs."""
+    with open(file_path, 'w', encoding='utf-8') as f:
+        json.dump(get_report(), f, indent=2)
+
+def print_report():
+    """Print a table of the recorded stages."""
+    report = get_report()
+    print(f"{'stage':<24s}{'calls':>8s}{'time (s)':>12s}{'peak (MB)':>12s}  counters")
+    for name, record in sorted(
+        report['stages'].items(), key=lambda item: -item[1]['wall_time_s']
+    ):
+        peak = record['peak_memory_mb']
+        peak_str = f'{peak:12.1f}' if peak is not None else f"{'-':>12s}"
+        counters = ' '.join(f'{k}={v}' for k, v in record['counters'].items())
+        print(
+            f"{name:<24s}{record['calls']:>8d}{record['wall_time_s']:>12.3f}"
+            f"{peak_str}  {counters}"
+        )
@@ -0,0 +1,383 @@
+"""Cell-list neighbor search on atom coordinates, with optional periodic
+boundary conditions of the cubic or truncated octahedral box of a solvated
+model.
+
+The coordinates are binned into cells at least as wide as the search
+radius, so only the atoms in the 27 neighboring cells are compared. The
+candidate pairs are expanded as index arrays one chunk of atoms at a time,
+which keeps the memory bounded and lets the chunks be searched in parallel
+threads. For periodic boxes, distances follow the minimum image convention.
+The truncated octahedron is treated as the body-centered cubic lattice of its
+bounding cube, i.e. the cubic lattice and the same lattice shifted by half of
+the cube diagonal.
+"""
+import math
+from itertools import product
+from concurrent.futures import ThreadPoolExecutor
+import numpy as np
+
+# Number of query points per chunk of the cell search. A chunk expands to
+# about 27 times the mean cell occupancy candidate pairs per point.
+NEIGHBOR_CHUNK_SIZE = 1 << 14
+# Upper bound of the number of cells per atom in the grid, which limits the
+# memory of the cell arrays for sparse coordinates
+MAX_CELLS_PER_ATOM = 2
+BOX_TYPES = ('cube', 'octa')
+
+def get_periodic_box(entity):
+    """Return the (box_type, box_dim) of the model of the entity recorded by
+    the Solvator, or (None, None) if the model is not solvated."""
+    model = entity
+    while model is not None and getattr(model, 'level', None) not in ('M', 'S'):
+        model = model.parent
+    if model is not None and model.level == 'S':
+        model = model.child_list[0] if len(model) > 0 else None
+    sol_info = getattr(model, '_solvation_info', None)
+    if not sol_info or 'box_type' not in sol_info:
+        return None, None
+    return sol_info['box_type'], sol_info['box_dim']
+
+def _get_lattice_cube(box_type, box_dim):
+    """Return the side of the cubic lattice and the extra lattice shifts of
+    the periodic box."""
+    if box_type == 'cube':
+        return box_dim, ()
+    if box_type == 'octa':
+        # box_dim is the CHARMM lattice length a of the truncated octahedron,
+        # its bounding cube has the side a*sqrt(4/3)
+        side = box_dim * math.sqrt(4 / 3)
+        return side, (np.full(3, side / 2),)
+    raise ValueError(
+        f'Unsupported periodic box type {box_type}! Expected one of {BOX_TYPES}'
+    )
+
+def minimum_image(vectors, box_type=None, box_dim=None):
+    """Return the minimum image of the displacement vectors (N, 3) in the
+    periodic box. If box_type is None, the vectors are returned unchanged."""
+    vectors = np.asarray(vectors, dtype=float)
+    if box_type is None:
+        return vectors
+    side, _ = _get_lattice_cube(box_type, box_dim)
+    vectors = vectors - side * np.round(vectors / side)
+    if box_type == 'octa':
+        # the corners of the cube belong to the body-centered images
+        corner = np.abs(vectors).sum(axis=-1) > 0.75 * side
+        vectors[corner] -= 0.5 * side * np.sign(vectors[corner])
+    return vectors
+
+class _CellGrid:
+    """Cell list of a set of reference coordinates."""
+    def __init__(self, coords, radius, box_type=None, box_dim=None, origin=None):
+        self.box_type, self.box_dim = box_type, box_dim
+        self.periodic = box_type is not None
+        n_atoms = max(len(coords), 1)
+        if self.periodic:
+            self.side, self.shifts = _get_lattice_cube(box_type, box_dim)
+            self.origin = np.zeros(3)
+            extent = np.full(3, self.side)
+        else:
+            self.side, self.shifts = None, ()
+            self.origin = coords.min(0) if origin is None else origin
+            extent = np.maximum(coords.max(0) - self.origin, radius)
+        # enlarge the cells if the grid would be much sparser than the atoms
+        cell_size = max(
+            radius, (np.prod(extent) / (MAX_CELLS_PER_ATOM * n_atoms)) ** (1/3)
+        )
+        if self.periodic:
+            # cells are not smaller than the radius, the box side is split
+            # into an integer number of cells
+            self.n_cells = np.maximum(np.floor(extent / cell_size), 1).astype(int)
+        else:
+            self.n_cells = np.floor(extent / cell_size).astype(int) + 1
+        self.cell_size = extent / self.n_cells if self.periodic else np.full(3, cell_size)
+        cell_ids = self.get_cell_ids(coords)
+        linear_ids = self._to_linear(cell_ids)
+        self.order = np.argsort(linear_ids, kind='stable')
+        self.counts = np.bincount(linear_ids, minlength=np.prod(self.n_cells))
+        self.starts = np.cumsum(self.counts) - self.counts
+        # neighbor cell offsets; with less than 3 cells along an axis, every
+        # cell on that axis is a neighbor (and only visited once)
+        axis_offsets = []
+        for n in self.n_cells:
+            if self.periodic and n < 3:
+                axis_offsets.append(range(n))
+            else:
+                axis_offsets.append((-1, 0, 1))
+        self.offsets = np.array(list(product(*axis_offsets)), dtype=np.int64)
+
+    def get_cell_ids(self, coords):
+        """Return the (N, 3) cell indices of the coordinates."""
+        if self.periodic:
+            coords = coords - self.side * np.floor(coords / self.side)
+        cell_ids = np.floor((coords - self.origin) / self.cell_size).astype(np.int64)
+        # points on the upper boundary (or outside of a non-periodic grid)
+        return np.clip(cell_ids, 0, self.n_cells - 1)
+
+    def _to_linear(self, cell_ids):
+        ny, nz = self.n_cells[1], self.n_cells[2]
+        return (cell_ids[:, 0] * ny + cell_ids[:, 1]) * nz + cell_ids[:, 2]
+
+    def get_candidates(self, query_cell_ids):
+        """Return the (query, reference) index arrays of all points in the
+        neighboring cells of the query cells."""
+        query_i, ref_j = [], []
+        n_query = len(query_cell_ids)
+        for offset in self.offsets:
+            neighbor_ids = query_cell_ids + offset
+            if self.periodic:
+                neighbor_ids %= self.n_cells
+                valid = np.ones(n_query, dtype=bool)
+            else:
+                valid = np.all(
+                    (neighbor_ids >= 0) & (neighbor_ids < self.n_cells), axis=1
+                )
+            linear_ids = self._to_linear(neighbor_ids[valid])
+            counts = self.counts[linear_ids]
+            total = counts.sum()
+            if total == 0:
+                continue
+            # ragged expansion: every query point against every point of
+            # its neighbor cell
+            i_rep = np.repeat(np.flatnonzero(valid), counts)
+            cell_starts = np.repeat(self.starts[linear_ids], counts)
+            within_cell = np.arange(total) - np.repeat(
+                np.cumsum(counts) - counts, counts
+            )
+            query_i.append(i_rep)
+            ref_j.append(self.order[cell_starts + within_cell])
+        if not query_i:
+            empty = np.zeros(0, dtype=np.int64)
+            return empty, empty
+        return np.concatenate(query_i), np.concatenate(ref_j)
+
+def _search_chunk(grid, query, ref, radius, chunk_start, self_search):
+    """Return the (query, reference) index pairs within radius for a chunk of
+    query points."""
+    query_i, ref_j = [], []
+    for shift in (np.zeros(3), *grid.shifts):
+        # searching the shifted query points against the reference cells
+        # covers the body-centered images of the periodic lattice
+        i, j = grid.get_candidates(grid.get_cell_ids(query - shift))
+        if self_search:
+            keep = (i + chunk_start) < j
+            i, j = i[keep], j[keep]
+        query_i.append(i)
+        ref_j.append(j)
+    i, j = np.concatenate(query_i), np.concatenate(ref_j)
+    diff = minimum_image(ref[j] - query[i], grid.box_type, grid.box_dim)
+    keep = np.einsum('ij,ij->i', diff, diff) <= radius * radius
+    i, j = i[keep] + chunk_start, j[keep]
+    if grid.shifts:
+        # the same pair can be found through more than one image
+        pair_ids = np.unique(i * len(ref) + j)
+        i, j = pair_ids // len(ref), pair_ids % len(ref)
+    return i, j
+
+def search_pairs(
+        query, ref, radius, box_type=None, box_dim=None, n_workers=1,
+        chunk_size=NEIGHBOR_CHUNK_SIZE
+    ):
+    """Return the (K, 2) int array of the (query, reference) index pairs of
+    points within radius. If ref is None, the pairs i < j within the query
+    points are returned. The query is split into chunks that are searched in
+    n_workers threads."""
+    query = np.asarray(query, dtype=float).reshape(-1, 3)
+    self_search = ref is None
+    ref = query if self_search else np.asarray(ref, dtype=float).reshape(-1, 3)
+    if len(query) == 0 or len(ref) == 0:
+        return np.zeros((0, 2), dtype=np.int64)
+    origin = None
+    if box_type is None:
+        origin = np.minimum(query.min(0), ref.min(0))
+    grid = _CellGrid(ref, radius, box_type, box_dim, origin=origin)
+    chunk_starts = range(0, len(query), chunk_size)
+    def search(st):
+        return _search_chunk(
+            grid, query[st:st+chunk_size], ref, radius, st, self_search
+        )
+    if n_workers > 1 and len(chunk_starts) > 1:
+        # numpy releases the GIL in the array operations of the chunks
+        with ThreadPoolExecutor(max_workers=n_workers) as executor:
+            results = list(executor.map(search, chunk_starts))
+    else:
+        results = [search(st) for st in chunk_starts]
+    pairs = np.empty((sum(len(i) for i, _ in results), 2), dtype=np.int64)
+    n = 0
+    for i, j in results:
+        pairs[n:n+len(i), 0] = i
+        pairs[n:n+len(i), 1] = j
+        n += len(i)
+    return pairs
+
+class NeighborSearch:
+    """Verlet neighbor list of a set of atoms built on a cell list, with
+    optional periodic boundary conditions.
+
+    The pair list is built once with the radius cutoff+skin. Pairs within
+    the cutoff are filtered from the list with the current coordinates,
+    and the list is only rebuilt by `update` once an atom has moved more than
+    half of the skin since the last build.
+
+    Parameters
+    ----------
+    coords : numpy.ndarray
+        (N, 3) atom coordinates
+    cutoff : float
+        The maximum distance of the neighbor pairs
+    box_type : str, optional
+        Periodic box type ('cube' or 'octa'), None for no periodic boundaries
+    box_dim : float, optional
+        The periodic box dimension (Solvator.box_dim)
+    skin : float, default 0.0
+        Extra distance of the Verlet list, which allows small coordinate
+        changes without rebuilding the list
+    n_workers : int, default 1
+        Number of threads of the cell search
+    """
+    def __init__(
+            self, coords, cutoff, box_type=None, box_dim=None, skin=0.0,
+            n_workers=1
+        ):
+        if box_type is not None and box_type not in BOX_TYPES:
+            raise ValueError(
+                f'Unsupported periodic box type {box_type}! '
+                f'Expected one of {BOX_TYPES}'
+            )
+        self.coords = np.asarray(coords, dtype=float).reshape(-1, 3)
+        self.cutoff = cutoff
+        self.box_type = box_type
+        self.box_dim = box_dim
+        self.skin = skin
+        self.n_workers = n_workers
+        self.atoms = None
+        self.residues = None
+        self.residue_indices = None
+        self._pair_list = None
+        self._ref_coords = None
+
+    @classmethod
+    def from_entity(
+            cls, entity, cutoff, include_alt=False, periodic=True, skin=0.0,
+            n_workers=1
+        ):
+        """Create the neighbor search on the atoms of a structure entity
+        (Structure, Model, Chain or Residue). If periodic, the box recorded by
+        the Solvator on the model is used."""
+        if entity.level == 'R':
+            residues = [entity]
+        else:
+            residues = list(entity.get_residues())
+        atoms, n_res_atoms = [], []
+        for residue in residues:
+            res_atoms = list(residue.get_atoms(include_alt=include_alt))
+            atoms.extend(res_atoms)
+            n_res_atoms.append(len(res_atoms))
+        coords = np.array([atom.coord for atom in atoms], dtype=float)
+        box_type, box_dim = get_periodic_box(entity) if periodic else (None, None)
+        searcher = cls(coords, cutoff, box_type, box_dim, skin, n_workers)
+        searcher.atoms = atoms
+        searcher.residues = residues
+        searcher.residue_indices = np.repeat(np.arange(len(residues)), n_res_atoms)
+        return searcher
+
+    def __repr__(self):
+        box = f' box={self.box_type}' if self.box_type is not None else ''
+        return (
+            f'<NeighborSearch atoms={len(self.coords)} cutoff={self.cutoff}'
+            f'{box}>'
+        )
+
+    def _build(self):
+        self._pair_list = search_pairs(
+            self.coords, None, self.cutoff + self.skin, self.box_type,
+            self.box_dim, self.n_workers
+        )
+        self._ref_coords = self.coords.copy()
+
+    def update(self, coords=None):
+        """Update the coordinates (from the atoms if coords is None). The
+        pair list is rebuilt only if any atom moved more than half of the
+        skin. Return True if the list was rebuilt."""
+        if coords is None:
+            if self.atoms is None:
+                raise ValueError(
+                    'Coordinates are required for a search not created '
+                    'from a structure entity!'
+                )
+            coords = np.array([atom.coord for atom in self.atoms], dtype=float)
+        coords = np.asarray(coords, dtype=float).reshape(-1, 3)
+        if coords.shape != self.coords.shape:
+            raise ValueError(
+                f'Expected coordinates of shape {self.coords.shape}, '
+                f'got {coords.shape}!'
+            )
+        self.coords = coords
+        if self._pair_list is None:
+            return False
+        displacement = np.einsum(
+            'ij,ij->i', coords - self._ref_coords, coords - self._ref_coords
+        ).max(initial=0.0)
+        if 4 * displacement > self.skin * self.skin:
+            self._build()
+            return True
+        return False
+
+    def get_distances(self, pairs):
+        """Return the (minimum image) distances of the atom index pairs."""
+        pairs = np.asarray(pairs, dtype=np.int64).reshape(-1, 2)
+        diff = minimum_image(
+            self.coords[pairs[:, 1]] - self.coords[pairs[:, 0]],
+            self.box_type, self.box_dim
+        )
+        return np.sqrt(np.einsum('ij,ij->i', diff, diff))
+
+    def find_pairs(self, cutoff=None):
+        """Return the (K, 2) int array of atom index pairs i < j within the
+        cutoff (at most the cutoff of the search)."""
+        if cutoff is None:
+            cutoff = self.cutoff
+        elif cutoff > self.cutoff:
+            raise ValueError(
+                f'Cutoff {cutoff} is larger than the cutoff of the neighbor '
+                f'search {self.cutoff}!'
+            )
+        if self._pair_list is None:
+            self._build()
+        pairs = self._pair_list
+        if self.skin == 0.0 and cutoff == self.cutoff:
+            return pairs.copy()
+        return pairs[self.get_distances(pairs) <= cutoff]
+
+    def query(self, points, cutoff=None):
+        """Return the (K, 2) int array of (point index, atom index) pairs
+        within the cutoff of the points (M, 3)."""
+        if cutoff is None:
+            cutoff = self.cutoff
+        return search_pairs(
+            points, self.coords, cutoff, self.box_type, self.box_dim,
+            self.n_workers
+        )
+
+    def find_residue_pairs(self, cutoff=None):
+        """Return the (K, 2) int array of the residue index pairs i < j (into
+        `residues`) with any atoms within the cutoff."""
+        if self.residue_indices is None:
+            raise ValueError(
+                'Residue pairs require a search created from a structure entity!'
+            )
+        res_pairs = self.residue_indices[self.find_pairs(cutoff)]
+        res_pairs = res_pairs[res_pairs[:, 0] != res_pairs[:, 1]]
+        res_pairs.sort(axis=1)
+        n_res = len(self.residues)
+        pair_ids = np.unique(res_pairs[:, 0] * n_res + res_pairs[:, 1])
+        return np.column_stack((pair_ids // n_res, pair_ids % n_res))
+
+    def get_contact_map(self, cutoff=None):
+        """Return the symmetric (n_residues, n_residues) boolean residue
+        contact map."""
+        n_res = len(self.residues) if self.residues is not None else 0
+        contact_map = np.zeros((n_res, n_res), dtype=bool)
+        res_pairs = self.find_residue_pairs(cutoff)
+        contact_map[res_pairs[:, 0], res_pairs[:, 1]] = True
+        contact_map[res_pairs[:, 1], res_pairs[:, 0]] = True
+        return contact_map
@@ -53,8 +53,22 @@ def get_coords(entity, include_alt=False):
             f'while {type(entity)} is provided')
     if entity.level == 'A':
         return entity.coord
+    if (store := get_coord_store(entity)) is not None:
+        chain_id = entity.id if entity.level == 'C' else None
+        return store.get_coords(include_alt, chain_id)
     return np.array([a.coord for a in entity.get_atoms(include_alt)])
 
+def get_coord_store(entity):
+    """Return the CoordinateStore covering the model or chain entity, or None
+    if no store is attached."""
+    if entity.level == 'M':
+        return getattr(entity, 'coord_store', None)
+    if entity.level == 'C' and entity.parent is not None:
+        store = getattr(entity.parent, 'coord_store', None)
+        if store is not None and entity.id in store.chain_slices:
+            return store
+    return None
+
 def _rename_chains_by_order(chains):
     for i, chain in enumerate(chains):
         chain.id = index_to_letters(i)
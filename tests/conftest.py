@@ -0,0 +1,36 @@
+"""Shared fixtures of the crimm tests. The systems are built from sequence, so
+the tests run without network access."""
+import pytest
+from crimm.StructEntities.Model import Model
+from crimm.StructEntities.OrganizedModel import OrganizedModel
+from crimm.Modeller.SeqChainGenerator import SeqChainGenerator
+from crimm.Modeller.TopoLoader import TopologyGenerator
+
+def build_peptide_model(sequence='ALA ALA ALA', chain_id='A'):
+    """Return an OrganizedModel with a single peptide chain built from the
+    three-letter sequence."""
+    generator = SeqChainGenerator()
+    generator.set_three_letter_sequence(sequence, chain_type='polypeptide')
+    model = Model(1)
+    model.add(generator.create_chain(chain_id))
+    return OrganizedModel(model)
+
+@pytest.fixture(scope='session')
+def topo_generator():
+    """The TopologyGenerator is shared, loading the toppar files is slow."""
+    return TopologyGenerator()
+
+@pytest.fixture
+def tripeptide(topo_generator):
+    """The ALA-ALA-ALA peptide with its topology generated."""
+    model = build_peptide_model()
+    topo_generator.generate_model(model, QUIET=True)
+    return model
+
+@pytest.fixture
+def peptide(topo_generator):
+    """A longer peptide with charged and aromatic residues, with its topology
+    generated."""
+    model = build_peptide_model('MET LYS ASP PHE SER GLU TRP ARG GLY HSD')
+    topo_generator.generate_model(model, QUIET=True)
+    return model
@@ -0,0 +1,59 @@
+"""Array-backed bulk solvent chains and their implicit topology."""
+import numpy as np
+from crimm.Modeller.Solvator import Solvator
+from crimm.StructEntities.Chain import BulkSolvent
+
+def _solvate(model):
+    water_chains = Solvator(model).solvate(cutoff=8.0)
+    assert water_chains and all(
+        isinstance(chain, BulkSolvent) for chain in water_chains
+    )
+    return water_chains
+
+def test_topology_counts_do_not_materialize(tripeptide):
+    water_chain = _solvate(tripeptide)[0]
+    repr(tripeptide.topology)
+    repr(water_chain.topology)
+    assert water_chain.is_array_backed
+    n_local_bonds = len(water_chain.topology.local_indices['bonds'])
+    assert n_local_bonds > 0
+    assert water_chain.topology.get_n_elements('bonds') == (
+        n_local_bonds * len(water_chain)
+    )
+
+def test_element_objects_are_created_once(tripeptide):
+    water_chain = _solvate(tripeptide)[0]
+    topology = water_chain.topology
+    n_bonds = topology.get_n_elements('bonds')
+    n_local_bonds = len(topology.local_indices['bonds'])
+    bonds = topology.bonds
+    assert len(bonds) == n_bonds
+    assert topology.bonds is bonds
+    assert topology.bonds[0] is bonds[0]
+    # the elements are recreated when molecules are removed
+    water_chain.remove_residues([0])
+    assert len(topology.bonds) == n_bonds - n_local_bonds
+
+def test_index_array_matches_element_objects(tripeptide):
+    water_chain = _solvate(tripeptide)[0]
+    index_array = water_chain.topology.get_index_array('bonds')
+    atoms = list(water_chain.get_atoms())
+    atom_index = {atom: i for i, atom in enumerate(atoms)}
+    from_objects = np.array([
+        [atom_index[atom] for atom in bond]
+        for bond in water_chain.topology.bonds
+    ])
+    assert np.array_equal(index_array, from_objects)
+
+def test_copy_keeps_serial_start(tripeptide):
+    water_chain = _solvate(tripeptide)[0]
+    tripeptide.reset_atom_serial_numbers()
+    copied = water_chain.copy()
+    assert copied.is_array_backed
+    assert copied.serial_start == water_chain.serial_start
+
+def test_topology_generation_keeps_the_template_parent(tripeptide):
+    water_chain = _solvate(tripeptide)[0]
+    # the Solvator creates the template without a parent
+    assert water_chain.template.parent is None
+    assert water_chain.topology is not None
@@ -0,0 +1,56 @@
+"""An attached CoordinateStore is detached when the atoms of the model change,
+so get_coords never returns the coordinates of a stale store."""
+import numpy as np
+import pytest
+from crimm.Utils.StructureUtils import get_coords
+
+def _brute_force_coords(model):
+    return np.array([atom.coord for atom in model.get_atoms()])
+
+def test_store_matches_atoms(tripeptide):
+    tripeptide.attach_coord_store()
+    np.testing.assert_allclose(
+        get_coords(tripeptide), _brute_force_coords(tripeptide)
+    )
+
+def test_detaching_an_atom_detaches_the_store(tripeptide):
+    tripeptide.attach_coord_store()
+    residue = tripeptide['A'].residues[1]
+    atom = next(iter(residue))
+    residue.detach_child(atom.id)
+    assert tripeptide.coord_store is None
+    np.testing.assert_allclose(
+        get_coords(tripeptide), _brute_force_coords(tripeptide)
+    )
+
+def test_adding_an_atom_detaches_the_store(tripeptide):
+    tripeptide.attach_coord_store()
+    residue = tripeptide['A'].residues[1]
+    atom = next(iter(residue))
+    residue.detach_child(atom.id)
+    tripeptide.attach_coord_store()
+    residue.add(atom)
+    assert tripeptide.coord_store is None
+    assert len(get_coords(tripeptide)) == len(_brute_force_coords(tripeptide))
+
+def test_renamed_chain_is_stale(tripeptide):
+    store = tripeptide.attach_coord_store()
+    assert not store.is_stale()
+    chain = tripeptide['A']
+    # bypass Model.detach_child/add
+    chain.id = 'Z'
+    with pytest.warns(UserWarning, match='no longer matches'):
+        assert tripeptide.coord_store is None
+
+def test_expand_assembly_detaches_the_store():
+    from tests.conftest import build_peptide_model
+    model = build_peptide_model()
+    ref_coords = _brute_force_coords(model)
+    model.assembly_operations = [{
+        'type': 'point symmetry operation', 'matrix': np.eye(3),
+        'vector': np.array([10.0, 0.0, 0.0]),
+    }]
+    added_chains = model.expand_assembly()
+    assert model.coord_store is None
+    copy_coords = np.array([atom.coord for atom in added_chains[0].get_atoms()])
+    np.testing.assert_allclose(copy_coords, ref_coords + [10.0, 0.0, 0.0])
@@ -0,0 +1,46 @@
+"""Template screening by overall RMSD, with a stub superimposer so that no
+template has to be downloaded."""
+import numpy as np
+from crimm.Modeller.LoopBuilder import ChainLoopBuilder
+
+class _Template:
+    can_seq = 'AAA'
+    def get_atoms(self, include_alt=False):
+        return iter(())
+
+class _Imposer:
+    def __init__(self, rms_values):
+        self.rms_values = list(rms_values)
+        self.batch_sizes = []
+    def superimpose_multiple(self, ref_chain, mov_chains, on_atoms='CA'):
+        n = len(mov_chains)
+        self.batch_sizes.append(n)
+        rms, self.rms_values = self.rms_values[:n], self.rms_values[n:]
+        return np.tile(np.eye(3), (n, 1, 1)), np.zeros((n, 3)), np.array(rms)
+
+def _make_builder(rms_values):
+    builder = object.__new__(ChainLoopBuilder)
+    builder.model_chain = None
+    builder.imposer = _Imposer(rms_values)
+    return builder
+
+def test_screen_templates_rejects_non_finite_rmsd():
+    builder = _make_builder([0.5, np.nan, np.inf, 3.0])
+    templates = [(str(i), _Template()) for i in range(4)]
+    screened = builder.screen_templates(templates, 2.0)
+    assert [pdbid for pdbid, _ in screened] == ['0']
+
+def test_iter_screened_templates_streams_in_batches():
+    rms_values = [0.1, 5.0, 0.2, 0.3, np.nan]
+    builder = _make_builder(rms_values)
+    pulled = []
+    def stream():
+        for i in range(len(rms_values)):
+            pulled.append(i)
+            yield str(i), _Template()
+    screened = builder.iter_screened_templates(stream(), 1.0, batch_size=2)
+    assert next(screened)[0] == '0'
+    # only the first batch has been pulled from the stream
+    assert pulled == [0, 1]
+    assert [pdbid for pdbid, _ in screened] == ['2', '3']
+    assert builder.imposer.batch_sizes == [2, 2, 1]
@@ -0,0 +1,48 @@
+"""LazyMMCIF2Dict has to index and decode the same categories as MMCIF2Dict."""
+import io
+from crimm.IO.MMCIF2Dict import MMCIF2Dict, LazyMMCIF2Dict
+
+# The text field of _struct.title contains lines that look like a tag and a
+# data block header
+CIF_CONTENT = """data_TEST
+#
+_entry.id TEST
+#
+_struct.entry_id TEST
+_struct.title
+;A title with
+_fake.tag inside
+data_FAKE
+;
+#
+loop_
+_entity.id
+_entity.type
+1 polymer
+2 water
+#
+"""
+
+def test_text_field_lines_are_not_indexed():
+    cifdict = LazyMMCIF2Dict(io.BytesIO(CIF_CONTENT.encode()))
+    assert cifdict['data'] == 'TEST'
+    assert set(cifdict.keys()) == {'data', 'entry', 'struct', 'entity'}
+    assert 'fake' not in cifdict
+    assert 'inside' in cifdict['struct']['title'][0]
+
+def test_lazy_dict_matches_eager_dict(tmp_path):
+    file_path = tmp_path / 'test.cif'
+    file_path.write_text(CIF_CONTENT)
+    eager = MMCIF2Dict(str(file_path))
+    lazy = LazyMMCIF2Dict(str(file_path))
+    lazy.load_all()
+    assert dict(lazy.items()) == dict(eager.items())
+
+def test_empty_quoted_values_are_read(tmp_path):
+    file_path = tmp_path / 'empty.cif'
+    file_path.write_text(
+        "data_EMPTY\n_entry.id EMPTY\n"
+        "loop_\n_citation.id\n_citation.title\n1 ''\n2 'A title'\n"
+    )
+    cifdict = MMCIF2Dict(str(file_path))
+    assert cifdict['citation']['title'] == ['', 'A title']
@@ -0,0 +1,68 @@
+"""The cell-list neighbor search has to find the same pairs as the brute force
+search over all pairs (and over all periodic images)."""
+import math
+from itertools import product
+import numpy as np
+import pytest
+from crimm.Utils.NeighborSearch import NeighborSearch, search_pairs
+
+CUTOFF = 3.0
+
+def _get_images(box_type, box_dim):
+    """Return the lattice translations of the periodic box around the
+    origin cell."""
+    if box_type is None:
+        return np.zeros((1, 3))
+    side = box_dim if box_type == 'cube' else box_dim * math.sqrt(4 / 3)
+    images = [side * np.array(n) for n in product((-1, 0, 1), repeat=3)]
+    if box_type == 'octa':
+        images += [
+            side * (np.array(n) + 0.5) for n in product((-2, -1, 0, 1), repeat=3)
+        ]
+    return np.array(images)
+
+def _brute_force_pairs(query, ref, cutoff, box_type=None, box_dim=None):
+    diff = ref[None] - query[:, None]
+    dist = np.full(diff.shape[:2], np.inf)
+    for image in _get_images(box_type, box_dim):
+        dist = np.minimum(dist, np.sqrt(((diff + image)**2).sum(-1)))
+    if ref is query:
+        dist[np.tril_indices(len(query))] = np.inf
+    return {tuple(pair) for pair in np.argwhere(dist <= cutoff).tolist()}
+
+def _as_set(pairs):
+    pairs = pairs.tolist()
+    assert len(pairs) == len(set(map(tuple, pairs)))
+    return set(map(tuple, pairs))
+
+@pytest.mark.parametrize('box_type', [None, 'cube', 'octa'])
+def test_self_search_matches_brute_force(box_type):
+    rng = np.random.default_rng(0)
+    box_dim = 20.0
+    coords = rng.uniform(0, box_dim, size=(400, 3))
+    expected = _brute_force_pairs(coords, coords, CUTOFF, box_type, box_dim)
+    pairs = search_pairs(
+        coords, None, CUTOFF, box_type, box_dim, chunk_size=64, n_workers=2
+    )
+    assert _as_set(pairs) == expected
+
+@pytest.mark.parametrize('box_type', [None, 'cube', 'octa'])
+def test_query_matches_brute_force(box_type):
+    rng = np.random.default_rng(1)
+    box_dim = 20.0
+    coords = rng.uniform(0, box_dim, size=(300, 3))
+    points = rng.uniform(-2, box_dim+2, size=(50, 3))
+    searcher = NeighborSearch(coords, CUTOFF, box_type, box_dim)
+    expected = _brute_force_pairs(points, coords, CUTOFF, box_type, box_dim)
+    assert _as_set(searcher.query(points)) == expected
+
+def test_verlet_list_after_update():
+    rng = np.random.default_rng(2)
+    coords = rng.uniform(0, 20.0, size=(300, 3))
+    searcher = NeighborSearch(coords, CUTOFF, 'cube', 20.0, skin=1.0)
+    searcher.find_pairs()
+    moved = coords + rng.uniform(-0.2, 0.2, size=coords.shape)
+    assert not searcher.update(moved)
+    expected = _brute_force_pairs(moved, moved, CUTOFF, 'cube', 20.0)
+    assert _as_set(searcher.find_pairs()) == expected
+    assert searcher.update(moved + 1.0)
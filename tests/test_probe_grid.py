@@ -0,0 +1,98 @@
+"""The receptor grids have to match the direct summation of the pair terms,
+and the FFT scores of a rotation the direct summation of the probe atom
+energies on the grids."""
+import math
+import numpy as np
+import pytest
+from crimm.Data.probes.probes import CustomFFTProbe, ProbeAtom
+from crimm.Modeller import ProbeGrid
+from crimm.Modeller.ProbeGrid import ReceptorGrid, FFTProbeScorer
+
+SPACING = 1.0
+CUTOFF = 8.0
+
+def _create_probe():
+    atoms = [
+        ProbeAtom('C1', (0.0, 0.0, 0.0), 'C', 'CT3', -0.27),
+        ProbeAtom('H1', (1.09, 0.0, 0.0), 'H', 'HA3', 0.09),
+        ProbeAtom('H2', (-0.36, 1.03, 0.0), 'H', 'HA3', 0.09),
+        ProbeAtom('H3', (-0.36, -0.51, 0.89), 'H', 'HA3', 0.09),
+    ]
+    bonds = [(1, 2), (1, 3), (1, 4)]
+    return CustomFFTProbe(1, 'MET', atoms, bonds, [1, 1, 1])
+
+def _direct_grid_value(grid, index, atom_type=None):
+    """Sum the capped pair terms of all receptor atoms at a grid point."""
+    point = grid.get_grid_coords(index)
+    r = np.linalg.norm(grid._coords - point, axis=1)
+    in_cutoff = r <= grid.cutoff
+    r = np.maximum(r[in_cutoff], ProbeGrid.MIN_PAIR_DISTANCE)
+    if atom_type is None:
+        denom = grid.dielectric * (r * r if grid.rdie else r)
+        terms = ProbeGrid.COULOMB_CONSTANT * grid._charges[in_cutoff] / denom
+        value = np.clip(terms, -grid.elec_cap, grid.elec_cap).sum()
+        return np.clip(value, -grid.elec_cap, grid.elec_cap)
+    nb_param = grid.param_loader.get_nonbonded(atom_type)
+    eps = np.sqrt(grid._eps[in_cutoff] * abs(nb_param.epsilon))
+    ratio6 = ((grid._rmin_half[in_cutoff] + nb_param.rmin_half) / r)**6
+    terms = np.minimum(eps * (ratio6 * ratio6 - 2 * ratio6), grid.vdw_cap)
+    return min(terms.sum(), grid.vdw_cap)
+
+def _interpolate(grid_values, position):
+    """Trilinear interpolation of a grid at a position in grid units."""
+    base = np.floor(position).astype(int)
+    frac = position - base
+    value = 0.0
+    for corner in np.ndindex(2, 2, 2):
+        weight = np.prod(np.where(np.array(corner) == 1, frac, 1 - frac))
+        value += weight * grid_values[tuple(base + corner)]
+    return value
+
+@pytest.fixture
+def receptor_grid(topo_generator, tripeptide, monkeypatch):
+    # several chunks over several threads
+    monkeypatch.setattr(ProbeGrid, 'GRID_PAIR_CHUNK_SIZE', 1 << 12)
+    return ReceptorGrid(
+        tripeptide, topo_generator.param_dict['protein'], spacing=SPACING,
+        cutoff=CUTOFF, backend='cpu', n_workers=4
+    )
+
+def test_grids_match_direct_summation(receptor_grid):
+    rng = np.random.default_rng(0)
+    indices = rng.integers(0, receptor_grid.shape, size=(20, 3))
+    elec = receptor_grid.get_grid('elec')
+    vdw = receptor_grid.get_grid('CT3')
+    for index in indices:
+        np.testing.assert_allclose(
+            elec[tuple(index)], _direct_grid_value(receptor_grid, index),
+            rtol=1e-4, atol=1e-4
+        )
+        np.testing.assert_allclose(
+            vdw[tuple(index)], _direct_grid_value(receptor_grid, index, 'CT3'),
+            rtol=1e-4, atol=1e-4
+        )
+
+def test_fft_scores_match_direct_summation(receptor_grid):
+    probe = _create_probe()
+    scorer = FFTProbeScorer(receptor_grid, rotations=np.eye(3)[None])
+    result = scorer.score(probe)
+    coords = np.array([atom.coord for atom in probe.get_atoms()])
+    offsets = (coords - coords.mean(0)) / receptor_grid.spacing
+    grids = {
+        key: receptor_grid.get_grid(key) for key in ('elec', 'CT3', 'HA3')
+    }
+    valid = np.argwhere(np.isfinite(result.energy_grid))
+    assert len(valid) > 0
+    rng = np.random.default_rng(1)
+    for index in valid[rng.choice(len(valid), size=20)]:
+        expected = 0.0
+        for atom, offset in zip(probe.get_atoms(), offsets):
+            topo_def = atom.topo_definition
+            position = index + offset
+            expected += topo_def.charge * _interpolate(grids['elec'], position)
+            expected += _interpolate(grids[topo_def.atom_type], position)
+        np.testing.assert_allclose(
+            result.energy_grid[tuple(index)], expected, rtol=1e-3, atol=1e-2
+        )
+    assert (result.rotation_grid[np.isfinite(result.energy_grid)] == 0).all()
+    assert math.isclose(result.pose_energies[0], result.energy_grid.min())
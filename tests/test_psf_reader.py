@@ -0,0 +1,27 @@
+"""The columnar PSF reader has to give the same atom table as the line by line
+reader, with and without the single pass over the atom block."""
+import numpy as np
+from crimm.IO.PSFWriter import write_psf
+from crimm.IO.PSFReader import read_psf, PSF_ATOM_FIELDS
+
+def _assert_same_atoms(file_path):
+    atoms = read_psf(str(file_path), as_arrays=True).atoms
+    expected = read_psf(str(file_path)).to_arrays().atoms
+    assert len(atoms) > 0
+    for name, _ in PSF_ATOM_FIELDS:
+        assert np.array_equal(atoms[name], expected[name])
+
+def test_atom_table_matches_atom_lines(peptide, tmp_path):
+    file_path = tmp_path / 'peptide.psf'
+    write_psf(peptide, str(file_path), title='test')
+    _assert_same_atoms(file_path)
+
+def test_atom_table_with_uneven_atom_lines(peptide, tmp_path):
+    file_path = tmp_path / 'peptide.psf'
+    write_psf(peptide, str(file_path), title='test')
+    lines = file_path.read_text().split('\n')
+    natom_idx = next(i for i, line in enumerate(lines) if '!NATOM' in line)
+    # an extra trailing field on one atom line only
+    lines[natom_idx + 2] += ' 0.00000'
+    file_path.write_text('\n'.join(lines))
+    _assert_same_atoms(file_path)
@@ -0,0 +1,37 @@
+"""The streamed PSF output has to match the output of the original PSFWriter
+(tests/reference/baseline_psf_writer.py) byte for byte. The titles are given
+explicitly, the default title has a timestamp."""
+import io
+from crimm.IO.PSFWriter import PSFWriter, write_psf, get_psf_str
+from tests.reference.baseline_psf_writer import PSFWriter as BaselinePSFWriter
+
+def test_psf_string_matches_baseline(peptide):
+    expected = BaselinePSFWriter().get_psf_string(peptide, title='test')
+    assert PSFWriter().get_psf_string(peptide, title='test') == expected
+    assert expected.endswith('\n')
+
+def test_psf_chunks_join_to_psf_string(tripeptide):
+    writer = PSFWriter()
+    psf_string = writer.get_psf_string(tripeptide, title='test')
+    chunks = writer.iter_psf_chunks(tripeptide, title='test')
+    assert ''.join(chunks) == psf_string
+
+def test_write_psf_to_file(tripeptide, tmp_path):
+    file_path = tmp_path / 'tripeptide.psf'
+    write_psf(tripeptide, str(file_path), title='test')
+    expected = BaselinePSFWriter().get_psf_string(tripeptide, title='test')
+    assert file_path.read_text() == expected
+    buffer = io.StringIO()
+    PSFWriter().write(tripeptide, buffer, title='test')
+    assert buffer.getvalue() == expected
+
+def test_topology_arrays_match_psf(tripeptide):
+    writer = PSFWriter()
+    arrays = writer.get_topology_arrays(tripeptide)
+    n_atoms = sum(1 for _ in tripeptide.get_atoms())
+    assert len(arrays['atom_types']) == n_atoms
+    assert arrays['bonds'].shape[1] == 2
+    assert arrays['bonds'].min() >= 0 and arrays['bonds'].max() < n_atoms
+    n_bonds = len(tripeptide.topology.bonds)
+    assert len(arrays['bonds']) == n_bonds
+    assert get_psf_str(tripeptide, title='test').count('!NBOND') == 1
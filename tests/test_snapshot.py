@@ -0,0 +1,87 @@
+"""Snapshots are reopened from the flat hierarchy and topology tables, and the
+models they load match the models they were written from."""
+import numpy as np
+from crimm.IO.PSFWriter import PSFWriter
+from crimm.IO.Snapshot import Snapshot, write_snapshot, load_snapshot
+from crimm.Modeller.Solvator import Solvator
+from crimm.StructEntities.Chain import BulkSolvent
+
+def _atom_records(model):
+    return [
+        (
+            atom.parent.parent.id, atom.parent.id, atom.parent.resname,
+            atom.name, atom.element, atom.serial_number
+        )
+        for atom in model.get_atoms()
+    ]
+
+def test_round_trip_hierarchy(tripeptide, tmp_path):
+    file_path = str(tmp_path / 'tripeptide.snp')
+    write_snapshot(tripeptide, file_path)
+    loaded = load_snapshot(file_path)
+    assert type(loaded) is type(tripeptide)
+    assert [chain.id for chain in loaded] == [chain.id for chain in tripeptide]
+    assert _atom_records(loaded) == _atom_records(tripeptide)
+    assert np.allclose(
+        [atom.coord for atom in loaded.get_atoms()],
+        [atom.coord for atom in tripeptide.get_atoms()]
+    )
+    assert str(loaded['A'].can_seq) == str(tripeptide['A'].can_seq)
+
+def test_topology_and_parameter_arrays(tripeptide, tmp_path):
+    file_path = str(tmp_path / 'tripeptide.snp')
+    write_snapshot(tripeptide, file_path)
+    expected = PSFWriter().get_topology_arrays(tripeptide)
+    with Snapshot(file_path) as snapshot:
+        arrays = snapshot.get_topology_arrays()
+        for name in ('bonds', 'angles', 'dihedrals', 'impropers', 'cmap'):
+            assert np.array_equal(arrays[name], expected[name])
+        assert np.allclose(arrays['charges'], expected['charges'])
+        params = snapshot.get_parameter_arrays()
+        for name in ('bonds', 'angles'):
+            assert len(params[name]['index']) == len(arrays[name])
+            assert (params[name]['index'] >= 0).all()
+        assert len(params['nonbonded']['index']) == len(arrays['atom_types'])
+    assert snapshot.closed
+
+def test_reattach_topology(topo_generator, tripeptide, tmp_path):
+    file_path = str(tmp_path / 'tripeptide.snp')
+    write_snapshot(tripeptide, file_path)
+    loaded = load_snapshot(file_path, topology_loader=topo_generator)
+    assert loaded.topology_loader is topo_generator
+    writer = PSFWriter()
+    assert writer.get_psf_string(loaded, title='test') == (
+        writer.get_psf_string(tripeptide, title='test')
+    )
+
+def test_reattach_mid_chain_patches(topo_generator, peptide, tmp_path):
+    # neutral lysine in the middle of the chain
+    residue = peptide['A'].residues[1]
+    topo_generator.patch_residue(residue, 'LSN', QUIET=True)
+    peptide.topology.update_residues(
+        [residue], topo_generator.param_dict['protein']
+    )
+    file_path = str(tmp_path / 'peptide.snp')
+    write_snapshot(peptide, file_path)
+    loaded = load_snapshot(file_path, topology_loader=topo_generator)
+    loaded_residue = loaded['A'].residues[1]
+    assert loaded_residue.topo_definition.patch_with == 'LSN'
+    assert 'HZ3' not in loaded_residue
+    writer = PSFWriter()
+    assert writer.get_psf_string(loaded, title='test') == (
+        writer.get_psf_string(peptide, title='test')
+    )
+
+def test_bulk_solvent_is_mapped(tripeptide, tmp_path):
+    water_chains = Solvator(tripeptide).solvate(cutoff=8.0)
+    file_path = str(tmp_path / 'solvated.snp')
+    write_snapshot(tripeptide, file_path)
+    with Snapshot(file_path) as snapshot:
+        loaded = snapshot.load_model()
+    # the coordinates stay valid after the snapshot is closed
+    for water_chain in water_chains:
+        loaded_chain = loaded[water_chain.id]
+        assert isinstance(loaded_chain, BulkSolvent)
+        assert loaded_chain.is_array_backed
+        assert np.array_equal(loaded_chain._coords, water_chain._coords)
+        assert np.array_equal(loaded_chain._resseqs, water_chain._resseqs)
@@ -0,0 +1,56 @@
+"""Water box and ion placement helpers of the Solvator."""
+import math
+import numpy as np
+import pytest
+from crimm.Modeller.Solvator import Solvator, _IonExclusionGrid, BOXWIDTH
+
+def test_ion_exclusion_grid_matches_brute_force():
+    rng = np.random.default_rng(0)
+    placed = rng.uniform(0, 30, (200, 3))
+    queries = rng.uniform(0, 30, (500, 3))
+    grid = _IonExclusionGrid(5.0)
+    for coord in placed:
+        grid.add(coord)
+    dists = np.linalg.norm(queries[:, None] - placed[None], axis=2)
+    expected = (dists < 5.0).any(axis=1)
+    assert [grid.has_neighbor(q) for q in queries] == expected.tolist()
+
+def test_ion_exclusion_grid_without_min_dist():
+    grid = _IonExclusionGrid(0.0)
+    grid.add(np.zeros(3))
+    assert not grid.has_neighbor(np.zeros(3))
+
+def _baseline_water_grid(unit_coords, n_units, order):
+    """The unit cubes replicated in the loop order of the previous water box
+    builder, with one translation per unit cube, centered at the origin."""
+    unit_coords = unit_coords.reshape(-1, 3)
+    points = []
+    for outer in range(n_units):
+        for middle in range(n_units):
+            for inner in range(n_units):
+                shift = np.zeros(3)
+                shift[list(order)] = np.array([outer, middle, inner]) * BOXWIDTH
+                points.append(unit_coords + shift)
+    points = np.concatenate(points)
+    return points + (-np.ptp(points, axis=0) / 2 - points.min(0))
+
+@pytest.mark.parametrize('box_type', ['cube', 'octa'])
+def test_water_box_keeps_the_water_order(tripeptide, box_type):
+    solvator = Solvator(tripeptide)
+    solvator.box_type = box_type
+    solvator.box_dim = 30.0
+    solvator.solvcut = 2.1
+    water_box = solvator.create_water_box_coords()
+    if box_type == 'cube':
+        n_units = int(np.ceil(solvator.box_dim / BOXWIDTH))
+        # z planes of y lines of x unit cubes
+        expected = _baseline_water_grid(
+            solvator.water_unit_coords, n_units, (2, 1, 0)
+        )
+    else:
+        n_units = int(math.ceil(solvator.box_dim * math.sqrt(4 / 3) / BOXWIDTH))
+        expected = _baseline_water_grid(
+            solvator.water_unit_coords, n_units, (0, 1, 2)
+        ).reshape(-1, 3, 3)
+        expected = expected[solvator._octa_sdf(expected[:, 0]) <= -solvator.solvcut]
+    np.testing.assert_array_equal(water_box, expected)
@@ -0,0 +1,150 @@
+"""Parameters of the angles and dihedrals are applied from the bond graph index
+arrays, the element objects are only created when accessed. The topology of
+updated residues has to match the topology of the chain generated again from
+the updated sequence."""
+from crimm.StructEntities.Model import Model
+from crimm.StructEntities.OrganizedModel import OrganizedModel
+from crimm.Modeller.SeqChainGenerator import SeqChainGenerator
+from crimm.Modeller.TopoLoader import CGENFFTopologyLoader
+from crimm.IO.PRMParser import parse_prm_block
+from tests.conftest import build_peptide_model
+
+def test_apply_keeps_graph_elements_as_index_arrays(tripeptide):
+    topology = tripeptide['A'].topology
+    for topo_type in ('angles', 'dihedrals'):
+        assert topology.get_local_index_array(topo_type) is not None
+
+def test_index_array_params_match_element_params(topo_generator, tripeptide):
+    topology = tripeptide['A'].topology
+    param_loader = topo_generator.param_dict['protein']
+    for topo_type in ('angles', 'dihedrals'):
+        elements = getattr(topology, topo_type)
+        assert topology.get_local_index_array(topo_type) is None
+        params = [element.param for element in elements]
+        assert all(param is not None for param in params)
+        for element in elements:
+            element.param = None
+        assert not param_loader._apply_to_element_list(topo_type, elements)
+        assert [element.param for element in elements] == params
+
+def test_atoms_without_definition_have_no_params(topo_generator):
+    model = build_peptide_model()
+    topo_generator.generate_model(model, QUIET=True)
+    param_loader = topo_generator.param_dict['protein']
+    atoms, indices = model['A'].topology.get_local_index_array('angles')
+    undefined_atom = model['A'].residues[1]['CB']
+    undefined_atom.topo_definition = None
+    params, no_param_list = param_loader._apply_to_index_array(
+        'angles', atoms, indices
+    )
+    pos = next(i for i, atom in enumerate(atoms) if atom is undefined_atom)
+    has_atom = (indices == pos).any(axis=1).tolist()
+    assert any(has_atom)
+    assert [param is None for param in params] == has_atom
+    assert len(no_param_list) == sum(has_atom)
+    assert all(
+        any(atom is undefined_atom for atom in element)
+        for element in no_param_list
+    )
+    assert not param_loader._apply_to_element_list('angles', [])
+    assert param_loader._apply_to_element_list(
+        'angles', no_param_list
+    ) == no_param_list
+
+def test_update_residues_applies_params_to_new_rows(topo_generator):
+    model = build_peptide_model()
+    topo_generator.generate_model(model, QUIET=True)
+    chain = model['A']
+    topology = chain.topology
+    param_loader = topo_generator.param_dict['protein']
+    topology.update_residues([chain.residues[1]], param_loader)
+    for topo_type in ('angles', 'dihedrals'):
+        assert topology.get_local_index_array(topo_type) is not None
+        assert all(
+            element.param is not None
+            for element in getattr(topology, topo_type)
+        )
+
+def _atom_key(atoms):
+    key = tuple((atom.parent.id[1], atom.name) for atom in atoms)
+    return min(key, key[::-1])
+
+def _element_keys(topology, topo_type):
+    if topo_type == 'cmap':
+        # the cross-terms are pairs of dihedrals
+        return {
+            tuple(sorted(_atom_key(dihe) for dihe in element))
+            for element in topology.cmap
+        }
+    return {_atom_key(element) for element in getattr(topology, topo_type)}
+
+def test_update_residues_matches_full_regeneration(topo_generator):
+    model = build_peptide_model('ALA ALA ALA ALA')
+    topo_generator.generate_model(model, QUIET=True)
+    residue = model['A'].residues[1]
+    # point mutation ALA -> GLY, the glycine hydrogens are built again
+    for atom_name in ('HA', 'CB', 'HB1', 'HB2', 'HB3'):
+        residue.detach_child(atom_name)
+    residue.resname = 'GLY'
+    topo_generator.update_residues([residue], QUIET=True)
+    expected = build_peptide_model('ALA GLY ALA ALA')
+    topo_generator.generate_model(expected, QUIET=True)
+    for topo_type in ('bonds', 'angles', 'dihedrals', 'impropers', 'cmap'):
+        assert _element_keys(model['A'].topology, topo_type) == (
+            _element_keys(expected['A'].topology, topo_type)
+        )
+
+def test_update_residues_uses_the_params_of_each_chain(topo_generator):
+    model = Model(1)
+    for chain_id, sequence, chain_type in (
+        ('A', 'ALA ALA ALA', 'polypeptide'), ('B', 'ADE GUA CYT', 'rna')
+    ):
+        generator = SeqChainGenerator()
+        generator.set_three_letter_sequence(sequence, chain_type=chain_type)
+        model.add(generator.create_chain(chain_id))
+    model = OrganizedModel(model)
+    topo_generator.generate_model(model, QUIET=True)
+    residues = [model['A'].residues[1], model['B'].residues[1]]
+    topo_generator.update_residues(residues, QUIET=True)
+    for chain in model:
+        for topo_type in ('bonds', 'angles', 'dihedrals'):
+            assert all(
+                element.param is not None
+                for element in getattr(chain.topology, topo_type)
+            )
+
+LIGAND_PRM_BLOCK = """
+read param card flex append
+* Parameters generated by analogy by
+* CHARMM General Force Field (CGenFF) program version 2.5
+*
+
+BONDS
+CG2R61 XG301    229.63     1.5000 ! LIG , from CG2R61 CG321, PENALTY= 4.5
+
+ANGLES
+CG2R61 CG2R61 XG301   45.80    120.00 ! LIG , from CG2R61 CG2R61 CG321
+
+DIHEDRALS
+CG2R61 CG2R61 XG301 HGA3     0.0000  6   180.00 ! LIG , from CG2R61 CG2R61 CG321 HGA2
+
+IMPROPERS
+
+END
+RETURN
+"""
+
+def test_ligand_params_are_merged_into_cgenff_loader(tmp_path):
+    param_dict = {}
+    cgenff_loader = CGENFFTopologyLoader(
+        save_path=str(tmp_path), param_dict=param_dict
+    )
+    ligand_params = parse_prm_block(LIGAND_PRM_BLOCK)
+    assert ligand_params['bonds'][('CG2R61', 'XG301')].b0 == 1.5
+    cgenff_loader._merge_params(ligand_params)
+    param_loader = param_dict['cgenff']
+    assert param_loader is cgenff_loader.param_loader
+    assert param_loader.get_bond(('XG301', 'CG2R61')).kb == 229.63
+    assert param_loader.get_angle(('CG2R61', 'CG2R61', 'XG301')) is not None
+    # the CGenFF parameters are kept
+    assert len(param_loader.param_dict['nonbonded']) > 0
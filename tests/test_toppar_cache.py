@@ -0,0 +1,54 @@
+"""The toppar cache is opt-in, and entries written by another crimm version
+are not loaded."""
+import pickle
+import pytest
+from crimm.IO import TopparCache
+
+def _parse_count(calls):
+    def parse(path):
+        calls.append(path)
+        return {'parsed': path}
+    return parse
+
+def test_cache_is_off_by_default(monkeypatch, tmp_path):
+    monkeypatch.delenv('CRIMM_TOPPAR_CACHE', raising=False)
+    monkeypatch.delenv('CRIMM_TOPPAR_CACHE_DIR', raising=False)
+    assert not TopparCache.cache_enabled()
+    monkeypatch.setenv('CRIMM_TOPPAR_CACHE_DIR', str(tmp_path))
+    assert TopparCache.cache_enabled()
+    monkeypatch.setenv('CRIMM_TOPPAR_CACHE', '0')
+    assert not TopparCache.cache_enabled()
+
+def test_cache_entry_is_reused(monkeypatch, tmp_path):
+    monkeypatch.delenv('CRIMM_TOPPAR_CACHE', raising=False)
+    monkeypatch.setenv('CRIMM_TOPPAR_CACHE_DIR', str(tmp_path / 'cache'))
+    toppar_file = tmp_path / 'test.rtf'
+    toppar_file.write_text('* test\n')
+    calls = []
+    for _ in range(2):
+        data = TopparCache.load_cached(
+            str(toppar_file), 'rtf', _parse_count(calls)
+        )
+        assert data == {'parsed': str(toppar_file)}
+    assert len(calls) == 1
+
+def test_other_crimm_version_is_ignored(monkeypatch, tmp_path):
+    monkeypatch.delenv('CRIMM_TOPPAR_CACHE', raising=False)
+    monkeypatch.setenv('CRIMM_TOPPAR_CACHE_DIR', str(tmp_path / 'cache'))
+    toppar_file = tmp_path / 'test.rtf'
+    toppar_file.write_text('* test\n')
+    calls = []
+    TopparCache.load_cached(str(toppar_file), 'rtf', _parse_count(calls))
+    cache_path = TopparCache.get_cache_path(str(toppar_file), 'rtf')
+    with open(cache_path, 'wb') as f:
+        pickle.dump({
+            'header': {'cache_version': TopparCache.CACHE_VERSION,
+                       'crimm_version': 'other'},
+            'data': {'parsed': 'stale'}
+        }, f)
+    with pytest.warns(UserWarning, match='another version'):
+        data = TopparCache.load_cached(
+            str(toppar_file), 'rtf', _parse_count(calls)
+        )
+    assert data == {'parsed': str(toppar_file)}
+    assert len(calls) == 2